@@ -0,0 +1,246 @@
+/*
+ * mempressure: allocate-and-touch benchmark for page reclaim
+ *
+ * Maps a file as the working set of an application and reads every page
+ * of it over and over, while a child process keeps memory tight: it
+ * allocates and touches anonymous memory, streams a large file through
+ * the page cache, or both.  At the end it prints how long the passes over
+ * the working set took and what reclaim did meanwhile, as the change of
+ * the reclaim counters in /proc/vmstat.
+ *
+ * Run it once with vm.protect_foreground at 0 and once at 1, with -b
+ * naming the tasks file of the background cpu cgroup so that the child
+ * counts as a background application:
+ *
+ *	mempressure -w /system/framework/framework.jar -s /sdcard/big.bin \
+ *		-b /dev/cpuctl/bg_non_interactive/tasks -t 30
+ *
+ * Copyright (C) 2011 Meizu Technology Co.Ltd, Zhuhai, China
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define MAX_COUNTERS	64
+
+/* The /proc/vmstat counters reported, by prefix */
+static const char *counter_prefixes[] = {
+	"pgscan_",
+	"pgsteal_",
+	"kswapd_steal",
+	"pgrotated",
+	"pgprotected",
+	"rmap_batched",
+	"allocstall",
+	"direct_reclaim_",
+	"pgmajfault",
+	NULL
+};
+
+struct counter {
+	char name[64];
+	unsigned long long value;
+};
+
+static long page_size;
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s -w file [-a MB] [-s file] [-b tasks] [-t seconds]\n"
+		"  -w file     working set, read page by page through mmap\n"
+		"  -a MB       anonymous memory the child allocates and touches\n"
+		"  -s file     file the child reads over and over\n"
+		"  -b tasks    cgroup tasks file to move the child to\n"
+		"  -t seconds  how long to run, default 10\n",
+		prog);
+	exit(1);
+}
+
+static int read_vmstat(struct counter *c)
+{
+	char name[64];
+	unsigned long long value;
+	FILE *f;
+	int i, n = 0;
+
+	f = fopen("/proc/vmstat", "r");
+	if (!f) {
+		perror("/proc/vmstat");
+		exit(1);
+	}
+	while (n < MAX_COUNTERS && fscanf(f, "%63s %llu", name, &value) == 2) {
+		for (i = 0; counter_prefixes[i]; i++)
+			if (!strncmp(name, counter_prefixes[i],
+				     strlen(counter_prefixes[i])))
+				break;
+		if (!counter_prefixes[i])
+			continue;
+		strcpy(c[n].name, name);
+		c[n].value = value;
+		n++;
+	}
+	fclose(f);
+	return n;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* The child: keep memory tight until killed */
+static void pressure(size_t anon_size, const char *stream)
+{
+	static char buf[65536];
+	char *anon = NULL;
+	size_t off;
+	int fd;
+
+	if (anon_size) {
+		anon = mmap(NULL, anon_size, PROT_READ | PROT_WRITE,
+			    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (anon == MAP_FAILED) {
+			perror("mmap");
+			exit(1);
+		}
+	}
+
+	for (;;) {
+		for (off = 0; off < anon_size; off += page_size)
+			anon[off]++;
+		if (!stream)
+			continue;
+		fd = open(stream, O_RDONLY);
+		if (fd < 0) {
+			perror(stream);
+			exit(1);
+		}
+		while (read(fd, buf, sizeof(buf)) > 0)
+			;
+		close(fd);
+	}
+}
+
+static void move_to_cgroup(const char *tasks, pid_t pid)
+{
+	FILE *f;
+
+	f = fopen(tasks, "w");
+	if (!f || fprintf(f, "%d\n", pid) < 0 || fclose(f)) {
+		perror(tasks);
+		kill(pid, SIGKILL);
+		exit(1);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct counter before[MAX_COUNTERS], after[MAX_COUNTERS];
+	const char *working_set = NULL, *stream = NULL, *tasks = NULL;
+	size_t anon_size = 0, size, off;
+	double start, t0, dt, total = 0, slowest = 0;
+	unsigned long passes = 0;
+	int seconds = 10;
+	volatile char sum = 0;
+	struct stat st;
+	char *map;
+	pid_t pid;
+	int fd, c, i, n;
+
+	page_size = sysconf(_SC_PAGESIZE);
+
+	while ((c = getopt(argc, argv, "w:a:s:b:t:")) != -1) {
+		switch (c) {
+		case 'w':
+			working_set = optarg;
+			break;
+		case 'a':
+			anon_size = strtoul(optarg, NULL, 0) << 20;
+			break;
+		case 's':
+			stream = optarg;
+			break;
+		case 'b':
+			tasks = optarg;
+			break;
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (!working_set || (!anon_size && !stream) || seconds <= 0)
+		usage(argv[0]);
+
+	fd = open(working_set, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st)) {
+		perror(working_set);
+		return 1;
+	}
+	size = st.st_size;
+	map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+
+	n = read_vmstat(before);
+
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return 1;
+	}
+	if (!pid)
+		pressure(anon_size, stream);
+	if (tasks)
+		move_to_cgroup(tasks, pid);
+
+	start = now();
+	do {
+		t0 = now();
+		for (off = 0; off < size; off += page_size)
+			sum += map[off];
+		dt = now() - t0;
+		total += dt;
+		if (dt > slowest)
+			slowest = dt;
+		passes++;
+	} while (now() - start < seconds);
+
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+
+	if (read_vmstat(after) != n) {
+		fprintf(stderr, "/proc/vmstat changed\n");
+		return 1;
+	}
+
+	printf("%lu passes over %s (%zu kB), average %.2f ms, slowest %.2f ms\n",
+	       passes, working_set, size >> 10,
+	       total * 1000 / passes, slowest * 1000);
+	for (i = 0; i < n; i++)
+		printf("%-24s %llu\n", after[i].name,
+		       after[i].value - before[i].value);
+
+	return 0;
+}
@@ -1,6 +1,70 @@
 #ifndef __ARM_PERCPU
 #define __ARM_PERCPU
 
+#if defined(CONFIG_CPU_32v6K) && !defined(CONFIG_CPU_V6)
+/*
+ * Double word cmpxchg of a per cpu pair with ldrexd/strexd.  It is
+ * atomic against interrupts without disabling them: every exception
+ * return clears the exclusive monitor, so an interrupt that ran between
+ * the ldrexd and the strexd makes the strexd fail and the pair is
+ * compared again.  Only preemption, which could move us to the area of
+ * another cpu, has to be held off.  The pair must be 8 byte aligned.
+ */
+#ifdef __ARMEB__
+#define __pcpu_double_word(v1, v2)	\
+	(((unsigned long long)(v1) << 32) | (unsigned long)(v2))
+#else
+#define __pcpu_double_word(v1, v2)	\
+	(((unsigned long long)(v2) << 32) | (unsigned long)(v1))
+#endif
+
+static inline int __arm_cmpxchg_double(unsigned long long *ptr,
+				       unsigned long long old,
+				       unsigned long long new)
+{
+	unsigned long long oldval;
+	unsigned long res;
+
+	do {
+		__asm__ __volatile__("@ __arm_cmpxchg_double\n"
+		"ldrexd		%1, %H1, [%3]\n"
+		"mov		%0, #0\n"
+		"teq		%1, %4\n"
+		"teqeq		%H1, %H4\n"
+		"strexdeq	%0, %5, %H5, [%3]"
+		: "=&r" (res), "=&r" (oldval), "+Qo" (*ptr)
+		: "r" (ptr), "r" (old), "r" (new)
+		: "cc");
+	} while (res);
+
+	return oldval == old;
+}
+
+#define __arm_pcpu_cmpxchg_double(pcp1, pcp2, oval1, oval2, nval1, nval2) \
+	__arm_cmpxchg_double(						\
+		(unsigned long long *)__this_cpu_ptr(&(pcp1)),		\
+		__pcpu_double_word((unsigned long)(oval1),		\
+				   (unsigned long)(oval2)),		\
+		__pcpu_double_word((unsigned long)(nval1),		\
+				   (unsigned long)(nval2)))
+
+#define __this_cpu_cmpxchg_double_4(pcp1, pcp2, oval1, oval2, nval1, nval2) \
+	__arm_pcpu_cmpxchg_double(pcp1, pcp2, oval1, oval2, nval1, nval2)
+
+#define this_cpu_cmpxchg_double_4(pcp1, pcp2, oval1, oval2, nval1, nval2) \
+({									\
+	int ret__;							\
+	preempt_disable();						\
+	ret__ = __arm_pcpu_cmpxchg_double(pcp1, pcp2,			\
+			oval1, oval2, nval1, nval2);			\
+	preempt_enable();						\
+	ret__;								\
+})
+
+#define irqsafe_cpu_cmpxchg_double_4(pcp1, pcp2, oval1, oval2, nval1, nval2) \
+	this_cpu_cmpxchg_double_4(pcp1, pcp2, oval1, oval2, nval1, nval2)
+#endif
+
 #include <asm-generic/percpu.h>
 
 #endif
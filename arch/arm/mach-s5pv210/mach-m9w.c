@@ -177,10 +177,30 @@ static struct platform_device ram_console_device = {
 	},
 };
 
+#ifdef CONFIG_ANDROID_RAM_TRACE
+/* After the ram console and the pm scratchpad, in the same 1M */
+static struct resource ram_trace_resource[] = {
+	{
+		.flags = IORESOURCE_MEM,
+	}
+};
+
+static struct platform_device ram_trace_device = {
+	.name = "ram_trace",
+	.id = -1,
+	.num_resources = ARRAY_SIZE(ram_trace_resource),
+	.resource = ram_trace_resource,
+};
+#endif
+
 static void __init setup_ram_console_mem(void)
 {
 	ram_console_resource[0].start = ram_console_start;
 	ram_console_resource[0].end = ram_console_start + ram_console_size - 1;
+#ifdef CONFIG_ANDROID_RAM_TRACE
+	ram_trace_resource[0].start = ram_console_start + SZ_128K;
+	ram_trace_resource[0].end = ram_console_start + SZ_128K + SZ_256K - 1;
+#endif
 }
 #endif
 
@@ -1536,6 +1556,9 @@ static struct platform_device *m9w_devices[] __initdata = {
 #ifdef CONFIG_ANDROID_RAM_CONSOLE
 	&ram_console_device,
 #endif
+#ifdef CONFIG_ANDROID_RAM_TRACE
+	&ram_trace_device,
+#endif
 
 #ifdef CONFIG_BT
 	&m9w_bt_ctr, 
@@ -500,6 +500,8 @@ static void s5p_timer_init(void)
 	clk_put(clk_rtc);
 
 	s5p_timer_setup();
+	/* sched_clock() runs off XusbXTI, fine enough for irq time */
+	enable_sched_clock_irqtime();
 	setup_irq(IRQ_RTC_TIC, &s5p_tick_timer_irq);
 #if defined(USE_SYSTIMER_IRQ)
 	setup_irq(IRQ_SYSTIMER, &s5p_systimer_irq);
@@ -374,6 +374,7 @@ static void __init s5p_clocksource_init(void)
 	s5p_time_start(timer_source.source_id, PERIODIC);
 
 	init_sched_clock(&cd, s5p_update_sched_clock, 32, clock_rate);
+	enable_sched_clock_irqtime();
 
 	if (clocksource_register_hz(&time_clocksource, clock_rate))
 		panic("%s: can't register clocksource\n", time_clocksource.name);
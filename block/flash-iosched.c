@@ -0,0 +1,873 @@
+/*
+ *  Flash i/o scheduler.
+ *
+ *  Copyright (C) 2011 Meizu Technology Co.Ltd, Zhuhai, China
+ *
+ *  Based on the deadline scheduler, Copyright (C) 2002 Jens Axboe
+ */
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/blkdev.h>
+#include <linux/elevator.h>
+#include <linux/bio.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/init.h>
+#include <linux/compiler.h>
+#include <linux/rbtree.h>
+#include <linux/log2.h>
+#include <linux/ktime.h>
+#include <linux/sched.h>
+
+/*
+ * See Documentation/block/flash-iosched.txt
+ */
+static const int sync_write_expire = HZ / 4;	/* max time before a sync write is submitted */
+static const int async_write_expire = HZ;	/* ditto for async writes */
+static const int discard_expire = 5 * HZ;	/* ditto for discards */
+static const int writes_starved = 4;		/* max times reads can starve a write batch */
+static const int write_batch = 16;		/* max writes dispatched per region batch */
+static const int latency_target = 20000;	/* foreground read latency target, usecs */
+static const int bg_write_max_delay = 2 * HZ;	/* max delay past expiry for held back writes */
+
+#define FLASH_DEFAULT_REGION_KB	4096	/* when the queue has no discard granularity */
+#define FLASH_MAX_REGION_KB	(1 << 20)
+
+enum {
+	FLASH_READ,
+	FLASH_WRITE,
+	FLASH_BG_WRITE,
+	FLASH_DISCARD,
+	FLASH_NR_QUEUES,
+};
+
+enum {
+	FLASH_SYNC_WRITE,
+	FLASH_ASYNC_WRITE,
+};
+
+/*
+ * Requests issued by tasks in a background cpu cgroup, and by default
+ * writeback issued from kernel threads, are background requests.  Their
+ * writes are held back while foreground reads miss latency_target_us.
+ */
+enum {
+	FLASH_FG,
+	FLASH_BG,
+	FLASH_NR_CLASSES,
+};
+
+struct flash_lat_stat {
+	unsigned long count;
+	u64 total_us;
+	u32 max_us;
+};
+
+struct flash_data {
+	/*
+	 * run time data
+	 */
+
+	/*
+	 * every request is on one sort_list, for merging and for building
+	 * write batches, and on one fifo list
+	 */
+	struct rb_root sort_list[FLASH_NR_QUEUES];
+	struct list_head read_fifo;
+	struct list_head write_fifo[2];
+	struct list_head bg_write_fifo;
+	struct list_head discard_fifo;
+
+	struct request *next_write;	/* next in sort order in the current batch */
+	sector_t batch_region;		/* region the current batch writes to */
+	unsigned int region_shift;	/* log2 of the region size in sectors */
+	unsigned int batching;		/* number of writes in the current batch */
+	unsigned int starved;		/* times reads have starved writes */
+
+	u32 fg_read_lat;		/* moving average of foreground reads, usecs */
+	unsigned long fg_read_stamp;	/* jiffies of the last foreground read */
+	int throttling;			/* fg_read_lat is above latency_target */
+
+	/*
+	 * runs the queue again when requests held back by the throttle
+	 * may go, in case nothing else does before
+	 */
+	struct request_queue *queue;
+	struct timer_list throttle_timer;
+	struct work_struct unthrottle_work;
+
+	/*
+	 * settings that change how the i/o scheduler behaves
+	 */
+	int write_expire[2];
+	int discard_expire;
+	int writes_starved;
+	int write_batch;
+	int front_merges;
+	int region_kb;			/* 0: use the discard granularity */
+	int latency_target;		/* usecs, 0 disables throttling */
+	int bg_write_max_delay;
+	int bg_writeback;
+
+	/*
+	 * dispatch statistics
+	 */
+	unsigned long dispatched[FLASH_NR_QUEUES];
+	unsigned long write_batches;
+	unsigned long expired;
+	unsigned long throttle_events;
+	struct flash_lat_stat lat[FLASH_NR_CLASSES][2];
+};
+
+/*
+ * elevator_private[0] holds the class of the request, [1] the time it was
+ * queued, in usecs truncated to 32 bits.
+ */
+static inline int flash_rq_class(struct request *rq)
+{
+	return (long)rq->elevator_private[0];
+}
+
+static inline u32 flash_now_us(void)
+{
+	return (u32)ktime_to_us(ktime_get());
+}
+
+static inline int flash_queue(struct request *rq)
+{
+	if (rq->cmd_flags & REQ_DISCARD)
+		return FLASH_DISCARD;
+	if (rq_data_dir(rq) == READ)
+		return FLASH_READ;
+	return flash_rq_class(rq) == FLASH_BG ? FLASH_BG_WRITE : FLASH_WRITE;
+}
+
+static inline struct rb_root *
+flash_rb_root(struct flash_data *fd, struct request *rq)
+{
+	return &fd->sort_list[flash_queue(rq)];
+}
+
+static inline struct list_head *
+flash_fifo(struct flash_data *fd, struct request *rq)
+{
+	switch (flash_queue(rq)) {
+	case FLASH_READ:
+		return &fd->read_fifo;
+	case FLASH_DISCARD:
+		return &fd->discard_fifo;
+	case FLASH_BG_WRITE:
+		return &fd->bg_write_fifo;
+	}
+	return &fd->write_fifo[rq_is_sync(rq) ? FLASH_SYNC_WRITE :
+						FLASH_ASYNC_WRITE];
+}
+
+static inline int flash_expire(struct flash_data *fd, struct request *rq)
+{
+	switch (flash_queue(rq)) {
+	case FLASH_READ:
+		return 0;
+	case FLASH_DISCARD:
+		return fd->discard_expire;
+	}
+	return fd->write_expire[rq_is_sync(rq) ? FLASH_SYNC_WRITE :
+						 FLASH_ASYNC_WRITE];
+}
+
+static inline sector_t flash_region(struct flash_data *fd, struct request *rq)
+{
+	return blk_rq_pos(rq) >> fd->region_shift;
+}
+
+/*
+ * Writes are batched per erase-block sized region.  Unless set explicitly
+ * the region follows the queue's discard granularity, which the driver may
+ * only fill in after the elevator was set up, so look it up per batch.
+ */
+static void flash_update_region(struct flash_data *fd, struct request_queue *q)
+{
+	unsigned int kb = fd->region_kb;
+
+	if (!kb)
+		kb = q->limits.discard_granularity >> 10;
+	if (!kb)
+		kb = FLASH_DEFAULT_REGION_KB;
+
+	/* region_kb is a power of 2, ilog2() rounds any other granularity down */
+	fd->region_shift = ilog2(kb) + 1;
+}
+
+static inline struct request *flash_former_request(struct request *rq)
+{
+	struct rb_node *node = rb_prev(&rq->rb_node);
+
+	if (node)
+		return rb_entry_rq(node);
+
+	return NULL;
+}
+
+static inline struct request *flash_latter_request(struct request *rq)
+{
+	struct rb_node *node = rb_next(&rq->rb_node);
+
+	if (node)
+		return rb_entry_rq(node);
+
+	return NULL;
+}
+
+static void flash_move_to_dispatch(struct flash_data *fd, struct request *rq);
+
+/*
+ * Class of a request issued by current.  Only writes are ever held back,
+ * so only the class of writes has to be exact.
+ */
+static long flash_task_class(struct flash_data *fd, int rw, int sync)
+{
+	if (current->flags & PF_KTHREAD) {
+		if (fd->bg_writeback && rw == WRITE && !sync)
+			return FLASH_BG;
+	} else if (task_in_background_group(current))
+		return FLASH_BG;
+
+	return FLASH_FG;
+}
+
+static void
+flash_add_rq_rb(struct flash_data *fd, struct request *rq)
+{
+	struct rb_root *root = flash_rb_root(fd, rq);
+	struct request *__alias;
+
+	while (unlikely(__alias = elv_rb_add(root, rq)))
+		flash_move_to_dispatch(fd, __alias);
+}
+
+static inline void
+flash_del_rq_rb(struct flash_data *fd, struct request *rq)
+{
+	if (fd->next_write == rq)
+		fd->next_write = flash_latter_request(rq);
+
+	elv_rb_del(flash_rb_root(fd, rq), rq);
+}
+
+/*
+ * add rq to rbtree and fifo
+ */
+static void
+flash_add_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	flash_add_rq_rb(fd, rq);
+
+	rq->elevator_private[1] = (void *)(unsigned long)flash_now_us();
+	rq_set_fifo_time(rq, jiffies + flash_expire(fd, rq));
+	list_add_tail(&rq->queuelist, flash_fifo(fd, rq));
+}
+
+/*
+ * remove rq from rbtree and fifo.
+ */
+static void flash_remove_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	rq_fifo_clear(rq);
+	flash_del_rq_rb(fd, rq);
+}
+
+static int
+flash_merge(struct request_queue *q, struct request **req, struct bio *bio)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	struct request *__rq;
+	int idx;
+
+	/*
+	 * check for front merge
+	 */
+	if (!fd->front_merges)
+		return ELEVATOR_NO_MERGE;
+
+	if (bio->bi_rw & REQ_DISCARD)
+		idx = FLASH_DISCARD;
+	else if (bio_data_dir(bio) == READ)
+		idx = FLASH_READ;
+	else if (flash_task_class(fd, WRITE,
+				  bio->bi_rw & REQ_SYNC) == FLASH_BG)
+		idx = FLASH_BG_WRITE;
+	else
+		idx = FLASH_WRITE;
+
+	__rq = elv_rb_find(&fd->sort_list[idx],
+			   bio->bi_sector + bio_sectors(bio));
+	if (__rq && elv_rq_merge_ok(__rq, bio)) {
+		*req = __rq;
+		return ELEVATOR_FRONT_MERGE;
+	}
+
+	return ELEVATOR_NO_MERGE;
+}
+
+/*
+ * A foreground write merged into a background request would be held back
+ * with it, a background one merged into a foreground request would slip
+ * past the throttle.  Requests only merge with requests of their own sort
+ * list, so of their own class.
+ */
+static int flash_allow_merge(struct request_queue *q, struct request *rq,
+			     struct bio *bio)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	if (bio_data_dir(bio) == READ || (bio->bi_rw & REQ_DISCARD))
+		return 1;
+
+	return flash_task_class(fd, WRITE, bio->bi_rw & REQ_SYNC) ==
+		flash_rq_class(rq);
+}
+
+static void flash_merged_request(struct request_queue *q,
+				 struct request *req, int type)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	/*
+	 * if the merge was a front merge, we need to reposition request
+	 */
+	if (type == ELEVATOR_FRONT_MERGE) {
+		flash_del_rq_rb(fd, req);
+		flash_add_rq_rb(fd, req);
+	}
+}
+
+static void
+flash_merged_requests(struct request_queue *q, struct request *req,
+		      struct request *next)
+{
+	/*
+	 * if next expires before rq, assign its expire time to rq
+	 * and move into next position (next will be deleted) in fifo.
+	 * Both come from the same sort list, so they are of one class and
+	 * rq may take the place of next in its fifo.
+	 */
+	if (!list_empty(&req->queuelist) && !list_empty(&next->queuelist)) {
+		if (time_before(rq_fifo_time(next), rq_fifo_time(req))) {
+			list_move(&req->queuelist, &next->queuelist);
+			rq_set_fifo_time(req, rq_fifo_time(next));
+		}
+	}
+
+	/*
+	 * kill knowledge of next, this one is a goner
+	 */
+	flash_remove_request(q, next);
+}
+
+/*
+ * move request from sort list to dispatch queue.
+ */
+static void flash_move_to_dispatch(struct flash_data *fd, struct request *rq)
+{
+	struct request_queue *q = rq->q;
+
+	fd->dispatched[flash_queue(rq)]++;
+	flash_remove_request(q, rq);
+	elv_dispatch_add_tail(q, rq);
+}
+
+static inline int flash_fifo_expired(struct list_head *fifo)
+{
+	return !list_empty(fifo) &&
+		time_after(jiffies, rq_fifo_time(rq_entry_fifo(fifo->next)));
+}
+
+static inline int flash_writes_queued(struct flash_data *fd)
+{
+	return !list_empty(&fd->write_fifo[FLASH_SYNC_WRITE]) ||
+		!list_empty(&fd->write_fifo[FLASH_ASYNC_WRITE]);
+}
+
+static inline int flash_write_expired(struct flash_data *fd)
+{
+	return flash_fifo_expired(&fd->write_fifo[FLASH_SYNC_WRITE]) ||
+		flash_fifo_expired(&fd->write_fifo[FLASH_ASYNC_WRITE]);
+}
+
+/*
+ * Background writes are held back while foreground reads are too slow.
+ * Once no foreground read has completed for a while the average is stale
+ * and is no reason to hold anything back.
+ */
+static inline int flash_bg_throttled(struct flash_data *fd)
+{
+	return fd->throttling &&
+		time_before(jiffies, fd->fg_read_stamp + HZ / 5);
+}
+
+static inline int flash_bg_write_overdue(struct flash_data *fd)
+{
+	struct request *rq;
+
+	if (list_empty(&fd->bg_write_fifo))
+		return 0;
+
+	rq = rq_entry_fifo(fd->bg_write_fifo.next);
+	return time_after(jiffies, rq_fifo_time(rq) + fd->bg_write_max_delay);
+}
+
+/*
+ * Nothing is dispatched while background writes or discards are held back,
+ * and the device may have nothing else to complete that would run the
+ * queue again.  Run it once the throttle goes stale or the oldest
+ * background write becomes overdue, whichever comes first.
+ */
+static void flash_arm_throttle_timer(struct flash_data *fd)
+{
+	unsigned long expires = fd->fg_read_stamp + HZ / 5;
+
+	if (!list_empty(&fd->bg_write_fifo)) {
+		struct request *rq = rq_entry_fifo(fd->bg_write_fifo.next);
+		unsigned long overdue = rq_fifo_time(rq) +
+					fd->bg_write_max_delay + 1;
+
+		if (time_before(overdue, expires))
+			expires = overdue;
+	}
+
+	mod_timer(&fd->throttle_timer, expires);
+}
+
+static void flash_throttle_timer(unsigned long data)
+{
+	struct flash_data *fd = (struct flash_data *)data;
+
+	kblockd_schedule_work(fd->queue, &fd->unthrottle_work);
+}
+
+static void flash_unthrottle(struct work_struct *work)
+{
+	struct flash_data *fd =
+		container_of(work, struct flash_data, unthrottle_work);
+	struct request_queue *q = fd->queue;
+
+	spin_lock_irq(q->queue_lock);
+	__blk_run_queue(q);
+	spin_unlock_irq(q->queue_lock);
+}
+
+/*
+ * Pick the write a new batch is built around: the oldest expired write if
+ * there is one, otherwise the oldest sync write, otherwise the oldest
+ * async write, background writes last.  Requires a non-empty candidate.
+ */
+static struct request *flash_oldest_write(struct flash_data *fd, int bg)
+{
+	struct list_head *fifo[3] = {
+		&fd->write_fifo[FLASH_SYNC_WRITE],
+		&fd->write_fifo[FLASH_ASYNC_WRITE],
+		bg ? &fd->bg_write_fifo : NULL,
+	};
+	struct request *rq, *first = NULL, *expired = NULL;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(fifo); i++) {
+		if (!fifo[i] || list_empty(fifo[i]))
+			continue;
+
+		rq = rq_entry_fifo(fifo[i]->next);
+		if (!first)
+			first = rq;
+		if (time_after(jiffies, rq_fifo_time(rq)) &&
+		    (!expired ||
+		     time_before(rq_fifo_time(rq), rq_fifo_time(expired))))
+			expired = rq;
+	}
+
+	return expired ? expired : first;
+}
+
+/*
+ * flash_dispatch_requests selects the next request.  Reads are served in
+ * arrival order as there is no seek to save; writes go out in batches of
+ * ascending sectors within one erase-block sized region, between runs of
+ * reads; discards are only sent when nothing else is waiting.
+ */
+static int flash_dispatch_requests(struct request_queue *q, int force)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	const int reads = !list_empty(&fd->read_fifo);
+	const int discards = !list_empty(&fd->discard_fifo);
+	const int throttled = flash_bg_throttled(fd) && !force;
+	int writes = flash_writes_queued(fd);
+	int bg = 0;
+	struct request *rq, *prev;
+
+	/*
+	 * background writes count as writes unless they are being held
+	 * back, in which case they only go to an idle device or once
+	 * they have waited too long
+	 */
+	if (!list_empty(&fd->bg_write_fifo)) {
+		if (!throttled)
+			bg = 1;
+		else if (flash_bg_write_overdue(fd) ||
+			 (!reads && !writes && !queue_in_flight(q)))
+			bg = 2;
+	}
+
+	/*
+	 * keep going with the current write batch while it stays in its
+	 * region
+	 */
+	rq = fd->next_write;
+	if (rq && fd->batching < fd->write_batch &&
+	    flash_region(fd, rq) == fd->batch_region &&
+	    (flash_queue(rq) != FLASH_BG_WRITE || bg))
+		goto dispatch_write;
+	fd->next_write = NULL;
+
+	if (flash_fifo_expired(&fd->discard_fifo)) {
+		fd->expired++;
+		goto dispatch_discard;
+	}
+
+	if (bg == 2) {
+		if (flash_bg_write_overdue(fd))
+			fd->expired++;
+		goto start_write_batch;
+	}
+
+	if (writes || bg) {
+		if (flash_write_expired(fd) ||
+		    (bg && flash_fifo_expired(&fd->bg_write_fifo))) {
+			fd->expired++;
+			goto start_write_batch;
+		}
+		if (!reads || fd->starved >= fd->writes_starved)
+			goto start_write_batch;
+	}
+
+	if (reads) {
+		if (writes || bg || discards)
+			fd->starved++;
+		flash_move_to_dispatch(fd, rq_entry_fifo(fd->read_fifo.next));
+		return 1;
+	}
+
+	if (discards && !throttled)
+		goto dispatch_discard;
+
+	if (throttled && (discards || !list_empty(&fd->bg_write_fifo)))
+		flash_arm_throttle_timer(fd);
+
+	return 0;
+
+dispatch_discard:
+	flash_move_to_dispatch(fd, rq_entry_fifo(fd->discard_fifo.next));
+	return 1;
+
+start_write_batch:
+	/*
+	 * start from the lowest queued sector in the region of the write
+	 * that has waited longest
+	 */
+	flash_update_region(fd, q);
+	rq = flash_oldest_write(fd, bg);
+	fd->batch_region = flash_region(fd, rq);
+	while ((prev = flash_former_request(rq)) &&
+	       flash_region(fd, prev) == fd->batch_region)
+		rq = prev;
+
+	fd->batching = 0;
+	fd->starved = 0;
+	fd->write_batches++;
+
+dispatch_write:
+	fd->batching++;
+	fd->next_write = flash_latter_request(rq);
+	flash_move_to_dispatch(fd, rq);
+
+	return 1;
+}
+
+static int
+flash_set_request(struct request_queue *q, struct request *rq, gfp_t gfp_mask)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	long class = flash_task_class(fd, rq_data_dir(rq), rq_is_sync(rq));
+
+	rq->elevator_private[0] = (void *)class;
+	return 0;
+}
+
+static void flash_completed_request(struct request_queue *q,
+				    struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	struct flash_lat_stat *st;
+	int class = flash_rq_class(rq);
+	int dir = rq_data_dir(rq);
+	int throttle;
+	u32 lat;
+
+	if (rq->cmd_flags & REQ_DISCARD)
+		return;
+
+	lat = flash_now_us() - (u32)(unsigned long)rq->elevator_private[1];
+
+	st = &fd->lat[class][dir];
+	st->count++;
+	st->total_us += lat;
+	if (lat > st->max_us)
+		st->max_us = lat;
+
+	if (class != FLASH_FG || dir != READ)
+		return;
+
+	/* moving average over roughly the last eight reads */
+	fd->fg_read_lat += ((s32)(lat - fd->fg_read_lat)) / 8;
+	fd->fg_read_stamp = jiffies;
+
+	throttle = fd->latency_target && fd->fg_read_lat > fd->latency_target;
+	if (throttle && !fd->throttling)
+		fd->throttle_events++;
+	fd->throttling = throttle;
+}
+
+static void flash_exit_queue(struct elevator_queue *e)
+{
+	struct flash_data *fd = e->elevator_data;
+
+	del_timer_sync(&fd->throttle_timer);
+	cancel_work_sync(&fd->unthrottle_work);
+
+	BUG_ON(!list_empty(&fd->read_fifo));
+	BUG_ON(!list_empty(&fd->write_fifo[FLASH_SYNC_WRITE]));
+	BUG_ON(!list_empty(&fd->write_fifo[FLASH_ASYNC_WRITE]));
+	BUG_ON(!list_empty(&fd->bg_write_fifo));
+	BUG_ON(!list_empty(&fd->discard_fifo));
+
+	kfree(fd);
+}
+
+/*
+ * initialize elevator private data (flash_data).
+ */
+static void *flash_init_queue(struct request_queue *q)
+{
+	struct flash_data *fd;
+	int i;
+
+	fd = kmalloc_node(sizeof(*fd), GFP_KERNEL | __GFP_ZERO, q->node);
+	if (!fd)
+		return NULL;
+
+	for (i = 0; i < FLASH_NR_QUEUES; i++)
+		fd->sort_list[i] = RB_ROOT;
+	INIT_LIST_HEAD(&fd->read_fifo);
+	INIT_LIST_HEAD(&fd->write_fifo[FLASH_SYNC_WRITE]);
+	INIT_LIST_HEAD(&fd->write_fifo[FLASH_ASYNC_WRITE]);
+	INIT_LIST_HEAD(&fd->bg_write_fifo);
+	INIT_LIST_HEAD(&fd->discard_fifo);
+	fd->queue = q;
+	setup_timer(&fd->throttle_timer, flash_throttle_timer,
+		    (unsigned long)fd);
+	INIT_WORK(&fd->unthrottle_work, flash_unthrottle);
+	fd->write_expire[FLASH_SYNC_WRITE] = sync_write_expire;
+	fd->write_expire[FLASH_ASYNC_WRITE] = async_write_expire;
+	fd->discard_expire = discard_expire;
+	fd->writes_starved = writes_starved;
+	fd->write_batch = write_batch;
+	fd->front_merges = 1;
+	fd->latency_target = latency_target;
+	fd->bg_write_max_delay = bg_write_max_delay;
+	fd->bg_writeback = 1;
+	flash_update_region(fd, q);
+	return fd;
+}
+
+/*
+ * sysfs parts below
+ */
+
+static ssize_t
+flash_var_show(int var, char *page)
+{
+	return sprintf(page, "%d\n", var);
+}
+
+static ssize_t
+flash_var_store(int *var, const char *page, size_t count)
+{
+	char *p = (char *) page;
+
+	*var = simple_strtol(p, &p, 10);
+	return count;
+}
+
+#define SHOW_FUNCTION(__FUNC, __VAR, __CONV)				\
+static ssize_t __FUNC(struct elevator_queue *e, char *page)		\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data = __VAR;						\
+	if (__CONV)							\
+		__data = jiffies_to_msecs(__data);			\
+	return flash_var_show(__data, (page));				\
+}
+SHOW_FUNCTION(flash_sync_write_expire_show, fd->write_expire[FLASH_SYNC_WRITE], 1);
+SHOW_FUNCTION(flash_async_write_expire_show, fd->write_expire[FLASH_ASYNC_WRITE], 1);
+SHOW_FUNCTION(flash_discard_expire_show, fd->discard_expire, 1);
+SHOW_FUNCTION(flash_writes_starved_show, fd->writes_starved, 0);
+SHOW_FUNCTION(flash_write_batch_show, fd->write_batch, 0);
+SHOW_FUNCTION(flash_front_merges_show, fd->front_merges, 0);
+SHOW_FUNCTION(flash_region_kb_show, fd->region_kb, 0);
+SHOW_FUNCTION(flash_latency_target_us_show, fd->latency_target, 0);
+SHOW_FUNCTION(flash_bg_write_max_delay_show, fd->bg_write_max_delay, 1);
+SHOW_FUNCTION(flash_bg_writeback_show, fd->bg_writeback, 0);
+#undef SHOW_FUNCTION
+
+#define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
+static ssize_t __FUNC(struct elevator_queue *e, const char *page, size_t count)	\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data;							\
+	int ret = flash_var_store(&__data, (page), count);		\
+	if (__data < (MIN))						\
+		__data = (MIN);						\
+	else if (__data > (MAX))					\
+		__data = (MAX);						\
+	if (__CONV)							\
+		*(__PTR) = msecs_to_jiffies(__data);			\
+	else								\
+		*(__PTR) = __data;					\
+	return ret;							\
+}
+STORE_FUNCTION(flash_sync_write_expire_store, &fd->write_expire[FLASH_SYNC_WRITE], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_async_write_expire_store, &fd->write_expire[FLASH_ASYNC_WRITE], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_discard_expire_store, &fd->discard_expire, 0, INT_MAX, 1);
+STORE_FUNCTION(flash_writes_starved_store, &fd->writes_starved, 0, INT_MAX, 0);
+STORE_FUNCTION(flash_write_batch_store, &fd->write_batch, 1, INT_MAX, 0);
+STORE_FUNCTION(flash_front_merges_store, &fd->front_merges, 0, 1, 0);
+STORE_FUNCTION(flash_latency_target_us_store, &fd->latency_target, 0, INT_MAX, 0);
+STORE_FUNCTION(flash_bg_write_max_delay_store, &fd->bg_write_max_delay, 0, INT_MAX, 1);
+STORE_FUNCTION(flash_bg_writeback_store, &fd->bg_writeback, 0, 1, 0);
+#undef STORE_FUNCTION
+
+/* Regions are found by shifting, so their size must be a power of 2 */
+static ssize_t flash_region_kb_store(struct elevator_queue *e,
+				     const char *page, size_t count)
+{
+	struct flash_data *fd = e->elevator_data;
+	int data;
+	int ret = flash_var_store(&data, page, count);
+
+	if (data < 0 || data > FLASH_MAX_REGION_KB ||
+	    (data && !is_power_of_2(data)))
+		return -EINVAL;
+	fd->region_kb = data;
+	return ret;
+}
+
+static ssize_t flash_stats_show(struct elevator_queue *e, char *page)
+{
+	struct flash_data *fd = e->elevator_data;
+
+	return sprintf(page, "%lu %lu %lu %lu %lu %lu %lu\n",
+		       fd->dispatched[FLASH_READ], fd->dispatched[FLASH_WRITE],
+		       fd->dispatched[FLASH_DISCARD], fd->write_batches,
+		       fd->expired, fd->dispatched[FLASH_BG_WRITE],
+		       fd->throttle_events);
+}
+
+static ssize_t flash_latency_show(struct elevator_queue *e, char *page)
+{
+	static const char *class_name[FLASH_NR_CLASSES] = { "fg", "bg" };
+	static const char *dir_name[2] = { "read", "write" };
+	struct flash_data *fd = e->elevator_data;
+	char *p = page;
+	int class, dir;
+
+	p += sprintf(p, "%-9s %10s %10s %10s\n",
+		     "class", "count", "avg_us", "max_us");
+	for (class = 0; class < FLASH_NR_CLASSES; class++) {
+		for (dir = 0; dir < 2; dir++) {
+			struct flash_lat_stat *st = &fd->lat[class][dir];
+
+			p += sprintf(p, "%s %-6s %10lu %10llu %10u\n",
+				     class_name[class], dir_name[dir],
+				     st->count,
+				     st->count ? div_u64(st->total_us,
+							 st->count) : 0,
+				     st->max_us);
+		}
+	}
+	p += sprintf(p, "fg_read_avg_us %u throttling %d\n",
+		     fd->fg_read_lat, flash_bg_throttled(fd));
+
+	return p - page;
+}
+
+#define FD_ATTR(name) \
+	__ATTR(name, S_IRUGO|S_IWUSR, flash_##name##_show, \
+				      flash_##name##_store)
+
+static struct elv_fs_entry flash_attrs[] = {
+	FD_ATTR(sync_write_expire),
+	FD_ATTR(async_write_expire),
+	FD_ATTR(discard_expire),
+	FD_ATTR(writes_starved),
+	FD_ATTR(write_batch),
+	FD_ATTR(front_merges),
+	FD_ATTR(region_kb),
+	FD_ATTR(latency_target_us),
+	FD_ATTR(bg_write_max_delay),
+	FD_ATTR(bg_writeback),
+	__ATTR(stats, S_IRUGO, flash_stats_show, NULL),
+	__ATTR(latency, S_IRUGO, flash_latency_show, NULL),
+	__ATTR_NULL
+};
+
+static struct elevator_type iosched_flash = {
+	.ops = {
+		.elevator_merge_fn = 		flash_merge,
+		.elevator_allow_merge_fn =	flash_allow_merge,
+		.elevator_merged_fn =		flash_merged_request,
+		.elevator_merge_req_fn =	flash_merged_requests,
+		.elevator_dispatch_fn =		flash_dispatch_requests,
+		.elevator_add_req_fn =		flash_add_request,
+		.elevator_completed_req_fn =	flash_completed_request,
+		.elevator_set_req_fn =		flash_set_request,
+		.elevator_former_req_fn =	elv_rb_former_request,
+		.elevator_latter_req_fn =	elv_rb_latter_request,
+		.elevator_init_fn =		flash_init_queue,
+		.elevator_exit_fn =		flash_exit_queue,
+	},
+
+	.elevator_attrs = flash_attrs,
+	.elevator_name = "flash",
+	.elevator_owner = THIS_MODULE,
+};
+
+static int __init flash_init(void)
+{
+	elv_register(&iosched_flash);
+
+	return 0;
+}
+
+static void __exit flash_exit(void)
+{
+	elv_unregister(&iosched_flash);
+}
+
+module_init(flash_init);
+module_exit(flash_exit);
+
+MODULE_AUTHOR("Meizu Technology Co.Ltd");
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("flash IO scheduler");
@@ -464,13 +464,17 @@ void dpm_resume_noirq(pm_message_t state)
 	mutex_lock(&dpm_list_mtx);
 	while (!list_empty(&dpm_noirq_list)) {
 		struct device *dev = to_device(dpm_noirq_list.next);
+		ktime_t start;
 		int error;
 
 		get_device(dev);
 		list_move_tail(&dev->power.entry, &dpm_suspended_list);
 		mutex_unlock(&dpm_list_mtx);
 
+		start = ktime_get();
 		error = device_resume_noirq(dev, state);
+		suspend_prof_record(SUSPEND_PROF_DEV_RESUME_NOIRQ, dev_name(dev),
+				    NULL, start);
 		if (error)
 			pm_dev_err(dev, state, " early", error);
 
@@ -511,12 +515,14 @@ static int legacy_resume(struct device *dev, int (*cb)(struct device *dev))
  */
 static int device_resume(struct device *dev, pm_message_t state, bool async)
 {
+	ktime_t start;
 	int error = 0;
 
 	TRACE_DEVICE(dev);
 	TRACE_RESUME(0);
 
 	dpm_wait(dev->parent, async);
+	start = ktime_get();
 	device_lock(dev);
 
 	/*
@@ -563,6 +569,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 	}
 
  End:
+	suspend_prof_record(SUSPEND_PROF_DEV_RESUME, dev_name(dev), NULL, start);
 	dev->power.is_suspended = false;
 
  Unlock:
@@ -590,6 +597,26 @@ static bool is_async(struct device *dev)
 		&& !pm_trace_is_enabled();
 }
 
+static int dpm_has_child_fn(struct device *dev, void *data)
+{
+	return 1;
+}
+
+/*
+ * Nothing in the device tree waits for a device without children, so with
+ * pm_async_leaves set such devices are resumed asynchronously even if their
+ * drivers have not opted in with device_enable_async_suspend().
+ */
+static bool is_async_resume(struct device *dev)
+{
+	if (is_async(dev))
+		return true;
+
+	return pm_async_leaves_enabled && pm_async_enabled
+		&& !pm_trace_is_enabled()
+		&& !device_for_each_child(dev, NULL, dpm_has_child_fn);
+}
+
 /**
  *	dpm_drv_timeout - Driver suspend / resume watchdog handler
  *	@data: struct device which timed out
@@ -634,7 +661,8 @@ void dpm_resume(pm_message_t state)
 
 	list_for_each_entry(dev, &dpm_suspended_list, power.entry) {
 		INIT_COMPLETION(dev->power.completion);
-		if (is_async(dev)) {
+		dev->power.async_resume = is_async_resume(dev);
+		if (dev->power.async_resume) {
 			get_device(dev);
 			async_schedule(async_resume, dev);
 		}
@@ -643,7 +671,7 @@ void dpm_resume(pm_message_t state)
 	while (!list_empty(&dpm_suspended_list)) {
 		dev = to_device(dpm_suspended_list.next);
 		get_device(dev);
-		if (!is_async(dev)) {
+		if (!dev->power.async_resume) {
 			int error;
 
 			mutex_unlock(&dpm_list_mtx);
@@ -816,11 +844,15 @@ int dpm_suspend_noirq(pm_message_t state)
 	mutex_lock(&dpm_list_mtx);
 	while (!list_empty(&dpm_suspended_list)) {
 		struct device *dev = to_device(dpm_suspended_list.prev);
+		ktime_t start;
 
 		get_device(dev);
 		mutex_unlock(&dpm_list_mtx);
 
+		start = ktime_get();
 		error = device_suspend_noirq(dev, state);
+		suspend_prof_record(SUSPEND_PROF_DEV_SUSPEND_NOIRQ, dev_name(dev),
+				    NULL, start);
 
 		mutex_lock(&dpm_list_mtx);
 		if (error) {
@@ -874,8 +906,10 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 	int error = 0;
 	struct timer_list timer;
 	struct dpm_drv_wd_data data;
+	ktime_t start;
 
 	dpm_wait_for_children(dev, async);
+	start = ktime_get();
 
 	data.dev = dev;
 	data.tsk = get_current();
@@ -930,6 +964,7 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 	}
 
  End:
+	suspend_prof_record(SUSPEND_PROF_DEV_SUSPEND, dev_name(dev), NULL, start);
 	dev->power.is_suspended = !error;
 
  Unlock:
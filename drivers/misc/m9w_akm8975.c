@@ -1013,6 +1013,7 @@ int akm8975_probe(struct i2c_client *client,
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
     akm->early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN;
+    akm->early_suspend.async = true;
     akm->early_suspend.suspend = akm8975_early_suspend;
     akm->early_suspend.resume = akm8975_late_resume;
     register_early_suspend(&akm->early_suspend);
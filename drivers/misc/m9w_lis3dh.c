@@ -900,6 +900,7 @@ static int lis3dh_probe(struct i2c_client *client, const struct i2c_device_id *i
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
     lis3dh->early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN;
+    lis3dh->early_suspend.async = true;
     lis3dh->early_suspend.suspend = lis3dh_early_suspend;
     lis3dh->early_suspend.resume = lis3dh_late_resume;
     register_early_suspend(&lis3dh->early_suspend);
@@ -745,6 +745,82 @@ static int mmc_test_simple_transfer(struct mmc_test_card *test,
 	return mmc_test_check_result(test, &mrq);
 }
 
+struct mmc_test_async_req {
+	struct mmc_async_req areq;
+	struct mmc_test_card *test;
+};
+
+static void mmc_test_nonblock_reset(struct mmc_request *mrq,
+				    struct mmc_command *cmd,
+				    struct mmc_command *stop,
+				    struct mmc_data *data)
+{
+	memset(mrq, 0, sizeof(struct mmc_request));
+	memset(cmd, 0, sizeof(struct mmc_command));
+	memset(data, 0, sizeof(struct mmc_data));
+	memset(stop, 0, sizeof(struct mmc_command));
+
+	mrq->cmd = cmd;
+	mrq->data = data;
+	mrq->stop = stop;
+}
+
+static int mmc_test_check_result_async(struct mmc_card *card,
+				       struct mmc_async_req *areq)
+{
+	struct mmc_test_async_req *test_async =
+		container_of(areq, struct mmc_test_async_req, areq);
+
+	mmc_test_wait_busy(test_async->test);
+
+	return mmc_test_check_result(test_async->test, areq->mrq);
+}
+
+/*
+ * Do @count consecutive transfers, starting each one with mmc_start_req()
+ * while the previous one is still in flight.
+ */
+static int mmc_test_nonblock_transfer(struct mmc_test_card *test,
+				      struct scatterlist *sg, unsigned sg_len,
+				      unsigned dev_addr, unsigned blocks,
+				      unsigned blksz, int write, int count)
+{
+	struct mmc_request mrq[2];
+	struct mmc_command cmd[2];
+	struct mmc_command stop[2];
+	struct mmc_data data[2];
+	struct mmc_test_async_req test_areq[2];
+	struct mmc_async_req *done_areq;
+	int i, cur = 0;
+	int ret = 0;
+
+	for (i = 0; i < 2; i++) {
+		mmc_test_nonblock_reset(&mrq[i], &cmd[i], &stop[i], &data[i]);
+		test_areq[i].test = test;
+		test_areq[i].areq.mrq = &mrq[i];
+		test_areq[i].areq.err_check = mmc_test_check_result_async;
+	}
+
+	for (i = 0; i < count; i++) {
+		mmc_test_prepare_mrq(test, &mrq[cur], sg, sg_len, dev_addr,
+				     blocks, blksz, write);
+		done_areq = mmc_start_req(test->card->host,
+					  &test_areq[cur].areq, &ret);
+		if (ret || (!done_areq && i > 0))
+			return ret ? ret : RESULT_FAIL;
+
+		/* The other request is done with, get it ready for reuse */
+		cur = !cur;
+		mmc_test_nonblock_reset(&mrq[cur], &cmd[cur], &stop[cur],
+					&data[cur]);
+		dev_addr += blocks;
+	}
+
+	mmc_start_req(test->card->host, NULL, &ret);
+
+	return ret;
+}
+
 /*
  * Tests a transfer where the card will fail completely or partly
  */
@@ -1954,6 +2030,70 @@ static int mmc_test_large_seq_write_perf(struct mmc_test_card *test)
 	return mmc_test_large_seq_perf(test, 1);
 }
 
+/*
+ * Consecutive transfers of each size, waiting for every request to
+ * complete before starting the next (blocking) or overlapping the set up
+ * of the next request with the transfer of the current one (non-blocking).
+ */
+static int mmc_test_rw_perf(struct mmc_test_card *test, int write,
+			    int nonblock)
+{
+	struct mmc_test_area *t = &test->area;
+	struct timespec ts1, ts2;
+	unsigned long sz;
+	unsigned int dev_addr, cnt, i;
+	int ret = 0;
+
+	for (sz = 4096; sz <= t->max_tfr; sz <<= 1) {
+		cnt = min_t(unsigned long, t->max_sz / sz, 1024);
+		dev_addr = t->dev_addr;
+
+		ret = mmc_test_area_map(test, sz, 0);
+		if (ret)
+			return ret;
+
+		getnstimeofday(&ts1);
+		if (nonblock) {
+			ret = mmc_test_nonblock_transfer(test, t->sg, t->sg_len,
+							 dev_addr, t->blocks,
+							 512, write, cnt);
+		} else {
+			for (i = 0; i < cnt && !ret; i++) {
+				ret = mmc_test_area_transfer(test, dev_addr,
+							     write);
+				dev_addr += sz >> 9;
+			}
+		}
+		if (ret)
+			return ret;
+		getnstimeofday(&ts2);
+
+		mmc_test_print_avg_rate(test, sz, cnt, &ts1, &ts2);
+	}
+
+	return 0;
+}
+
+static int mmc_test_blocking_read_perf(struct mmc_test_card *test)
+{
+	return mmc_test_rw_perf(test, 0, 0);
+}
+
+static int mmc_test_nonblock_read_perf(struct mmc_test_card *test)
+{
+	return mmc_test_rw_perf(test, 0, 1);
+}
+
+static int mmc_test_blocking_write_perf(struct mmc_test_card *test)
+{
+	return mmc_test_rw_perf(test, 1, 0);
+}
+
+static int mmc_test_nonblock_write_perf(struct mmc_test_card *test)
+{
+	return mmc_test_rw_perf(test, 1, 1);
+}
+
 static const struct mmc_test_case mmc_test_cases[] = {
 	{
 		.name = "Basic write (no data verification)",
@@ -2221,6 +2361,34 @@ static const struct mmc_test_case mmc_test_cases[] = {
 		.cleanup = mmc_test_area_cleanup,
 	},
 
+	{
+		.name = "Write performance with blocking req",
+		.prepare = mmc_test_area_prepare,
+		.run = mmc_test_blocking_write_perf,
+		.cleanup = mmc_test_area_cleanup,
+	},
+
+	{
+		.name = "Write performance with non-blocking req",
+		.prepare = mmc_test_area_prepare,
+		.run = mmc_test_nonblock_write_perf,
+		.cleanup = mmc_test_area_cleanup,
+	},
+
+	{
+		.name = "Read performance with blocking req",
+		.prepare = mmc_test_area_prepare_fill,
+		.run = mmc_test_blocking_read_perf,
+		.cleanup = mmc_test_area_cleanup,
+	},
+
+	{
+		.name = "Read performance with non-blocking req",
+		.prepare = mmc_test_area_prepare_fill,
+		.run = mmc_test_nonblock_read_perf,
+		.cleanup = mmc_test_area_cleanup,
+	},
+
 };
 
 static DEFINE_MUTEX(mmc_test_lock);
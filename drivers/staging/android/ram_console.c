@@ -29,6 +29,10 @@
 #include <mach/regs-clock.h>
 #include <linux/delay.h>
 #include <linux/kthread.h>
+#include <linux/workqueue.h>
+#include <linux/notifier.h>
+#include <linux/reboot.h>
+#include <linux/bitops.h>
 
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
 #include <linux/rslib.h>
@@ -117,10 +121,28 @@ static char *ram_console_par_buffer;
 static struct rs_control *ram_console_rs_decoder;
 static int ram_console_corrected_bytes;
 static int ram_console_bad_blocks;
+static int ram_console_unprotected_blocks;
 #define ECC_BLOCK_SIZE CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION_DATA_SIZE
 #define ECC_SIZE CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION_ECC_SIZE
 #define ECC_SYMSIZE CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION_SYMBOL_SIZE
 #define ECC_POLY CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION_POLYNOMIAL
+#define ECC_DELAY CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION_DELAY
+
+/*
+ * The parity is not computed when the console is written, but by
+ * ram_console_flush_ecc() a while later, or on the way down. Until then
+ * the blocks written are marked in ram_console_ecc_dirty, which lives in
+ * the buffer too: blocks still marked after a reset are not decoded, as
+ * their parity is stale. Bit ram_console_ecc_blocks stands for the
+ * header. The bitmap is only changed under the console lock, or with the
+ * other cpus stopped by a panic.
+ */
+static unsigned long *ram_console_ecc_dirty;
+static int ram_console_ecc_blocks;
+
+static void ram_console_try_flush_ecc(void);
+#else
+#define ram_console_try_flush_ecc()	do { } while (0)
 #endif
 
 #define inc_boot_reason(r)			\
@@ -167,6 +189,8 @@ void record_boot_reason(enum kmsg_dump_reason reason)
 		pr_warning("%s: Don't support this boot reason\n", __func__);
 		break;
 	}
+
+	ram_console_try_flush_ecc();
 }
 
 #define get_current_boot_reason()	(ram_console_buffer->bs.reason)
@@ -355,7 +379,7 @@ static int __init start_update_thread(void)
 #endif
 
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
-static void ram_console_encode_rs8(uint8_t *data, size_t len, uint8_t *ecc)
+static void ram_console_encode_rs8_lib(uint8_t *data, size_t len, uint8_t *ecc)
 {
 	int i;
 	uint16_t par[ECC_SIZE];
@@ -366,6 +390,100 @@ static void ram_console_encode_rs8(uint8_t *data, size_t len, uint8_t *ecc)
 		ecc[i] = par[i];
 }
 
+#if ECC_SYMSIZE == 8 && ECC_SIZE % 4 == 0
+/*
+ * encode_rs8() does galois field arithmetic for each parity symbol and
+ * shifts the whole parity for every data byte. With 8 bit symbols the
+ * feedback symbol of a data byte picks one of 256 parity updates, so
+ * those are computed once here. The parity is kept four symbols to a
+ * word, the first one in the top byte, and shifted a word at a time.
+ * The result must be the same as that of encode_rs8(): this is checked
+ * once on a test block, and encode_rs8() is used if it is not.
+ */
+#define ECC_WORDS (ECC_SIZE / 4)
+
+static uint32_t (*ram_console_ecc_table)[ECC_WORDS];
+
+static void ram_console_encode_rs8_table(uint8_t *data, size_t len,
+					 uint8_t *ecc)
+{
+	uint32_t par[ECC_WORDS] = { 0 };
+	const uint32_t *row;
+	int i, j;
+
+	for (i = 0; i < len; i++) {
+		row = ram_console_ecc_table[data[i] ^ (par[0] >> 24)];
+		for (j = 0; j < ECC_WORDS - 1; j++)
+			par[j] = ((par[j] << 8) | (par[j + 1] >> 24)) ^ row[j];
+		par[j] = (par[j] << 8) ^ row[j];
+	}
+	for (i = 0; i < ECC_SIZE; i++)
+		ecc[i] = par[i / 4] >> (24 - 8 * (i % 4));
+}
+
+static bool __init ram_console_check_ecc_table(void)
+{
+	uint8_t ecc[ECC_SIZE], ref[ECC_SIZE];
+	uint8_t *data;
+	int i;
+
+	data = kmalloc(ECC_BLOCK_SIZE, GFP_KERNEL);
+	if (data == NULL)
+		return false;
+
+	/* Distinct bytes, in an order that is not a plain count */
+	for (i = 0; i < ECC_BLOCK_SIZE; i++)
+		data[i] = i * 167 + 13;
+	ram_console_encode_rs8_table(data, ECC_BLOCK_SIZE, ecc);
+	ram_console_encode_rs8_lib(data, ECC_BLOCK_SIZE, ref);
+	kfree(data);
+
+	return !memcmp(ecc, ref, ECC_SIZE);
+}
+
+static void __init ram_console_init_ecc_table(struct rs_control *rs)
+{
+	int fb, i;
+
+	ram_console_ecc_table = kzalloc(256 * sizeof(*ram_console_ecc_table),
+					GFP_KERNEL);
+	if (ram_console_ecc_table == NULL)
+		return;
+
+	for (fb = 1; fb < 256; fb++) {
+		for (i = 0; i < ECC_SIZE; i++) {
+			uint32_t sym = rs->alpha_to[rs_modnn(rs,
+				rs->index_of[fb] + rs->genpoly[ECC_SIZE - 1 - i])];
+
+			ram_console_ecc_table[fb][i / 4] |=
+				sym << (24 - 8 * (i % 4));
+		}
+	}
+
+	if (!ram_console_check_ecc_table()) {
+		pr_err("ram_console: ecc table does not match encode_rs8, "
+		       "not using it\n");
+		kfree(ram_console_ecc_table);
+		ram_console_ecc_table = NULL;
+	}
+}
+
+static void ram_console_encode_rs8(uint8_t *data, size_t len, uint8_t *ecc)
+{
+	if (ram_console_ecc_table)
+		ram_console_encode_rs8_table(data, len, ecc);
+	else
+		ram_console_encode_rs8_lib(data, len, ecc);
+}
+#else
+static void __init ram_console_init_ecc_table(struct rs_control *rs)
+{
+}
+
+#define ram_console_encode_rs8(data, len, ecc)	\
+	ram_console_encode_rs8_lib(data, len, ecc)
+#endif
+
 static int ram_console_decode_rs8(void *data, size_t len, uint8_t *ecc)
 {
 	int i;
@@ -375,40 +493,155 @@ static int ram_console_decode_rs8(void *data, size_t len, uint8_t *ecc)
 	return decode_rs8(ram_console_rs_decoder, data, par, len,
 				NULL, 0, NULL, 0, NULL);
 }
+
+static void ram_console_encode_block(int i)
+{
+	struct ram_console_buffer *buffer = ram_console_buffer;
+	uint8_t *par = ram_console_par_buffer + i * ECC_SIZE;
+	size_t size = ECC_BLOCK_SIZE;
+
+	if (i == ram_console_ecc_blocks) {
+		ram_console_encode_rs8((uint8_t *)buffer, sizeof(*buffer), par);
+		return;
+	}
+	if ((i + 1) * ECC_BLOCK_SIZE > ram_console_buffer_size)
+		size = ram_console_buffer_size - i * ECC_BLOCK_SIZE;
+	ram_console_encode_rs8(buffer->data + i * ECC_BLOCK_SIZE, size, par);
+}
+
+#if ECC_DELAY != 0
+/*
+ * Flushes every ECC_DELAY ms, and schedules itself again.  Nothing is
+ * scheduled from the console write path: that runs under printk, and
+ * the timer and workqueue code may printk with their own locks held.
+ * The timer is deferrable, so an idle system is not woken just to find
+ * nothing to flush.
+ */
+static void ram_console_ecc_work_fn(struct work_struct *work);
+static DECLARE_DEFERRED_WORK(ram_console_ecc_work, ram_console_ecc_work_fn);
+#endif
+
+static void ram_console_mark_dirty(int i)
+{
+	__set_bit(i, ram_console_ecc_dirty);
+#if ECC_DELAY == 0
+	ram_console_encode_block(i);
+	__clear_bit(i, ram_console_ecc_dirty);
+#endif
+}
+
+/*
+ * Compute the parity of all the blocks written since the last flush.
+ * The caller holds the console lock, or the other cpus are stopped.
+ */
+static void ram_console_flush_ecc(void)
+{
+	int nbits = ram_console_ecc_blocks + 1;
+	int i;
+
+	if (!ram_console_ecc_dirty)
+		return;
+
+	for (i = find_first_bit(ram_console_ecc_dirty, nbits); i < nbits;
+	     i = find_next_bit(ram_console_ecc_dirty, nbits, i + 1)) {
+		ram_console_encode_block(i);
+		__clear_bit(i, ram_console_ecc_dirty);
+	}
+}
+
+/*
+ * Flush, the header included, if that can be done without waiting for
+ * the console. Otherwise the lock holder writes the console, and so
+ * marks the header, before it lets go.
+ */
+static void ram_console_try_flush_ecc(void)
+{
+	if (ram_console_ecc_dirty && console_trylock()) {
+		ram_console_mark_dirty(ram_console_ecc_blocks);
+		ram_console_flush_ecc();
+		console_unlock();
+	}
+}
+
+#if ECC_DELAY != 0
+static void ram_console_ecc_work_fn(struct work_struct *work)
+{
+	int nbits = ram_console_ecc_blocks + 1;
+
+	/* Unlocked peek: a block marked meanwhile waits for the next run */
+	if (find_first_bit(ram_console_ecc_dirty, nbits) < nbits) {
+		console_lock();
+		ram_console_flush_ecc();
+		console_unlock();
+	}
+	schedule_delayed_work(&ram_console_ecc_work,
+			      msecs_to_jiffies(ECC_DELAY));
+}
+#endif
+
+static int ram_console_ecc_panic(struct notifier_block *nb,
+				 unsigned long event, void *unused)
+{
+	/* The other cpus are stopped, don't wait for the console lock */
+	ram_console_flush_ecc();
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block ram_console_ecc_panic_nb = {
+	.notifier_call	= ram_console_ecc_panic,
+	.priority	= INT_MIN,
+};
+
+static int ram_console_ecc_reboot(struct notifier_block *nb,
+				  unsigned long event, void *unused)
+{
+	console_lock();
+	ram_console_flush_ecc();
+	console_unlock();
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block ram_console_ecc_reboot_nb = {
+	.notifier_call	= ram_console_ecc_reboot,
+	.priority	= INT_MIN,
+};
+
+static int __init ram_console_start_ecc(void)
+{
+	if (!ram_console_ecc_dirty)
+		return 0;
+
+	atomic_notifier_chain_register(&panic_notifier_list,
+				       &ram_console_ecc_panic_nb);
+	register_reboot_notifier(&ram_console_ecc_reboot_nb);
+#if ECC_DELAY != 0
+	schedule_delayed_work(&ram_console_ecc_work,
+			      msecs_to_jiffies(ECC_DELAY));
+#endif
+	return 0;
+}
+#else
+#define ram_console_start_ecc()	do { } while (0)
 #endif
 
 static void ram_console_update(const char *s, unsigned int count)
 {
 	struct ram_console_buffer *buffer = ram_console_buffer;
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
-	uint8_t *buffer_end = buffer->data + ram_console_buffer_size;
-	uint8_t *block;
-	uint8_t *par;
-	int size = ECC_BLOCK_SIZE;
+	int i;
 #endif
 	memcpy(buffer->data + buffer->start, s, count);
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
-	block = buffer->data + (buffer->start & ~(ECC_BLOCK_SIZE - 1));
-	par = ram_console_par_buffer +
-	      (buffer->start / ECC_BLOCK_SIZE) * ECC_SIZE;
-	do {
-		if (block + ECC_BLOCK_SIZE > buffer_end)
-			size = buffer_end - block;
-		ram_console_encode_rs8(block, size, par);
-		block += ECC_BLOCK_SIZE;
-		par += ECC_SIZE;
-	} while (block < buffer->data + buffer->start + count);
+	for (i = buffer->start / ECC_BLOCK_SIZE;
+	     i * ECC_BLOCK_SIZE < buffer->start + count; i++)
+		ram_console_mark_dirty(i);
 #endif
 }
 
 static void ram_console_update_header(void)
 {
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
-	struct ram_console_buffer *buffer = ram_console_buffer;
-	uint8_t *par;
-	par = ram_console_par_buffer +
-	      DIV_ROUND_UP(ram_console_buffer_size, ECC_BLOCK_SIZE) * ECC_SIZE;
-	ram_console_encode_rs8((uint8_t *)buffer, sizeof(*buffer), par);
+	ram_console_mark_dirty(ram_console_ecc_blocks);
 #endif
 }
 
@@ -466,8 +699,9 @@ ram_console_save_old(struct ram_console_buffer *buffer, const char *bootinfo,
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
 	uint8_t *block;
 	uint8_t *par;
-	char strbuf[80];
+	char strbuf[128];
 	int strbuf_len = 0;
+	int i = 0;
 
 	block = buffer->data;
 	par = ram_console_par_buffer;
@@ -476,6 +710,13 @@ ram_console_save_old(struct ram_console_buffer *buffer, const char *bootinfo,
 		int size = ECC_BLOCK_SIZE;
 		if (block + size > buffer->data + ram_console_buffer_size)
 			size = buffer->data + ram_console_buffer_size - block;
+		if (test_bit(i++, ram_console_ecc_dirty)) {
+			/* Written after the last parity update */
+			ram_console_unprotected_blocks++;
+			block += ECC_BLOCK_SIZE;
+			par += ECC_SIZE;
+			continue;
+		}
 		numerr = ram_console_decode_rs8(block, size, par);
 		if (numerr > 0) {
 #if 0
@@ -500,6 +741,11 @@ ram_console_save_old(struct ram_console_buffer *buffer, const char *bootinfo,
 	else
 		strbuf_len = snprintf(strbuf, sizeof(strbuf),
 				      "\nNo errors detected\n");
+	if (ram_console_unprotected_blocks && strbuf_len < sizeof(strbuf))
+		strbuf_len += snprintf(strbuf + strbuf_len,
+			sizeof(strbuf) - strbuf_len,
+			"%d blocks unchecked, written after the last parity update\n",
+			ram_console_unprotected_blocks);
 	if (strbuf_len >= sizeof(strbuf))
 		strbuf_len = sizeof(strbuf) - 1;
 	total_size += strbuf_len;
@@ -557,8 +803,11 @@ static int __init ram_console_init(struct ram_console_buffer *buffer,
 	}
 
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
-	ram_console_buffer_size -= (DIV_ROUND_UP(ram_console_buffer_size,
-						ECC_BLOCK_SIZE) + 1) * ECC_SIZE;
+	/* The parity of the blocks and the header, then the dirty bitmap */
+	ram_console_ecc_blocks = DIV_ROUND_UP(ram_console_buffer_size,
+					      ECC_BLOCK_SIZE);
+	ram_console_buffer_size -= (ram_console_ecc_blocks + 1) * ECC_SIZE +
+		(BITS_TO_LONGS(ram_console_ecc_blocks + 1) + 1) * sizeof(long);
 
 	if (ram_console_buffer_size > buffer_size) {
 		pr_err("ram_console: buffer %p, invalid size %zu, "
@@ -568,7 +817,11 @@ static int __init ram_console_init(struct ram_console_buffer *buffer,
 	}
 
 	ram_console_par_buffer = buffer->data + ram_console_buffer_size;
-
+	ram_console_ecc_blocks = DIV_ROUND_UP(ram_console_buffer_size,
+					      ECC_BLOCK_SIZE);
+	ram_console_ecc_dirty = (unsigned long *)ALIGN((unsigned long)
+		(ram_console_par_buffer +
+		 (ram_console_ecc_blocks + 1) * ECC_SIZE), sizeof(long));
 
 	/* first consecutive root is 0
 	 * primitive element to generate roots = 1
@@ -576,16 +829,20 @@ static int __init ram_console_init(struct ram_console_buffer *buffer,
 	ram_console_rs_decoder = init_rs(ECC_SYMSIZE, ECC_POLY, 0, 1, ECC_SIZE);
 	if (ram_console_rs_decoder == NULL) {
 		printk(KERN_INFO "ram_console: init_rs failed\n");
+		ram_console_ecc_dirty = NULL;
 		return 0;
 	}
+	ram_console_init_ecc_table(ram_console_rs_decoder);
 
 	ram_console_corrected_bytes = 0;
 	ram_console_bad_blocks = 0;
 
-	par = ram_console_par_buffer +
-	      DIV_ROUND_UP(ram_console_buffer_size, ECC_BLOCK_SIZE) * ECC_SIZE;
+	par = ram_console_par_buffer + ram_console_ecc_blocks * ECC_SIZE;
 
-	numerr = ram_console_decode_rs8(buffer, sizeof(*buffer), par);
+	if (test_bit(ram_console_ecc_blocks, ram_console_ecc_dirty))
+		numerr = 0;
+	else
+		numerr = ram_console_decode_rs8(buffer, sizeof(*buffer), par);
 	if (numerr > 0) {
 		printk(KERN_INFO "ram_console: error in header, %d\n", numerr);
 		ram_console_corrected_bytes += numerr;
@@ -853,6 +1110,8 @@ static int __init ram_console_late_init(void)
 	/* Whenever the old ram buffer exist, provide the boot_stat interface */
 	proc_create("boot_stat", S_IFREG | S_IRUGO, NULL, &proc_boot_stat_operations);
 
+	ram_console_start_ecc();
+
 	if (ram_console_old_log == NULL)
 		return 0;
 #ifdef CONFIG_ANDROID_RAM_CONSOLE_EARLY_INIT
@@ -0,0 +1,313 @@
+/* drivers/staging/android/ram_trace.c
+ *
+ * Persistent trace: binary records of context switches, functions and
+ * events, kept in a memory region that survives a watchdog reset.
+ *
+ * Copyright (C) 2011 Meizu Technology Co.Ltd, Zhuhai, China
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/platform_device.h>
+#include <linux/proc_fs.h>
+#include <linux/vmalloc.h>
+#include <linux/uaccess.h>
+#include <linux/sched.h>
+#include <linux/ftrace.h>
+#include <linux/percpu.h>
+#include <linux/io.h>
+#include <linux/ram_trace.h>
+#include <trace/events/sched.h>
+
+/*
+ * The ram console only keeps text, and after a watchdog reset its last
+ * lines rarely tell what the cpu was doing.  This keeps fixed size binary
+ * records instead, cheap enough to take on every context switch, or on
+ * every function entry while ram_trace.function is set.
+ *
+ * A record is claimed by incrementing ram_trace_seq, so writers never
+ * wait for each other.  The region is mapped write combining: the
+ * records go to memory without a trip through the caches, which are lost
+ * on reset.  The sequence number is written last, so a record torn by
+ * the reset is left with a sequence that does not fit its slot.
+ */
+
+static struct ram_trace_header *ram_trace_header;
+static struct ram_trace_record *ram_trace_records;
+static unsigned int ram_trace_nr;		/* power of 2 */
+static atomic_t ram_trace_seq;
+
+static void *ram_trace_old;
+static size_t ram_trace_old_size;
+
+static void notrace ram_trace_write(unsigned int event,
+				    unsigned long ip, unsigned long data)
+{
+	struct ram_trace_record *rec;
+	u32 seq;
+
+	if (unlikely(!ram_trace_records))
+		return;
+
+	seq = atomic_inc_return(&ram_trace_seq);
+	rec = ram_trace_records + (seq & (ram_trace_nr - 1));
+	rec->seq = 0;
+	wmb();
+	rec->time = sched_clock() >> 10;
+	rec->ip = ip;
+	rec->data = data;
+	rec->event = event;
+	rec->cpu = raw_smp_processor_id();
+	wmb();
+	rec->seq = seq;
+}
+
+/**
+ * ram_trace_event - add a record to the persistent trace
+ * @event: RAM_TRACE_USER or above
+ * @data: anything that fits a word
+ *
+ * The record also holds the caller's address.  Safe in any context.
+ */
+void notrace ram_trace_event(unsigned int event, unsigned long data)
+{
+	ram_trace_write(event, _RET_IP_, data);
+}
+EXPORT_SYMBOL_GPL(ram_trace_event);
+
+static void notrace ram_trace_sched_switch(void *ignore,
+		struct task_struct *prev, struct task_struct *next)
+{
+	ram_trace_write(RAM_TRACE_SCHED_SWITCH, prev->pid, next->pid);
+}
+
+static int ram_trace_sched = 1;
+static bool ram_trace_sched_on;
+
+static void ram_trace_update_sched(void)
+{
+	if (!ram_trace_records || ram_trace_sched == ram_trace_sched_on)
+		return;
+
+	if (ram_trace_sched) {
+		if (register_trace_sched_switch(ram_trace_sched_switch, NULL))
+			return;
+	} else {
+		unregister_trace_sched_switch(ram_trace_sched_switch, NULL);
+		tracepoint_synchronize_unregister();
+	}
+	ram_trace_sched_on = ram_trace_sched;
+}
+
+#ifdef CONFIG_FUNCTION_TRACER
+static DEFINE_PER_CPU(int, ram_trace_busy);
+
+/*
+ * sched_clock() is not notrace on every board, so guard against tracing
+ * ourselves. Functions called from interrupts taken meanwhile are lost.
+ */
+static void notrace ram_trace_function(unsigned long ip,
+				       unsigned long parent_ip)
+{
+	preempt_disable_notrace();
+	if (!__this_cpu_read(ram_trace_busy)) {
+		__this_cpu_write(ram_trace_busy, 1);
+		ram_trace_write(RAM_TRACE_FUNCTION, ip, parent_ip);
+		__this_cpu_write(ram_trace_busy, 0);
+	}
+	preempt_enable_notrace();
+}
+
+static struct ftrace_ops ram_trace_ops __read_mostly = {
+	.func	= ram_trace_function,
+};
+
+static int ram_trace_func;
+static bool ram_trace_func_on;
+
+static void ram_trace_update_function(void)
+{
+	if (!ram_trace_records || ram_trace_func == ram_trace_func_on)
+		return;
+
+	if (ram_trace_func) {
+		if (register_ftrace_function(&ram_trace_ops))
+			return;
+	} else {
+		unregister_ftrace_function(&ram_trace_ops);
+	}
+	ram_trace_func_on = ram_trace_func;
+}
+#else
+static int ram_trace_func;
+#define ram_trace_update_function()	do { } while (0)
+#endif
+
+static DEFINE_MUTEX(ram_trace_mutex);
+
+static int ram_trace_set(const char *val, const struct kernel_param *kp)
+{
+	int err;
+
+	mutex_lock(&ram_trace_mutex);
+	err = param_set_bool(val, kp);
+	if (!err) {
+		ram_trace_update_sched();
+		ram_trace_update_function();
+	}
+	mutex_unlock(&ram_trace_mutex);
+	return err;
+}
+
+static struct kernel_param_ops ram_trace_param_ops = {
+	.set	= ram_trace_set,
+	.get	= param_get_bool,
+};
+
+module_param_cb(sched, &ram_trace_param_ops, &ram_trace_sched, 0644);
+MODULE_PARM_DESC(sched, "Record context switches");
+module_param_cb(function, &ram_trace_param_ops, &ram_trace_func, 0644);
+MODULE_PARM_DESC(function, "Record every traced function entry");
+
+static ssize_t last_trace_read(struct file *file, char __user *buf,
+			       size_t len, loff_t *offset)
+{
+	return simple_read_from_buffer(buf, len, offset,
+				       ram_trace_old, ram_trace_old_size);
+}
+
+static const struct file_operations last_trace_fops = {
+	.owner	= THIS_MODULE,
+	.read	= last_trace_read,
+	.llseek	= default_llseek,
+};
+
+/*
+ * Copy the records of the previous boot, oldest first, after its header.
+ */
+static void __init ram_trace_save_old(struct ram_trace_record *records)
+{
+	struct ram_trace_header *old;
+	struct ram_trace_record *rec;
+	u32 seq, last = 0;
+	unsigned int i, n = 0;
+	bool found = false;
+
+	if (ram_trace_header->sig != RAM_TRACE_SIG ||
+	    ram_trace_header->nr_records != ram_trace_nr ||
+	    ram_trace_header->record_size != sizeof(*rec))
+		return;
+
+	/*
+	 * The newest record is the one with the highest seq, compared with
+	 * wrapping arithmetic.  Start from the first valid record rather
+	 * than 0, or every seq past 2^31 would look older than 0.
+	 */
+	for (i = 0; i < ram_trace_nr; i++) {
+		seq = records[i].seq;
+		if (!seq || (seq & (ram_trace_nr - 1)) != i)
+			continue;
+		if (!found || (s32)(seq - last) > 0)
+			last = seq;
+		found = true;
+	}
+	if (!found)
+		return;
+
+	ram_trace_old = vmalloc(sizeof(*old) + ram_trace_nr * sizeof(*rec));
+	if (!ram_trace_old) {
+		pr_err("ram_trace: failed to allocate buffer\n");
+		return;
+	}
+
+	old = ram_trace_old;
+	rec = (struct ram_trace_record *)(old + 1);
+	for (seq = last - ram_trace_nr + 1; seq != last + 1; seq++) {
+		struct ram_trace_record *r;
+
+		r = records + (seq & (ram_trace_nr - 1));
+		if (seq && r->seq == seq)
+			memcpy(rec + n++, r, sizeof(*r));
+	}
+
+	old->sig = RAM_TRACE_SIG;
+	old->nr_records = n;
+	old->record_size = sizeof(*rec);
+	old->seq = last + 1;
+	ram_trace_old_size = sizeof(*old) + n * sizeof(*rec);
+
+	pr_info("ram_trace: %u records of the last boot\n", n);
+}
+
+static int __init ram_trace_probe(struct platform_device *pdev)
+{
+	struct resource *res = pdev->resource;
+	struct ram_trace_record *records;
+	size_t size;
+	void *buffer;
+
+	if (res == NULL || pdev->num_resources != 1 ||
+	    !(res->flags & IORESOURCE_MEM)) {
+		pr_err("ram_trace: invalid resource\n");
+		return -ENXIO;
+	}
+	size = resource_size(res);
+	if (size < sizeof(*ram_trace_header) + sizeof(*ram_trace_records)) {
+		pr_err("ram_trace: region too small, %zu\n", size);
+		return -EINVAL;
+	}
+
+	buffer = ioremap_wc(res->start, size);
+	if (buffer == NULL) {
+		pr_err("ram_trace: failed to map memory\n");
+		return -ENOMEM;
+	}
+
+	ram_trace_header = buffer;
+	ram_trace_nr = rounddown_pow_of_two((size - sizeof(*ram_trace_header)) /
+					    sizeof(*records));
+	records = (struct ram_trace_record *)(ram_trace_header + 1);
+
+	ram_trace_save_old(records);
+	if (ram_trace_old_size)
+		proc_create("last_trace", S_IFREG | S_IRUSR, NULL,
+			    &last_trace_fops);
+
+	memset(records, 0, ram_trace_nr * sizeof(*records));
+	ram_trace_header->nr_records = ram_trace_nr;
+	ram_trace_header->record_size = sizeof(*records);
+	ram_trace_header->seq = 0;
+	wmb();
+	ram_trace_header->sig = RAM_TRACE_SIG;
+
+	/* From now on records may be written */
+	smp_wmb();
+	ram_trace_records = records;
+
+	pr_info("ram_trace: %u records at %08lx\n", ram_trace_nr,
+		(unsigned long)res->start);
+
+	mutex_lock(&ram_trace_mutex);
+	ram_trace_update_sched();
+	ram_trace_update_function();
+	mutex_unlock(&ram_trace_mutex);
+
+	return 0;
+}
+
+static struct platform_driver ram_trace_driver = {
+	.driver		= {
+		.name	= "ram_trace",
+	},
+};
+
+static int __init ram_trace_init(void)
+{
+	return platform_driver_probe(&ram_trace_driver, ram_trace_probe);
+}
+device_initcall(ram_trace_init);
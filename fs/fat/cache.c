@@ -37,6 +37,29 @@ static inline int fat_max_cache(struct inode *inode)
 
 static struct kmem_cache *fat_cache_cachep;
 
+#ifdef CONFIG_FAT_EXTENT_CACHE
+/*
+ * Large regular files also get an index of the cluster chain: a tree of
+ * extents (runs of contiguous clusters) that covers the chain from its
+ * start up to ->extent_end, without gaps.  It is filled in lazily by the
+ * walks of fat_get_cluster(), so a lookup below ->extent_end never reads
+ * the FAT, and one beyond it walks on from the last extent.  Files
+ * fragmented into more than FAT_MAX_EXTENTS pieces index only the start of
+ * their chain; the rest goes through the LRU cache as usual.
+ */
+#define FAT_EXTENT_MIN_CLUSTERS	64
+#define FAT_MAX_EXTENTS		512
+
+struct fat_extent {
+	struct rb_node rb_node;
+	int fcluster;		/* first cluster in the file */
+	int dcluster;		/* first cluster on disk */
+	int nr_clusters;
+};
+
+static struct kmem_cache *fat_extent_cachep;
+#endif
+
 static void init_once(void *foo)
 {
 	struct fat_cache *cache = (struct fat_cache *)foo;
@@ -52,11 +75,24 @@ int __init fat_cache_init(void)
 				init_once);
 	if (fat_cache_cachep == NULL)
 		return -ENOMEM;
+#ifdef CONFIG_FAT_EXTENT_CACHE
+	fat_extent_cachep = kmem_cache_create("fat_extent_cache",
+				sizeof(struct fat_extent),
+				0, SLAB_RECLAIM_ACCOUNT|SLAB_MEM_SPREAD,
+				NULL);
+	if (fat_extent_cachep == NULL) {
+		kmem_cache_destroy(fat_cache_cachep);
+		return -ENOMEM;
+	}
+#endif
 	return 0;
 }
 
 void fat_cache_destroy(void)
 {
+#ifdef CONFIG_FAT_EXTENT_CACHE
+	kmem_cache_destroy(fat_extent_cachep);
+#endif
 	kmem_cache_destroy(fat_cache_cachep);
 }
 
@@ -180,6 +216,156 @@ out:
 	spin_unlock(&MSDOS_I(inode)->cache_lru_lock);
 }
 
+#ifdef CONFIG_FAT_EXTENT_CACHE
+static inline int fat_use_extents(struct inode *inode)
+{
+	return S_ISREG(inode->i_mode) &&
+		(i_size_read(inode) >> MSDOS_SB(inode->i_sb)->cluster_bits) >=
+		FAT_EXTENT_MIN_CLUSTERS;
+}
+
+/*
+ * Find the extent holding "fclus", or the last one if "fclus" is beyond
+ * the index, and return it in "cid" like fat_cache_lookup() does.  With
+ * nothing indexed yet, "cid" is the first cluster of the file.  Returns -1
+ * if the index can't be used for "fclus".
+ */
+static int fat_extent_lookup(struct inode *inode, int fclus,
+			     struct fat_cache_id *cid,
+			     int *cached_fclus, int *cached_dclus)
+{
+	struct msdos_inode_info *i = MSDOS_I(inode);
+	struct fat_extent *ext = NULL;
+	struct rb_node *n;
+	int offset, ret = -1;
+
+	if (!fat_use_extents(inode))
+		return -1;
+
+	spin_lock(&i->cache_lru_lock);
+	if (fclus >= i->extent_end) {
+		if (i->nr_extents >= FAT_MAX_EXTENTS)
+			goto out;
+		n = rb_last(&i->extent_root);
+		if (n)
+			ext = rb_entry(n, struct fat_extent, rb_node);
+	} else {
+		n = i->extent_root.rb_node;
+		while (n) {
+			ext = rb_entry(n, struct fat_extent, rb_node);
+			if (fclus < ext->fcluster)
+				n = n->rb_left;
+			else if (fclus >= ext->fcluster + ext->nr_clusters)
+				n = n->rb_right;
+			else
+				break;
+		}
+		BUG_ON(!n);
+	}
+
+	cid->id = i->cache_valid_id;
+	if (ext) {
+		offset = min(fclus - ext->fcluster, ext->nr_clusters - 1);
+		cid->nr_contig = ext->nr_clusters - 1;
+		cid->fcluster = ext->fcluster;
+		cid->dcluster = ext->dcluster;
+		*cached_fclus = cid->fcluster + offset;
+		*cached_dclus = cid->dcluster + offset;
+	} else {
+		cid->nr_contig = 0;
+		cid->fcluster = 0;
+		cid->dcluster = i->i_start;
+	}
+	ret = 0;
+out:
+	spin_unlock(&i->cache_lru_lock);
+	return ret;
+}
+
+/* Append the run in "new" to the index, if it continues it. */
+static void fat_extent_add(struct inode *inode, struct fat_cache_id *new)
+{
+	struct msdos_inode_info *i = MSDOS_I(inode);
+	struct fat_extent *ext, *last = NULL;
+	struct rb_node *n;
+	int nr = new->nr_contig + 1;
+
+	spin_lock(&i->cache_lru_lock);
+	if (new->id != i->cache_valid_id)
+		goto out;
+
+	n = rb_last(&i->extent_root);
+	if (n)
+		last = rb_entry(n, struct fat_extent, rb_node);
+	if (last && last->fcluster == new->fcluster) {
+		BUG_ON(last->dcluster != new->dcluster);
+		if (nr > last->nr_clusters) {
+			i->extent_end += nr - last->nr_clusters;
+			last->nr_clusters = nr;
+		}
+		goto out;
+	}
+	if (new->fcluster != i->extent_end ||
+	    i->nr_extents >= FAT_MAX_EXTENTS)
+		goto out;
+	spin_unlock(&i->cache_lru_lock);
+
+	ext = kmem_cache_alloc(fat_extent_cachep, GFP_NOFS);
+	if (!ext)
+		return;
+
+	spin_lock(&i->cache_lru_lock);
+	if (new->id != i->cache_valid_id ||
+	    new->fcluster != i->extent_end ||
+	    i->nr_extents >= FAT_MAX_EXTENTS) {
+		kmem_cache_free(fat_extent_cachep, ext);
+		goto out;
+	}
+	ext->fcluster = new->fcluster;
+	ext->dcluster = new->dcluster;
+	ext->nr_clusters = nr;
+
+	/* the new extent is the rightmost one */
+	n = rb_last(&i->extent_root);
+	rb_link_node(&ext->rb_node, n, n ? &n->rb_right : &i->extent_root.rb_node);
+	rb_insert_color(&ext->rb_node, &i->extent_root);
+	i->nr_extents++;
+	i->extent_end += nr;
+out:
+	spin_unlock(&i->cache_lru_lock);
+}
+
+static void __fat_extent_inval_inode(struct inode *inode)
+{
+	struct msdos_inode_info *i = MSDOS_I(inode);
+	struct rb_node *n;
+
+	while ((n = rb_first(&i->extent_root)) != NULL) {
+		rb_erase(n, &i->extent_root);
+		kmem_cache_free(fat_extent_cachep,
+				rb_entry(n, struct fat_extent, rb_node));
+	}
+	i->nr_extents = 0;
+	i->extent_end = 0;
+}
+#else
+static inline int fat_extent_lookup(struct inode *inode, int fclus,
+				    struct fat_cache_id *cid,
+				    int *cached_fclus, int *cached_dclus)
+{
+	return -1;
+}
+
+static inline void fat_extent_add(struct inode *inode,
+				  struct fat_cache_id *new)
+{
+}
+
+static inline void __fat_extent_inval_inode(struct inode *inode)
+{
+}
+#endif
+
 /*
  * Cache invalidation occurs rarely, thus the LRU chain is not updated. It
  * fixes itself after a while.
@@ -195,6 +381,7 @@ static void __fat_cache_inval_inode(struct inode *inode)
 		i->nr_caches--;
 		fat_cache_free(cache);
 	}
+	__fat_extent_inval_inode(inode);
 	/* Update. The copy of caches before this id is discarded. */
 	i->cache_valid_id++;
 	if (i->cache_valid_id == FAT_CACHE_VALID)
@@ -222,22 +409,37 @@ static inline void cache_init(struct fat_cache_id *cid, int fclus, int dclus)
 	cid->nr_contig = 0;
 }
 
-int fat_get_cluster(struct inode *inode, int cluster, int *fclus, int *dclus)
+static inline int fat_ent_per_block(struct super_block *sb)
+{
+	return (sb->s_blocksize << 3) / MSDOS_SB(sb)->fat_bits;
+}
+
+/*
+ * Like fat_get_cluster(), and also returns in *contig how many clusters
+ * are known to follow *dclus contiguously on disk.
+ */
+static int __fat_get_cluster(struct inode *inode, int cluster,
+			     int *fclus, int *dclus, int *contig)
 {
 	struct super_block *sb = inode->i_sb;
 	const int limit = sb->s_maxbytes >> MSDOS_SB(sb)->cluster_bits;
 	struct fat_entry fatent;
 	struct fat_cache_id cid;
-	int nr;
+	sector_t reada_end = 0;
+	int nr, use_extents, reada;
 
 	BUG_ON(MSDOS_I(inode)->i_start == 0);
 
 	*fclus = 0;
 	*dclus = MSDOS_I(inode)->i_start;
+	*contig = 0;
 	if (cluster == 0)
 		return 0;
 
-	if (fat_cache_lookup(inode, cluster, &cid, fclus, dclus) < 0) {
+	use_extents = fat_extent_lookup(inode, cluster, &cid,
+					fclus, dclus) == 0;
+	if (!use_extents &&
+	    fat_cache_lookup(inode, cluster, &cid, fclus, dclus) < 0) {
 		/*
 		 * dummy, always not contiguous
 		 * This is reinitialized by cache_init(), later.
@@ -245,6 +447,11 @@ int fat_get_cluster(struct inode *inode, int cluster, int *fclus, int *dclus)
 		cache_init(&cid, -1, -1);
 	}
 
+	/* read ahead in the FAT only if the walk leaves the first block */
+	nr = min_t(loff_t, cluster,
+		   i_size_read(inode) >> MSDOS_SB(sb)->cluster_bits);
+	reada = nr - *fclus > fat_ent_per_block(sb);
+
 	fatent_init(&fatent);
 	while (*fclus < cluster) {
 		/* prevent the infinite loop of cluster chain */
@@ -257,6 +464,8 @@ int fat_get_cluster(struct inode *inode, int cluster, int *fclus, int *dclus)
 			goto out;
 		}
 
+		if (reada)
+			fat_ent_reada_chain(sb, *dclus, &reada_end);
 		nr = fat_ent_read(inode, &fatent, *dclus);
 		if (nr < 0)
 			goto out;
@@ -267,22 +476,47 @@ int fat_get_cluster(struct inode *inode, int cluster, int *fclus, int *dclus)
 			nr = -EIO;
 			goto out;
 		} else if (nr == FAT_ENT_EOF) {
-			fat_cache_add(inode, &cid);
+			if (use_extents)
+				fat_extent_add(inode, &cid);
+			else
+				fat_cache_add(inode, &cid);
 			goto out;
 		}
 		(*fclus)++;
 		*dclus = nr;
-		if (!cache_contiguous(&cid, *dclus))
-			cache_init(&cid, *fclus, *dclus);
+		if (!cache_contiguous(&cid, *dclus)) {
+			if (use_extents) {
+				unsigned int id = cid.id;
+
+				/* *dclus isn't part of the run */
+				cid.nr_contig--;
+				fat_extent_add(inode, &cid);
+				cache_init(&cid, *fclus, *dclus);
+				cid.id = id;
+			} else
+				cache_init(&cid, *fclus, *dclus);
+		}
 	}
 	nr = 0;
-	fat_cache_add(inode, &cid);
+	if (use_extents)
+		fat_extent_add(inode, &cid);
+	else
+		fat_cache_add(inode, &cid);
+	if (cid.fcluster >= 0)
+		*contig = cid.dcluster + cid.nr_contig - *dclus;
 out:
 	fatent_brelse(&fatent);
 	return nr;
 }
 
-static int fat_bmap_cluster(struct inode *inode, int cluster)
+int fat_get_cluster(struct inode *inode, int cluster, int *fclus, int *dclus)
+{
+	int contig;
+
+	return __fat_get_cluster(inode, cluster, fclus, dclus, &contig);
+}
+
+static int fat_bmap_cluster(struct inode *inode, int cluster, int *contig)
 {
 	struct super_block *sb = inode->i_sb;
 	int ret, fclus, dclus;
@@ -290,7 +524,7 @@ static int fat_bmap_cluster(struct inode *inode, int cluster)
 	if (MSDOS_I(inode)->i_start == 0)
 		return 0;
 
-	ret = fat_get_cluster(inode, cluster, &fclus, &dclus);
+	ret = __fat_get_cluster(inode, cluster, &fclus, &dclus, contig);
 	if (ret < 0)
 		return ret;
 	else if (ret == FAT_ENT_EOF) {
@@ -309,7 +543,7 @@ int fat_bmap(struct inode *inode, sector_t sector, sector_t *phys,
 	const unsigned long blocksize = sb->s_blocksize;
 	const unsigned char blocksize_bits = sb->s_blocksize_bits;
 	sector_t last_block;
-	int cluster, offset;
+	int cluster, offset, contig;
 
 	*phys = 0;
 	*mapped_blocks = 0;
@@ -338,12 +572,13 @@ int fat_bmap(struct inode *inode, sector_t sector, sector_t *phys,
 
 	cluster = sector >> (sbi->cluster_bits - sb->s_blocksize_bits);
 	offset  = sector & (sbi->sec_per_clus - 1);
-	cluster = fat_bmap_cluster(inode, cluster);
+	cluster = fat_bmap_cluster(inode, cluster, &contig);
 	if (cluster < 0)
 		return cluster;
 	else if (cluster) {
+		/* map the rest of the contiguous run in one go */
 		*phys = fat_clus_to_blknr(sbi, cluster) + offset;
-		*mapped_blocks = sbi->sec_per_clus - offset;
+		*mapped_blocks = sbi->sec_per_clus * (contig + 1) - offset;
 		if (*mapped_blocks > last_block - sector)
 			*mapped_blocks = last_block - sector;
 	}
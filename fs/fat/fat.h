@@ -6,6 +6,7 @@
 #include <linux/nls.h>
 #include <linux/fs.h>
 #include <linux/mutex.h>
+#include <linux/rbtree.h>
 #include <linux/ratelimit.h>
 #include <linux/msdos_fs.h>
 
@@ -101,6 +102,12 @@ struct msdos_inode_info {
 	int nr_caches;
 	/* for avoiding the race between fat_free() and fat_get_cluster() */
 	unsigned int cache_valid_id;
+#ifdef CONFIG_FAT_EXTENT_CACHE
+	/* extents of the first extent_end clusters, under cache_lru_lock */
+	struct rb_root extent_root;
+	int nr_extents;
+	int extent_end;
+#endif
 
 	/* NOTE: mmu_private is 64bits, so must hold ->i_mutex to access */
 	loff_t mmu_private;	/* physically allocated size */
@@ -299,6 +306,8 @@ extern int fat_ent_write(struct inode *inode, struct fat_entry *fatent,
 extern int fat_alloc_clusters(struct inode *inode, int *cluster,
 			      int nr_cluster);
 extern int fat_free_clusters(struct inode *inode, int cluster);
+extern void fat_ent_reada_chain(struct super_block *sb, int entry,
+				sector_t *reada_end);
 extern int fat_count_free_clusters(struct super_block *sb);
 
 /* fat/file.c */
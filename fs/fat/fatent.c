@@ -639,6 +639,42 @@ static void fat_ent_reada(struct super_block *sb, struct fat_entry *fatent,
 		sb_breadahead(sb, blocknr + i);
 }
 
+/* readahead window of fat_get_cluster() */
+#define FAT_CHAIN_READA_SIZE	(32 * 1024)
+
+/*
+ * A cluster chain walk reads the FAT one block at a time.  Chains of
+ * files written in one go mostly run forward through the FAT, so when the
+ * walk gets into the second half of the window read so far, read ahead
+ * the blocks behind it.  *reada_end is the end of the window, 0 at start.
+ */
+void fat_ent_reada_chain(struct super_block *sb, int entry,
+			 sector_t *reada_end)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+	struct fatent_operations *ops = sbi->fatent_ops;
+	unsigned long reada_blocks = FAT_CHAIN_READA_SIZE >> sb->s_blocksize_bits;
+	sector_t blocknr, start, end;
+	int offset, inside;
+
+	if (entry < FAT_START_ENT || sbi->max_cluster <= entry)
+		return;
+
+	ops->ent_blocknr(sb, entry, &offset, &blocknr);
+	inside = blocknr < *reada_end &&
+		 blocknr + reada_blocks + 1 >= *reada_end;
+	if (inside && blocknr + reada_blocks / 2 < *reada_end)
+		return;
+
+	/* continue the window, unless the chain jumped out of it */
+	start = inside ? *reada_end : blocknr + 1;
+	end = min_t(sector_t, blocknr + 1 + reada_blocks,
+		    sbi->fat_start + sbi->fat_length);
+	for (; start < end; start++)
+		sb_breadahead(sb, start);
+	*reada_end = end;
+}
+
 int fat_count_free_clusters(struct super_block *sb)
 {
 	struct msdos_sb_info *sbi = MSDOS_SB(sb);
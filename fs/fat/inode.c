@@ -533,6 +533,11 @@ static void init_once(void *foo)
 	ei->nr_caches = 0;
 	ei->cache_valid_id = FAT_CACHE_VALID + 1;
 	INIT_LIST_HEAD(&ei->cache_lru);
+#ifdef CONFIG_FAT_EXTENT_CACHE
+	ei->extent_root = RB_ROOT;
+	ei->nr_extents = 0;
+	ei->extent_end = 0;
+#endif
 	INIT_HLIST_NODE(&ei->i_fat_hash);
 	inode_init_once(&ei->vfs_inode);
 }
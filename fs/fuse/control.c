@@ -10,6 +10,7 @@
 
 #include <linux/init.h>
 #include <linux/module.h>
+#include <linux/slab.h>
 
 #define FUSE_CTL_SUPER_MAGIC 0x65735543
 
@@ -176,6 +177,107 @@ static ssize_t fuse_conn_congestion_threshold_write(struct file *file,
 	return ret;
 }
 
+static ssize_t fuse_conn_route_read(struct file *file, char __user *buf,
+				   size_t len, loff_t *ppos)
+{
+	struct fuse_conn *fc;
+	const char *route;
+
+	fc = fuse_ctl_file_conn_get(file);
+	if (!fc)
+		return 0;
+
+	route = fc->route == FUSE_ROUTE_INODE ? "inode\n" : "cpu\n";
+	fuse_conn_put(fc);
+
+	return simple_read_from_buffer(buf, len, ppos, route, strlen(route));
+}
+
+static ssize_t fuse_conn_route_write(struct file *file, const char __user *buf,
+				    size_t count, loff_t *ppos)
+{
+	struct fuse_conn *fc;
+	enum fuse_route route;
+	char tmp[32];
+
+	if (*ppos || count >= sizeof(tmp) - 1)
+		return -EINVAL;
+
+	if (copy_from_user(tmp, buf, count))
+		return -EINVAL;
+
+	tmp[count] = '\0';
+
+	if (sysfs_streq(tmp, "cpu"))
+		route = FUSE_ROUTE_CPU;
+	else if (sysfs_streq(tmp, "inode"))
+		route = FUSE_ROUTE_INODE;
+	else
+		return -EINVAL;
+
+	fc = fuse_ctl_file_conn_get(file);
+	if (fc) {
+		spin_lock(&fc->lock);
+		fc->route = route;
+		spin_unlock(&fc->lock);
+		fuse_conn_put(fc);
+	}
+
+	return count;
+}
+
+static ssize_t fuse_conn_channels_read(struct file *file, char __user *buf,
+				       size_t len, loff_t *ppos)
+{
+	struct fuse_conn *fc;
+	char *tmp;
+	size_t size = 0;
+	ssize_t ret;
+	unsigned i;
+
+	fc = fuse_ctl_file_conn_get(file);
+	if (!fc)
+		return 0;
+
+	tmp = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!tmp) {
+		fuse_conn_put(fc);
+		return -ENOMEM;
+	}
+
+	size += scnprintf(tmp + size, PAGE_SIZE - size,
+			  "chan open pending   answered wait_avg_us wait_max_us"
+			  " service_avg_us service_max_us\n");
+
+	spin_lock(&fc->lock);
+	for (i = 0; i < fc->num_chans; i++) {
+		struct fuse_chan *ch = fc->chans[i];
+		struct list_head *entry;
+		unsigned pending = 0;
+		u64 n = ch->answered;
+
+		list_for_each(entry, &ch->pending)
+			pending++;
+
+		size += scnprintf(tmp + size, PAGE_SIZE - size,
+				  "%4u %4u %7u %10llu %11llu %11llu %14llu %14llu\n",
+				  ch->index, ch->open, pending, n,
+				  n ? div_u64(div64_u64(ch->wait_ns, n),
+					      NSEC_PER_USEC) : 0,
+				  div_u64(ch->wait_max_ns, NSEC_PER_USEC),
+				  n ? div_u64(div64_u64(ch->service_ns, n),
+					      NSEC_PER_USEC) : 0,
+				  div_u64(ch->service_max_ns, NSEC_PER_USEC));
+	}
+	spin_unlock(&fc->lock);
+	fuse_conn_put(fc);
+
+	ret = simple_read_from_buffer(buf, len, ppos, tmp, size);
+	kfree(tmp);
+
+	return ret;
+}
+
 static const struct file_operations fuse_ctl_abort_ops = {
 	.open = nonseekable_open,
 	.write = fuse_conn_abort_write,
@@ -202,6 +304,19 @@ static const struct file_operations fuse_conn_congestion_threshold_ops = {
 	.llseek = no_llseek,
 };
 
+static const struct file_operations fuse_conn_route_ops = {
+	.open = nonseekable_open,
+	.read = fuse_conn_route_read,
+	.write = fuse_conn_route_write,
+	.llseek = no_llseek,
+};
+
+static const struct file_operations fuse_conn_channels_ops = {
+	.open = nonseekable_open,
+	.read = fuse_conn_channels_read,
+	.llseek = no_llseek,
+};
+
 static struct dentry *fuse_ctl_add_dentry(struct dentry *parent,
 					  struct fuse_conn *fc,
 					  const char *name,
@@ -266,7 +381,11 @@ int fuse_ctl_add_conn(struct fuse_conn *fc)
 				 1, NULL, &fuse_conn_max_background_ops) ||
 	    !fuse_ctl_add_dentry(parent, fc, "congestion_threshold",
 				 S_IFREG | 0600, 1, NULL,
-				 &fuse_conn_congestion_threshold_ops))
+				 &fuse_conn_congestion_threshold_ops) ||
+	    !fuse_ctl_add_dentry(parent, fc, "route", S_IFREG | 0600, 1,
+				 NULL, &fuse_conn_route_ops) ||
+	    !fuse_ctl_add_dentry(parent, fc, "channels", S_IFREG | 0400, 1,
+				 NULL, &fuse_conn_channels_ops))
 		goto err;
 
 	return 0;
@@ -15,26 +15,36 @@
 #include <linux/miscdevice.h>
 #include <linux/pagemap.h>
 #include <linux/file.h>
+#include <linux/cred.h>
 #include <linux/slab.h>
 #include <linux/pipe_fs_i.h>
 #include <linux/swap.h>
 #include <linux/splice.h>
 #include <linux/freezer.h>
+#include <linux/hash.h>
 
 MODULE_ALIAS_MISCDEV(FUSE_MINOR);
 MODULE_ALIAS("devname:fuse");
 
 static struct kmem_cache *fuse_req_cachep;
 
-static struct fuse_conn *fuse_get_conn(struct file *file)
+static struct fuse_chan *fuse_get_chan(struct file *file)
 {
 	/*
 	 * Lockless access is OK, because file->private data is set
-	 * once during mount and is valid until the file is released.
+	 * once during mount (or clone) and is valid until the file is
+	 * released.
 	 */
 	return file->private_data;
 }
 
+static struct fuse_conn *fuse_get_conn(struct file *file)
+{
+	struct fuse_chan *ch = fuse_get_chan(file);
+
+	return ch ? ch->fc : NULL;
+}
+
 static void fuse_request_init(struct fuse_req *req)
 {
 	memset(req, 0, sizeof(*req));
@@ -209,6 +219,11 @@ void fuse_put_request(struct fuse_conn *fc, struct fuse_req *req)
 		if (req->waiting)
 			atomic_dec(&fc->num_waiting);
 
+		if (req->passthrough_filp)
+			fput(req->passthrough_filp);
+		if (req->passthrough_cred)
+			put_cred(req->passthrough_cred);
+
 		if (req->stolen_file)
 			put_reserved_req(fc, req);
 		else
@@ -238,17 +253,59 @@ static u64 fuse_get_unique(struct fuse_conn *fc)
 	return fc->reqctr;
 }
 
+/* Pick the open channel a request is queued on */
+static struct fuse_chan *route_request(struct fuse_conn *fc,
+				       struct fuse_req *req)
+{
+	unsigned n = fc->num_live_chans;
+	unsigned i;
+
+	/* Only while the last channel is being released */
+	if (!n)
+		return &fc->chan0;
+	if (n == 1)
+		return fc->live_chans[0];
+
+	if (fc->route == FUSE_ROUTE_INODE && req->in.h.nodeid)
+		i = hash_32((u32) req->in.h.nodeid ^
+			    (u32) (req->in.h.nodeid >> 32), 16) % n;
+	else
+		i = raw_smp_processor_id() % n;
+
+	return fc->live_chans[i];
+}
+
+static void wake_up_live_chans(struct fuse_conn *fc)
+{
+	unsigned i;
+
+	for (i = 0; i < fc->num_live_chans; i++)
+		wake_up(&fc->live_chans[i]->waitq);
+	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
+}
+
+void fuse_wake_up_chans(struct fuse_conn *fc)
+{
+	unsigned i;
+
+	for (i = 0; i < fc->num_chans; i++)
+		wake_up_all(&fc->chans[i]->waitq);
+}
+
 static void queue_request(struct fuse_conn *fc, struct fuse_req *req)
 {
+	struct fuse_chan *ch = route_request(fc, req);
+
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		len_args(req->in.numargs, (struct fuse_arg *) req->in.args);
-	list_add_tail(&req->list, &fc->pending);
+	list_add_tail(&req->list, &ch->pending);
 	req->state = FUSE_REQ_PENDING;
+	req->queued_ns = ktime_to_ns(ktime_get());
 	if (!req->waiting) {
 		req->waiting = 1;
 		atomic_inc(&fc->num_waiting);
 	}
-	wake_up(&fc->waitq);
+	wake_up(&ch->waitq);
 	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
 }
 
@@ -262,8 +319,7 @@ void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 	if (fc->connected) {
 		fc->forget_list_tail->next = forget;
 		fc->forget_list_tail = forget;
-		wake_up(&fc->waitq);
-		kill_fasync(&fc->fasync, SIGIO, POLL_IN);
+		wake_up_live_chans(fc);
 	} else {
 		kfree(forget);
 	}
@@ -339,8 +395,7 @@ __acquires(fc->lock)
 static void queue_interrupt(struct fuse_conn *fc, struct fuse_req *req)
 {
 	list_add_tail(&req->intr_entry, &fc->interrupts);
-	wake_up(&fc->waitq);
-	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
+	wake_up_live_chans(fc);
 }
 
 static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
@@ -915,21 +970,21 @@ static int forget_pending(struct fuse_conn *fc)
 	return fc->forget_list_head.next != NULL;
 }
 
-static int request_pending(struct fuse_conn *fc)
+static int request_pending(struct fuse_conn *fc, struct fuse_chan *ch)
 {
-	return !list_empty(&fc->pending) || !list_empty(&fc->interrupts) ||
+	return !list_empty(&ch->pending) || !list_empty(&fc->interrupts) ||
 		forget_pending(fc);
 }
 
 /* Wait until a request is available on the pending list */
-static void request_wait(struct fuse_conn *fc)
+static void request_wait(struct fuse_conn *fc, struct fuse_chan *ch)
 __releases(fc->lock)
 __acquires(fc->lock)
 {
 	DECLARE_WAITQUEUE(wait, current);
 
-	add_wait_queue_exclusive(&fc->waitq, &wait);
-	while (fc->connected && !request_pending(fc)) {
+	add_wait_queue_exclusive(&ch->waitq, &wait);
+	while (fc->connected && !request_pending(fc, ch)) {
 		set_current_state(TASK_INTERRUPTIBLE);
 		if (signal_pending(current))
 			break;
@@ -939,7 +994,7 @@ __acquires(fc->lock)
 		spin_lock(&fc->lock);
 	}
 	set_current_state(TASK_RUNNING);
-	remove_wait_queue(&fc->waitq, &wait);
+	remove_wait_queue(&ch->waitq, &wait);
 }
 
 /*
@@ -1110,20 +1165,21 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 	struct fuse_req *req;
 	struct fuse_in *in;
 	unsigned reqsize;
+	struct fuse_chan *ch = fuse_get_chan(file);
 
  restart:
 	spin_lock(&fc->lock);
 	err = -EAGAIN;
 	if ((file->f_flags & O_NONBLOCK) && fc->connected &&
-	    !request_pending(fc))
+	    !request_pending(fc, ch))
 		goto err_unlock;
 
-	request_wait(fc);
+	request_wait(fc, ch);
 	err = -ENODEV;
 	if (!fc->connected)
 		goto err_unlock;
 	err = -ERESTARTSYS;
-	if (!request_pending(fc))
+	if (!request_pending(fc, ch))
 		goto err_unlock;
 
 	if (!list_empty(&fc->interrupts)) {
@@ -1133,15 +1189,17 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 	}
 
 	if (forget_pending(fc)) {
-		if (list_empty(&fc->pending) || fc->forget_batch-- > 0)
+		if (list_empty(&ch->pending) || fc->forget_batch-- > 0)
 			return fuse_read_forget(fc, cs, nbytes);
 
 		if (fc->forget_batch <= -8)
 			fc->forget_batch = 16;
 	}
 
-	req = list_entry(fc->pending.next, struct fuse_req, list);
+	req = list_entry(ch->pending.next, struct fuse_req, list);
 	req->state = FUSE_REQ_READING;
+	req->chan = ch;
+	req->read_ns = ktime_to_ns(ktime_get());
 	list_move(&req->list, &fc->io);
 
 	in = &req->in;
@@ -1607,6 +1665,22 @@ static int fuse_notify(struct fuse_conn *fc, enum fuse_notify_code code,
 	}
 }
 
+/* Account the latency of an answered request to its channel */
+static void chan_account_answer(struct fuse_chan *ch, struct fuse_req *req)
+{
+	u64 now = ktime_to_ns(ktime_get());
+	u64 wait = req->read_ns - req->queued_ns;
+	u64 service = now - req->read_ns;
+
+	ch->answered++;
+	ch->wait_ns += wait;
+	if (wait > ch->wait_max_ns)
+		ch->wait_max_ns = wait;
+	ch->service_ns += service;
+	if (service > ch->service_max_ns)
+		ch->service_max_ns = service;
+}
+
 /* Look up request on processing list by unique ID */
 static struct fuse_req *request_find(struct fuse_conn *fc, u64 unique)
 {
@@ -1725,12 +1799,16 @@ static ssize_t fuse_dev_do_write(struct fuse_conn *fc,
 
 	err = copy_out_args(cs, &req->out, nbytes);
 	fuse_copy_finish(cs);
+	if (!err && !oh.error)
+		fuse_passthrough_setup(fc, req);
 
 	spin_lock(&fc->lock);
 	req->locked = 0;
 	if (!err) {
 		if (req->aborted)
 			err = -ENOENT;
+		else if (req->chan)
+			chan_account_answer(req->chan, req);
 	} else if (!req->aborted)
 		req->out.h.error = -EIO;
 	request_end(fc, req);
@@ -1838,16 +1916,18 @@ out:
 static unsigned fuse_dev_poll(struct file *file, poll_table *wait)
 {
 	unsigned mask = POLLOUT | POLLWRNORM;
-	struct fuse_conn *fc = fuse_get_conn(file);
-	if (!fc)
+	struct fuse_chan *ch = fuse_get_chan(file);
+	struct fuse_conn *fc;
+	if (!ch)
 		return POLLERR;
 
-	poll_wait(file, &fc->waitq, wait);
+	fc = ch->fc;
+	poll_wait(file, &ch->waitq, wait);
 
 	spin_lock(&fc->lock);
 	if (!fc->connected)
 		mask = POLLERR;
-	else if (request_pending(fc))
+	else if (request_pending(fc, ch))
 		mask |= POLLIN | POLLRDNORM;
 	spin_unlock(&fc->lock);
 
@@ -1913,9 +1993,12 @@ static void end_queued_requests(struct fuse_conn *fc)
 __releases(fc->lock)
 __acquires(fc->lock)
 {
+	unsigned i;
+
 	fc->max_background = UINT_MAX;
 	flush_bg_queue(fc);
-	end_requests(fc, &fc->pending);
+	for (i = 0; i < fc->num_chans; i++)
+		end_requests(fc, &fc->chans[i]->pending);
 	end_requests(fc, &fc->processing);
 	while (forget_pending(fc))
 		kfree(dequeue_forget(fc, 1, NULL));
@@ -1964,7 +2047,7 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		end_io_requests(fc);
 		end_queued_requests(fc);
 		end_polls(fc);
-		wake_up_all(&fc->waitq);
+		fuse_wake_up_chans(fc);
 		wake_up_all(&fc->blocked_waitq);
 		kill_fasync(&fc->fasync, SIGIO, POLL_IN);
 	}
@@ -1972,16 +2055,58 @@ void fuse_abort_conn(struct fuse_conn *fc)
 }
 EXPORT_SYMBOL_GPL(fuse_abort_conn);
 
+/*
+ * Take a channel out of request routing.  Its pending requests move to
+ * another open channel, requests read through it and not answered yet are
+ * aborted.  Returns true if it was the last open channel.
+ *
+ * This function may release and reacquire fc->lock
+ */
+static bool close_chan(struct fuse_conn *fc, struct fuse_chan *ch)
+__releases(fc->lock)
+__acquires(fc->lock)
+{
+	struct fuse_req *req, *next;
+	LIST_HEAD(unanswered);
+	unsigned i;
+
+	ch->open = 0;
+	for (i = 0; i < fc->num_live_chans; i++) {
+		if (fc->live_chans[i] == ch) {
+			fc->live_chans[i] =
+				fc->live_chans[--fc->num_live_chans];
+			break;
+		}
+	}
+	if (!fc->num_live_chans)
+		return true;
+
+	list_splice_tail_init(&ch->pending, &fc->live_chans[0]->pending);
+	wake_up(&fc->live_chans[0]->waitq);
+
+	list_for_each_entry_safe(req, next, &fc->processing, list) {
+		if (req->chan == ch)
+			list_move_tail(&req->list, &unanswered);
+	}
+	end_requests(fc, &unanswered);
+
+	return false;
+}
+
 int fuse_dev_release(struct inode *inode, struct file *file)
 {
-	struct fuse_conn *fc = fuse_get_conn(file);
-	if (fc) {
+	struct fuse_chan *ch = fuse_get_chan(file);
+	if (ch) {
+		struct fuse_conn *fc = ch->fc;
+
 		spin_lock(&fc->lock);
-		fc->connected = 0;
-		fc->blocked = 0;
-		end_queued_requests(fc);
-		end_polls(fc);
-		wake_up_all(&fc->blocked_waitq);
+		if (close_chan(fc, ch)) {
+			fc->connected = 0;
+			fc->blocked = 0;
+			end_queued_requests(fc);
+			end_polls(fc);
+			wake_up_all(&fc->blocked_waitq);
+		}
 		spin_unlock(&fc->lock);
 		fuse_conn_put(fc);
 	}
@@ -1990,6 +2115,82 @@ int fuse_dev_release(struct inode *inode, struct file *file)
 }
 EXPORT_SYMBOL_GPL(fuse_dev_release);
 
+/*
+ * Add a request channel to a connection: ioctl(newfd, FUSE_DEV_IOC_CLONE,
+ * &oldfd) on a freshly opened /dev/fuse attaches it to the connection
+ * oldfd is mounted with.
+ */
+static int fuse_dev_clone(struct file *file, struct file *old)
+{
+	struct fuse_conn *fc;
+	struct fuse_chan *ch;
+	int err;
+
+	ch = kzalloc(sizeof(*ch), GFP_KERNEL);
+	if (!ch)
+		return -ENOMEM;
+
+	/* fuse_mutex orders this against fuse_fill_super() */
+	mutex_lock(&fuse_mutex);
+	err = -EINVAL;
+	/* Only a fuse device's private_data is a channel */
+	if (old->f_op != &fuse_dev_operations || file->private_data)
+		goto out_unlock;
+	fc = fuse_get_conn(old);
+	if (!fc)
+		goto out_unlock;
+
+	fuse_chan_init(ch, fc);
+	spin_lock(&fc->lock);
+	err = -ENOTCONN;
+	if (!fc->connected)
+		goto out_unlock_fc;
+	err = -EMFILE;
+	if (fc->num_chans == FUSE_MAX_CHANNELS)
+		goto out_unlock_fc;
+
+	ch->index = fc->num_chans;
+	fc->chans[fc->num_chans++] = ch;
+	fc->live_chans[fc->num_live_chans++] = ch;
+	spin_unlock(&fc->lock);
+
+	file->private_data = ch;
+	fuse_conn_get(fc);
+	mutex_unlock(&fuse_mutex);
+
+	return 0;
+
+ out_unlock_fc:
+	spin_unlock(&fc->lock);
+ out_unlock:
+	mutex_unlock(&fuse_mutex);
+	kfree(ch);
+	return err;
+}
+
+static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
+			   unsigned long arg)
+{
+	struct file *old;
+	u32 oldfd;
+	int err;
+
+	if (cmd != FUSE_DEV_IOC_CLONE)
+		return -ENOTTY;
+
+	if (get_user(oldfd, (u32 __user *) arg))
+		return -EFAULT;
+
+	old = fget(oldfd);
+	if (!old)
+		return -EINVAL;
+
+	err = fuse_dev_clone(file, old);
+	fput(old);
+
+	return err;
+}
+
 static int fuse_dev_fasync(int fd, struct file *file, int on)
 {
 	struct fuse_conn *fc = fuse_get_conn(file);
@@ -2012,6 +2213,8 @@ const struct file_operations fuse_dev_operations = {
 	.poll		= fuse_dev_poll,
 	.release	= fuse_dev_release,
 	.fasync		= fuse_dev_fasync,
+	.unlocked_ioctl	= fuse_dev_ioctl,
+	.compat_ioctl	= fuse_dev_ioctl,
 };
 EXPORT_SYMBOL_GPL(fuse_dev_operations);
 
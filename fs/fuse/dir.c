@@ -441,6 +441,10 @@ static int fuse_create_open(struct inode *dir, struct dentry *entry, int mode,
 	if (!S_ISREG(outentry.attr.mode) || invalid_nodeid(outentry.nodeid))
 		goto out_free_ff;
 
+	ff->passthrough_filp = req->passthrough_filp;
+	ff->passthrough_cred = req->passthrough_cred;
+	req->passthrough_filp = NULL;
+	req->passthrough_cred = NULL;
 	fuse_put_request(fc, req);
 	ff->fh = outopen.fh;
 	ff->nodeid = outentry.nodeid;
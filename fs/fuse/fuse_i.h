@@ -32,8 +32,14 @@
 /** It could be as large as PATH_MAX, but would that have any uses? */
 #define FUSE_NAME_MAX 1024
 
+/** Magic number of fuse superblocks */
+#define FUSE_SUPER_MAGIC 0x65735546
+
 /** Number of dentries for each connection in the control filesystem */
-#define FUSE_CTL_NUM_DENTRIES 5
+#define FUSE_CTL_NUM_DENTRIES 7
+
+/** Maximum number of request channels of a connection */
+#define FUSE_MAX_CHANNELS 16
 
 /** If the FUSE_DEFAULT_PERMISSIONS flag is given, the filesystem
     module will check permissions based on the file mode.  Otherwise no
@@ -44,6 +50,10 @@
     doing the mount will be allowed to access the filesystem */
 #define FUSE_ALLOW_OTHER         (1 << 1)
 
+/** If the FUSE_ALLOW_PASSTHROUGH flag is given, the filesystem may
+    open files in passthrough mode.  Only root may give it */
+#define FUSE_ALLOW_PASSTHROUGH   (1 << 2)
+
 /** List of active connections */
 extern struct list_head fuse_conn_list;
 
@@ -103,6 +113,7 @@ struct fuse_inode {
 };
 
 struct fuse_conn;
+struct fuse_chan;
 
 /** FUSE specific file data */
 struct fuse_file {
@@ -135,6 +146,12 @@ struct fuse_file {
 
 	/** Wait queue head for poll */
 	wait_queue_head_t poll_wait;
+
+	/** Lower file for FOPEN_PASSTHROUGH (or NULL) */
+	struct file *passthrough_filp;
+
+	/** Credentials of the daemon, used for the lower file */
+	const struct cred *passthrough_cred;
 };
 
 /** One input argument of a request */
@@ -307,6 +324,63 @@ struct fuse_req {
 
 	/** Request is stolen from fuse_file->reserved_req */
 	struct file *stolen_file;
+
+	/** Lower file from an OPEN or CREATE reply, for the fuse_file */
+	struct file *passthrough_filp;
+	const struct cred *passthrough_cred;
+
+	/** Channel the request was read through (or NULL) */
+	struct fuse_chan *chan;
+
+	/** Time the request was queued and read, in ns */
+	u64 queued_ns;
+	u64 read_ns;
+};
+
+/** How requests are spread over the channels of a connection */
+enum fuse_route {
+	/** By the CPU the request is queued on */
+	FUSE_ROUTE_CPU,
+	/** By node ID, so that requests for one inode stay in order */
+	FUSE_ROUTE_INODE,
+};
+
+/**
+ * A request channel: one open device file of a connection.  The file
+ * given to mount is the first one, FUSE_DEV_IOC_CLONE adds more.  Each
+ * channel has its own queue of pending requests and its own readers, so
+ * a multithreaded filesystem can give every thread a channel.  Interrupts
+ * and forgets are shared and read through any channel.
+ *
+ * Channels live as long as the connection.  Everything in here is
+ * protected by fuse_conn->lock.
+ */
+struct fuse_chan {
+	/** The connection */
+	struct fuse_conn *fc;
+
+	/** Index in fuse_conn->chans */
+	unsigned index;
+
+	/** The device file is open, requests are routed here */
+	unsigned open:1;
+
+	/** Requests routed to this channel, not yet read */
+	struct list_head pending;
+
+	/** Readers of the channel are waiting on this */
+	wait_queue_head_t waitq;
+
+	/** Requests answered after being read through this channel */
+	u64 answered;
+
+	/** Time between queueing and reading, total and maximum in ns */
+	u64 wait_ns;
+	u64 wait_max_ns;
+
+	/** Time between reading and the answer, total and maximum in ns */
+	u64 service_ns;
+	u64 service_max_ns;
 };
 
 /**
@@ -341,11 +415,19 @@ struct fuse_conn {
 	/** Maximum write size */
 	unsigned max_write;
 
-	/** Readers of the connection are waiting on this */
-	wait_queue_head_t waitq;
+	/** The first request channel, the device file given to mount */
+	struct fuse_chan chan0;
 
-	/** The list of pending requests */
-	struct list_head pending;
+	/** All request channels, open or not */
+	struct fuse_chan *chans[FUSE_MAX_CHANNELS];
+	unsigned num_chans;
+
+	/** Open request channels, the ones requests are routed to */
+	struct fuse_chan *live_chans[FUSE_MAX_CHANNELS];
+	unsigned num_live_chans;
+
+	/** How requests are routed to the open channels */
+	enum fuse_route route;
 
 	/** The list of requests being processed */
 	struct list_head processing;
@@ -472,6 +554,9 @@ struct fuse_conn {
 	/** Don't apply umask to creation modes */
 	unsigned dont_mask:1;
 
+	/** Filesystem may open files in passthrough mode */
+	unsigned passthrough:1;
+
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
@@ -683,6 +768,9 @@ void fuse_request_send_background_locked(struct fuse_conn *fc,
 /* Abort all requests */
 void fuse_abort_conn(struct fuse_conn *fc);
 
+/* Wake up all readers of all request channels */
+void fuse_wake_up_chans(struct fuse_conn *fc);
+
 /**
  * Invalidate inode attributes
  */
@@ -702,6 +790,11 @@ void fuse_conn_kill(struct fuse_conn *fc);
  */
 void fuse_conn_init(struct fuse_conn *fc);
 
+/**
+ * Initialize a request channel of fuse_conn
+ */
+void fuse_chan_init(struct fuse_chan *ch, struct fuse_conn *fc);
+
 /**
  * Release reference to fuse_conn
  */
@@ -763,4 +856,17 @@ int fuse_dev_release(struct inode *inode, struct file *file);
 
 void fuse_write_update_size(struct inode *inode, loff_t pos);
 
+/* passthrough.c */
+void fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_req *req);
+void fuse_passthrough_release(struct fuse_file *ff);
+ssize_t fuse_passthrough_aio_read(struct kiocb *iocb, const struct iovec *iov,
+				  unsigned long nr_segs, loff_t pos);
+ssize_t fuse_passthrough_aio_write(struct kiocb *iocb, const struct iovec *iov,
+				   unsigned long nr_segs, loff_t pos);
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+int fuse_passthrough_fsync(struct file *file, int datasync);
+ssize_t fuse_passthrough_splice_read(struct file *file, loff_t *ppos,
+				     struct pipe_inode_info *pipe, size_t len,
+				     unsigned int flags);
+
 #endif /* _FS_FUSE_I_H */
@@ -0,0 +1,227 @@
+/*
+  FUSE: Filesystem in Userspace
+  Copyright (C) 2011 Meizu Technology Co.Ltd, Zhuhai, China
+
+  This program can be distributed under the terms of the GNU GPL.
+  See the file COPYING.
+*/
+
+/*
+ * Passthrough files.
+ *
+ * A filesystem that negotiated FUSE_PASSTHROUGH may answer OPEN or CREATE
+ * with FOPEN_PASSTHROUGH and the number of a file descriptor it holds open
+ * on the file backing the fuse file (Android's sdcard daemon serves vfat or
+ * ext4 this way).  The descriptor is looked up in the daemon's own file
+ * table while its reply is written to the fuse device.  Read, write, mmap
+ * and fsync of the fuse file then go to that lower file without a round
+ * trip through the daemon or a copy through the fuse device.  Everything
+ * else, including open, flush, release and getattr, still goes through the
+ * daemon.
+ *
+ * The lower file is accessed with the credentials of the daemon, as if the
+ * daemon did the I/O itself.  Only a filesystem root mounted with the
+ * passthrough option may hand one out, and only one on a filesystem that
+ * sits directly on a block device: no procfs or sysfs file, and nothing
+ * stacked like ecryptfs.  The check is made at mount time because the
+ * daemon usually drops its capabilities once it has mounted.
+ */
+
+#include "fuse_i.h"
+
+#include <linux/file.h>
+#include <linux/cred.h>
+#include <linux/pagemap.h>
+#include <linux/splice.h>
+#include <linux/uio.h>
+
+/*
+ * Called from the fuse device write with the daemon as current, after the
+ * reply arguments have been copied in.
+ */
+void fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_req *req)
+{
+	struct fuse_open_out *outarg;
+	struct file *lower;
+	struct inode *inode;
+
+	/* Only set on mounts root gave the passthrough option */
+	if (!fc->passthrough)
+		return;
+
+	if (req->in.h.opcode == FUSE_OPEN)
+		outarg = req->out.args[0].value;
+	else if (req->in.h.opcode == FUSE_CREATE)
+		outarg = req->out.args[1].value;
+	else
+		return;
+
+	if (!(outarg->open_flags & FOPEN_PASSTHROUGH))
+		return;
+	outarg->open_flags &= ~FOPEN_PASSTHROUGH;
+
+	lower = fget(outarg->passthrough_fd);
+	if (!lower)
+		return;
+
+	/*
+	 * Only regular files of block device filesystems, and no fuseblk on
+	 * fuse: it could loop back
+	 */
+	inode = lower->f_path.dentry->d_inode;
+	if (!S_ISREG(inode->i_mode) || !inode->i_sb->s_bdev ||
+	    !(inode->i_sb->s_type->fs_flags & FS_REQUIRES_DEV) ||
+	    inode->i_sb->s_magic == FUSE_SUPER_MAGIC) {
+		fput(lower);
+		return;
+	}
+
+	req->passthrough_filp = lower;
+	req->passthrough_cred = get_current_cred();
+}
+
+void fuse_passthrough_release(struct fuse_file *ff)
+{
+	if (ff->passthrough_filp) {
+		fput(ff->passthrough_filp);
+		ff->passthrough_filp = NULL;
+	}
+	if (ff->passthrough_cred) {
+		put_cred(ff->passthrough_cred);
+		ff->passthrough_cred = NULL;
+	}
+}
+
+static ssize_t fuse_passthrough_rw(struct kiocb *iocb, const struct iovec *iov,
+				   unsigned long nr_segs, loff_t pos, int write)
+{
+	struct fuse_file *ff = iocb->ki_filp->private_data;
+	struct file *lower = ff->passthrough_filp;
+	const struct cred *old_cred;
+	unsigned long seg;
+	ssize_t ret = 0;
+
+	old_cred = override_creds(ff->passthrough_cred);
+	for (seg = 0; seg < nr_segs; seg++) {
+		ssize_t n;
+
+		if (write)
+			n = vfs_write(lower, iov[seg].iov_base,
+				      iov[seg].iov_len, &pos);
+		else
+			n = vfs_read(lower, iov[seg].iov_base,
+				     iov[seg].iov_len, &pos);
+		if (n < 0) {
+			if (!ret)
+				ret = n;
+			break;
+		}
+		ret += n;
+		if (n < iov[seg].iov_len)
+			break;
+	}
+	revert_creds(old_cred);
+
+	iocb->ki_pos = pos;
+	return ret;
+}
+
+ssize_t fuse_passthrough_aio_read(struct kiocb *iocb, const struct iovec *iov,
+				  unsigned long nr_segs, loff_t pos)
+{
+	return fuse_passthrough_rw(iocb, iov, nr_segs, pos, 0);
+}
+
+ssize_t fuse_passthrough_aio_write(struct kiocb *iocb, const struct iovec *iov,
+				   unsigned long nr_segs, loff_t pos)
+{
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file->f_path.dentry->d_inode;
+	struct fuse_file *ff = file->private_data;
+	ssize_t ret;
+
+	if (file->f_flags & O_APPEND)
+		pos = i_size_read(ff->passthrough_filp->f_path.dentry->d_inode);
+
+	ret = fuse_passthrough_rw(iocb, iov, nr_segs, pos, 1);
+	if (ret > 0) {
+		fuse_write_update_size(inode, iocb->ki_pos);
+		fuse_invalidate_attr(inode);
+		/* Other, non-passthrough opens may have the range cached */
+		if (inode->i_mapping->nrpages)
+			invalidate_inode_pages2_range(inode->i_mapping,
+				(iocb->ki_pos - ret) >> PAGE_CACHE_SHIFT,
+				(iocb->ki_pos - 1) >> PAGE_CACHE_SHIFT);
+	}
+	return ret;
+}
+
+/*
+ * Map the lower file itself, so that faults never come back to fuse.  The
+ * vma takes over a reference to the lower file and drops the one to the
+ * fuse file, like mmap_region() expects when ->mmap replaces vm_file.
+ */
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_file *ff = file->private_data;
+	struct file *lower = ff->passthrough_filp;
+	const struct cred *old_cred;
+	int err;
+
+	if (!lower->f_op || !lower->f_op->mmap)
+		return -ENODEV;
+
+	/* The daemon may have opened the lower file read-only */
+	if ((vma->vm_flags & VM_SHARED) && !(lower->f_mode & FMODE_WRITE)) {
+		if (vma->vm_flags & VM_WRITE)
+			return -EACCES;
+		vma->vm_flags &= ~VM_MAYWRITE;
+	}
+
+	get_file(lower);
+	vma->vm_file = lower;
+	old_cred = override_creds(ff->passthrough_cred);
+	err = lower->f_op->mmap(lower, vma);
+	revert_creds(old_cred);
+	if (err) {
+		vma->vm_file = file;
+		fput(lower);
+		return err;
+	}
+	fput(file);
+	return 0;
+}
+
+int fuse_passthrough_fsync(struct file *file, int datasync)
+{
+	struct fuse_file *ff = file->private_data;
+	const struct cred *old_cred;
+	int err;
+
+	old_cred = override_creds(ff->passthrough_cred);
+	err = vfs_fsync(ff->passthrough_filp, datasync);
+	revert_creds(old_cred);
+	return err;
+}
+
+/* sendfile and splice read the lower file, like do_splice_to() would */
+ssize_t fuse_passthrough_splice_read(struct file *file, loff_t *ppos,
+				     struct pipe_inode_info *pipe, size_t len,
+				     unsigned int flags)
+{
+	struct fuse_file *ff = file->private_data;
+	struct file *lower = ff->passthrough_filp;
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!(lower->f_mode & FMODE_READ))
+		return -EBADF;
+
+	old_cred = override_creds(ff->passthrough_cred);
+	if (lower->f_op && lower->f_op->splice_read)
+		ret = lower->f_op->splice_read(lower, ppos, pipe, len, flags);
+	else
+		ret = default_file_splice_read(lower, ppos, pipe, len, flags);
+	revert_creds(old_cred);
+	return ret;
+}
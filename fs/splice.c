@@ -457,6 +457,8 @@ fill_it:
 		if (unlikely(!isize || index > end_index))
 			break;
 
+		ra_page_used(&in->f_ra, page);
+
 		/*
 		 * if this is the last page, see if we need to shrink
 		 * the length and stop
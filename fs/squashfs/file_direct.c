@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2013
+ * Phillip Lougher <phillip@squashfs.org.uk>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2. See
+ * the COPYING file in the top-level directory.
+ */
+
+#include <linux/fs.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/pagemap.h>
+#include <linux/highmem.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "squashfs_fs_i.h"
+#include "squashfs.h"
+
+/*
+ * Decompress a datablock straight into the page cache pages it covers,
+ * rather than into a read_page cache entry that is then copied out.  This
+ * needs every page of the block: if one of them can't be grabbed without
+ * blocking, or is already uptodate, return 1 and leave it to the caller to
+ * go through the read_page cache.
+ */
+int squashfs_readpage_direct(struct page *target_page, u64 block, int bsize)
+{
+	struct inode *inode = target_page->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int file_end = (i_size_read(inode) - 1) >> PAGE_CACHE_SHIFT;
+	int mask = (1 << (msblk->block_log - PAGE_CACHE_SHIFT)) - 1;
+	int start_index = target_page->index & ~mask;
+	int end_index = min(start_index | mask, file_end);
+	int i, n, pages = end_index - start_index + 1, res = 1;
+	struct page **page;
+	void **pageaddr;
+
+	page = kcalloc(pages, sizeof(*page), GFP_KERNEL);
+	pageaddr = kmalloc(pages * sizeof(*pageaddr), GFP_KERNEL);
+	if (page == NULL || pageaddr == NULL)
+		goto out;
+
+	for (i = 0, n = start_index; i < pages; i++, n++) {
+		page[i] = (n == target_page->index) ? target_page :
+			grab_cache_page_nowait(target_page->mapping, n);
+		if (page[i] == NULL || (page[i] != target_page &&
+						PageUptodate(page[i]))) {
+			i++;
+			goto release_pages;
+		}
+	}
+
+	for (i = 0; i < pages; i++)
+		pageaddr[i] = kmap(page[i]);
+
+	res = squashfs_read_data(inode->i_sb, pageaddr, block, bsize, NULL,
+		pages << PAGE_CACHE_SHIFT, pages);
+
+	/* every page but the last must have been filled */
+	if (res >= 0 && res <= (pages - 1) << PAGE_CACHE_SHIFT) {
+		ERROR("datablock %llx too short, %d bytes\n", block, res);
+		res = -EIO;
+	} else if (res > 0 && res & (PAGE_CACHE_SIZE - 1))
+		memset(pageaddr[pages - 1] + (res & (PAGE_CACHE_SIZE - 1)), 0,
+			PAGE_CACHE_SIZE - (res & (PAGE_CACHE_SIZE - 1)));
+
+	for (i = 0; i < pages; i++) {
+		kunmap(page[i]);
+		if (res < 0)
+			continue;
+		flush_dcache_page(page[i]);
+		SetPageUptodate(page[i]);
+	}
+
+	if (res < 0)
+		ERROR("Unable to read page, block %llx, size %x\n", block,
+			bsize);
+	else
+		res = 0;
+
+	/* on error the target page is left locked for the caller */
+	if (res == 0)
+		unlock_page(target_page);
+	i = pages;
+
+release_pages:
+	while (i--) {
+		if (page[i] == NULL || page[i] == target_page)
+			continue;
+		unlock_page(page[i]);
+		page_cache_release(page[i]);
+	}
+out:
+	kfree(pageaddr);
+	kfree(page);
+	return res;
+}
@@ -50,10 +50,29 @@ extern void *squashfs_read_table(struct super_block *, u64, int);
 extern const struct squashfs_decompressor *squashfs_lookup_decompressor(int);
 extern void *squashfs_decompressor_init(struct super_block *, unsigned short);
 
+/* decompressor_xxx.c */
+extern void *squashfs_decompressor_create(struct squashfs_sb_info *, void *,
+				int);
+extern void squashfs_decompressor_destroy(struct squashfs_sb_info *);
+extern int squashfs_decompress(struct squashfs_sb_info *, void **,
+				struct buffer_head **, int, int, int, int, int);
+extern int squashfs_max_decompressors(void);
+
 /* export.c */
 extern __le64 *squashfs_read_inode_lookup_table(struct super_block *, u64, u64,
 				unsigned int);
 
+/* file_direct.c */
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+extern int squashfs_readpage_direct(struct page *, u64, int);
+#else
+static inline int squashfs_readpage_direct(struct page *page, u64 block,
+				int bsize)
+{
+	return 1;
+}
+#endif
+
 /* fragment.c */
 extern int squashfs_frag_lookup(struct super_block *, unsigned int, u64 *);
 extern __le64 *squashfs_read_fragment_index_table(struct super_block *,
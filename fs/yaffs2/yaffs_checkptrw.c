@@ -24,7 +24,11 @@ static int yaffs2_checkpt_space_ok(struct yaffs_dev *dev)
 	return (blocks_avail <= 0) ? 0 : 1;
 }
 
-static int yaffs_checkpt_erase(struct yaffs_dev *dev)
+/*
+ * Erase up to max_blocks checkpoint blocks, lowest numbered first, or all
+ * of them if max_blocks is negative.
+ */
+static int yaffs_checkpt_erase_blocks(struct yaffs_dev *dev, int max_blocks)
 {
 	int i;
 
@@ -34,9 +38,14 @@ static int yaffs_checkpt_erase(struct yaffs_dev *dev)
 		"checking blocks %d to %d",
 		dev->internal_start_block, dev->internal_end_block);
 
-	for (i = dev->internal_start_block; i <= dev->internal_end_block; i++) {
+	for (i = dev->internal_start_block;
+	     i <= dev->internal_end_block && max_blocks != 0; i++) {
 		struct yaffs_block_info *bi = yaffs_get_block_info(dev, i);
 		if (bi->block_state == YAFFS_BLOCK_STATE_CHECKPOINT) {
+			max_blocks--;
+			if (dev->blocks_in_checkpt > 0)
+				dev->blocks_in_checkpt--;
+
 			yaffs_trace(YAFFS_TRACE_CHECKPOINT,
 			"erasing checkpt block %d", i);
 
@@ -56,11 +65,17 @@ static int yaffs_checkpt_erase(struct yaffs_dev *dev)
 		}
 	}
 
-	dev->blocks_in_checkpt = 0;
+	if (max_blocks != 0)
+		dev->blocks_in_checkpt = 0;
 
 	return 1;
 }
 
+static int yaffs_checkpt_erase(struct yaffs_dev *dev)
+{
+	return yaffs_checkpt_erase_blocks(dev, -1);
+}
+
 static void yaffs2_checkpt_find_erased_block(struct yaffs_dev *dev)
 {
 	int i;
@@ -403,13 +418,37 @@ int yaffs_checkpt_close(struct yaffs_dev *dev)
         }
 }
 
+/*
+ * Invalidation happens on the first write after a checkpoint, so it should
+ * be quick.  Erasing the first block of the stream is enough: it is the
+ * lowest numbered checkpoint block (they are allocated upwards from
+ * internal_start_block after all old ones were erased), the reader starts
+ * from there and rejects a stream not beginning with page 1.  The others
+ * are left for yaffs2_checkpt_erase_stale() unless erased blocks are short.
+ */
 int yaffs2_checkpt_invalidate_stream(struct yaffs_dev *dev)
 {
-	/* Erase the checkpoint data */
+	int lazy = dev->n_erased_blocks >
+	    dev->param.n_reserved_blocks + dev->blocks_in_checkpt;
+
+	yaffs_trace(YAFFS_TRACE_CHECKPOINT,
+		"checkpoint invalidate of %d blocks%s",
+		dev->blocks_in_checkpt, lazy ? ", lazily" : "");
+
+	return yaffs_checkpt_erase_blocks(dev, lazy ? 1 : -1);
+}
+
+/*
+ * Erase checkpoint blocks left over by a lazy invalidation or found by a
+ * scan.  Called from the background thread.
+ */
+int yaffs2_checkpt_erase_stale(struct yaffs_dev *dev)
+{
+	if (dev->is_checkpointed || dev->blocks_in_checkpt <= 0)
+		return 0;
 
 	yaffs_trace(YAFFS_TRACE_CHECKPOINT,
-		"checkpoint invalidate of %d blocks",
-		dev->blocks_in_checkpt);
+		"erasing %d stale checkpt blocks", dev->blocks_in_checkpt);
 
 	return yaffs_checkpt_erase(dev);
 }
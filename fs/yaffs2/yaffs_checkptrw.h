@@ -30,4 +30,6 @@ int yaffs_checkpt_close(struct yaffs_dev *dev);
 
 int yaffs2_checkpt_invalidate_stream(struct yaffs_dev *dev);
 
+int yaffs2_checkpt_erase_stale(struct yaffs_dev *dev);
+
 #endif
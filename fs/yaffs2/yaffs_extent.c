@@ -0,0 +1,510 @@
+/*
+ * YAFFS: Yet Another Flash File System. A NAND-flash specific file system.
+ *
+ * Copyright (C) 2011 Meizu Technology Co.Ltd, Zhuhai, China
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include "yaffs_extent.h"
+#include "yaffs_checkptrw.h"
+#include "yaffs_trace.h"
+
+/*
+ * Extent based file chunk maps.
+ *
+ * Files written in one go (APKs, libraries, media) mostly end up in runs of
+ * consecutive NAND chunks, which the tnode tree stores one packed entry per
+ * chunk.  Such a file's map can instead be held as a sorted array of
+ * (inode_chunk, nand_chunk, n_chunks) runs: a few dozen bytes rather than a
+ * tnode per 16 chunks, and looking a chunk up is a binary search.
+ *
+ * A file is packed once it is complete (at mount and on its last writer's
+ * close) and stays packed while chunks are moved by gc or rewritten,
+ * splitting and merging runs as needed.  Once the runs would take more
+ * memory than the tnodes they replace the file goes back to a tnode tree.
+ * Checkpoints still carry tnodes; packed files have them made up on the fly.
+ *
+ * Only used with a chunk group size of one, where a tnode entry is the
+ * exact NAND chunk.
+ */
+
+/* Pack if no bigger than the tnodes, unpack once twice as big */
+#define YAFFS_EXTENT_PACK_SLACK		1
+#define YAFFS_EXTENT_UNPACK_SLACK	2
+
+static int yaffs_extent_map_bytes(int max_extents)
+{
+	return sizeof(struct yaffs_extent_map) +
+	    max_extents * sizeof(struct yaffs_extent);
+}
+
+static int yaffs_extent_worthwhile(struct yaffs_dev *dev, int n_extents,
+				   int n_groups, int slack)
+{
+	return yaffs_extent_map_bytes(n_extents) <=
+	    slack * n_groups * dev->tnode_size;
+}
+
+static void yaffs_extent_free_map(struct yaffs_dev *dev,
+				  struct yaffs_extent_map *map)
+{
+	dev->extent_bytes -= yaffs_extent_map_bytes(map->max_extents);
+	kfree(map);
+}
+
+/* Make room for n_extents, moving the map if need be */
+static struct yaffs_extent_map *yaffs_extent_reserve(struct yaffs_dev *dev,
+						     struct yaffs_extent_map
+						     *map, int n_extents)
+{
+	struct yaffs_extent_map *new_map;
+	int max_extents;
+
+	if (map && map->max_extents >= n_extents)
+		return map;
+
+	max_extents = map ? map->max_extents * 2 : 4;
+	if (max_extents < n_extents)
+		max_extents = n_extents;
+
+	new_map = kmalloc(yaffs_extent_map_bytes(max_extents), GFP_NOFS);
+	if (!new_map)
+		return NULL;
+
+	if (map) {
+		memcpy(new_map, map, yaffs_extent_map_bytes(map->n_extents));
+		yaffs_extent_free_map(dev, map);
+	} else {
+		memset(new_map, 0, sizeof(*new_map));
+	}
+	new_map->max_extents = max_extents;
+	dev->extent_bytes += yaffs_extent_map_bytes(max_extents);
+
+	return new_map;
+}
+
+/* Recount the level 0 tnodes an attached map stands for */
+static void yaffs_extent_count_groups(struct yaffs_dev *dev,
+				      struct yaffs_extent_map *map)
+{
+	struct yaffs_extent *e;
+	u32 first, last;
+	u32 prev = ~0;
+	int n = 0;
+	int i;
+
+	for (i = 0; i < map->n_extents; i++) {
+		e = &map->ext[i];
+		first = e->inode_chunk >> YAFFS_TNODES_LEVEL0_BITS;
+		last = (e->inode_chunk + e->n_chunks - 1) >>
+		    YAFFS_TNODES_LEVEL0_BITS;
+		n += last - first + 1;
+		if (first == prev)
+			n--;
+		prev = last;
+	}
+
+	dev->n_extent_groups += n - map->n_groups;
+	map->n_groups = n;
+	dev->checkpoint_blocks_required = 0;	/* force recalculation */
+}
+
+/* Index of the last extent starting at or before inode_chunk, or -1 */
+static int yaffs_extent_index(const struct yaffs_extent_map *map,
+			      u32 inode_chunk)
+{
+	int lo = 0;
+	int hi = map->n_extents - 1;
+	int found = -1;
+	int mid;
+
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		if (map->ext[mid].inode_chunk <= inode_chunk) {
+			found = mid;
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+
+	return found;
+}
+
+u32 yaffs_extent_find(const struct yaffs_extent_map *map, u32 inode_chunk)
+{
+	const struct yaffs_extent *e;
+	int i = yaffs_extent_index(map, inode_chunk);
+
+	if (i < 0)
+		return 0;
+
+	e = &map->ext[i];
+	if (inode_chunk - e->inode_chunk >= e->n_chunks)
+		return 0;
+
+	return e->nand_chunk + (inode_chunk - e->inode_chunk);
+}
+
+/* The caller has made room with yaffs_extent_reserve() */
+static void yaffs_extent_insert(struct yaffs_extent_map *map, int pos,
+				u32 inode_chunk, u32 nand_chunk, u32 n_chunks)
+{
+	memmove(&map->ext[pos + 1], &map->ext[pos],
+		(map->n_extents - pos) * sizeof(struct yaffs_extent));
+	map->ext[pos].inode_chunk = inode_chunk;
+	map->ext[pos].nand_chunk = nand_chunk;
+	map->ext[pos].n_chunks = n_chunks;
+	map->n_extents++;
+}
+
+static void yaffs_extent_remove(struct yaffs_extent_map *map, int pos)
+{
+	map->n_extents--;
+	memmove(&map->ext[pos], &map->ext[pos + 1],
+		(map->n_extents - pos) * sizeof(struct yaffs_extent));
+}
+
+/*
+ * Point inode_chunk at nand_chunk, or drop it from the map if nand_chunk
+ * is zero.
+ */
+int yaffs_extent_set(struct yaffs_obj *obj, u32 inode_chunk, u32 nand_chunk)
+{
+	struct yaffs_dev *dev = obj->my_dev;
+	struct yaffs_file_var *file_struct = &obj->variant.file_variant;
+	struct yaffs_extent_map *map = file_struct->extents;
+	struct yaffs_extent *e;
+	struct yaffs_extent *prev;
+	struct yaffs_extent *next;
+	u32 offs;
+	int i;
+
+	/*
+	 * Splitting an extent and adding one for the new chunk take two
+	 * more at most.  Make room first, so that nothing can fail once
+	 * the chunk has been taken out of the map.
+	 */
+	map = yaffs_extent_reserve(dev, map, map->n_extents + 2);
+	if (!map)
+		return YAFFS_FAIL;
+	file_struct->extents = map;
+
+	/* Take inode_chunk out of the extent holding it */
+	i = yaffs_extent_index(map, inode_chunk);
+	if (i >= 0 &&
+	    inode_chunk - map->ext[i].inode_chunk < map->ext[i].n_chunks) {
+		e = &map->ext[i];
+		offs = inode_chunk - e->inode_chunk;
+
+		if (nand_chunk && e->nand_chunk + offs == nand_chunk)
+			return YAFFS_OK;
+
+		if (e->n_chunks == 1) {
+			yaffs_extent_remove(map, i);
+		} else if (offs == 0) {
+			e->inode_chunk++;
+			e->nand_chunk++;
+			e->n_chunks--;
+		} else if (offs == e->n_chunks - 1) {
+			e->n_chunks--;
+		} else {
+			yaffs_extent_insert(map, i + 1, inode_chunk + 1,
+					    e->nand_chunk + offs + 1,
+					    e->n_chunks - offs - 1);
+			map->ext[i].n_chunks = offs;
+		}
+	}
+
+	/* Then put it back where it now lives, joining up neighbours */
+	if (nand_chunk) {
+		i = yaffs_extent_index(map, inode_chunk) + 1;
+		prev = (i > 0) ? &map->ext[i - 1] : NULL;
+		next = (i < map->n_extents) ? &map->ext[i] : NULL;
+
+		if (prev &&
+		    prev->inode_chunk + prev->n_chunks == inode_chunk &&
+		    prev->nand_chunk + prev->n_chunks == nand_chunk) {
+			prev->n_chunks++;
+			if (next &&
+			    next->inode_chunk == inode_chunk + 1 &&
+			    next->nand_chunk == nand_chunk + 1) {
+				prev->n_chunks += next->n_chunks;
+				yaffs_extent_remove(map, i);
+			}
+		} else if (next &&
+			   next->inode_chunk == inode_chunk + 1 &&
+			   next->nand_chunk == nand_chunk + 1) {
+			next->inode_chunk--;
+			next->nand_chunk--;
+			next->n_chunks++;
+		} else {
+			yaffs_extent_insert(map, i, inode_chunk, nand_chunk, 1);
+		}
+	}
+
+	yaffs_extent_count_groups(dev, map);
+
+	/* Too fragmented to be worth it any more? */
+	if (!yaffs_extent_worthwhile(dev, map->n_extents, map->n_groups,
+				     YAFFS_EXTENT_UNPACK_SLACK))
+		yaffs_extent_unpack(obj);
+
+	return YAFFS_OK;
+}
+
+static int yaffs_extent_append(struct yaffs_dev *dev,
+			       struct yaffs_extent_map **map_ptr,
+			       u32 inode_chunk, u32 nand_chunk)
+{
+	struct yaffs_extent_map *map = *map_ptr;
+	struct yaffs_extent *e;
+
+	if (map && map->n_extents > 0) {
+		e = &map->ext[map->n_extents - 1];
+		if (e->inode_chunk + e->n_chunks == inode_chunk &&
+		    e->nand_chunk + e->n_chunks == nand_chunk) {
+			e->n_chunks++;
+			return YAFFS_OK;
+		}
+	}
+
+	map = yaffs_extent_reserve(dev, map, map ? map->n_extents + 1 : 1);
+	if (!map)
+		return YAFFS_FAIL;
+	*map_ptr = map;
+
+	e = &map->ext[map->n_extents++];
+	e->inode_chunk = inode_chunk;
+	e->nand_chunk = nand_chunk;
+	e->n_chunks = 1;
+
+	return YAFFS_OK;
+}
+
+/* Walk the tnode tree in chunk order, collecting runs */
+static int yaffs_extent_collect(struct yaffs_dev *dev, struct yaffs_tnode *tn,
+				u32 level, u32 chunk_offset,
+				struct yaffs_extent_map **map_ptr)
+{
+	u32 base;
+	u32 nand_chunk;
+	int ok = YAFFS_OK;
+	int i;
+
+	if (!tn)
+		return YAFFS_OK;
+
+	if (level > 0) {
+		for (i = 0; i < YAFFS_NTNODES_INTERNAL && ok == YAFFS_OK; i++)
+			ok = yaffs_extent_collect(dev, tn->internal[i],
+						  level - 1,
+						  (chunk_offset <<
+						   YAFFS_TNODES_INTERNAL_BITS) +
+						  i, map_ptr);
+	} else {
+		base = chunk_offset << YAFFS_TNODES_LEVEL0_BITS;
+		for (i = 0; i < YAFFS_NTNODES_LEVEL0 && ok == YAFFS_OK; i++) {
+			nand_chunk = yaffs_get_group_base(dev, tn, i);
+			if (nand_chunk)
+				ok = yaffs_extent_append(dev, map_ptr,
+							 base + i, nand_chunk);
+		}
+	}
+
+	return ok;
+}
+
+static void yaffs_extent_free_tree(struct yaffs_dev *dev,
+				   struct yaffs_tnode *tn, u32 level)
+{
+	int i;
+
+	if (!tn)
+		return;
+
+	if (level > 0)
+		for (i = 0; i < YAFFS_NTNODES_INTERNAL; i++)
+			yaffs_extent_free_tree(dev, tn->internal[i], level - 1);
+
+	yaffs_free_tnode(dev, tn);
+}
+
+/* Swap a complete file's tnode tree for extents if that saves memory */
+int yaffs_extent_pack(struct yaffs_obj *obj)
+{
+	struct yaffs_dev *dev = obj->my_dev;
+	struct yaffs_file_var *file_struct = &obj->variant.file_variant;
+	struct yaffs_extent_map *map = NULL;
+
+	if (!dev->param.extent_map || dev->chunk_grp_bits ||
+	    obj->variant_type != YAFFS_OBJECT_TYPE_FILE ||
+	    file_struct->extents || !file_struct->top ||
+	    obj->deleted || obj->soft_del || obj->n_data_chunks <= 0)
+		return YAFFS_FAIL;
+
+	if (yaffs_extent_collect(dev, file_struct->top, file_struct->top_level,
+				 0, &map) != YAFFS_OK || !map) {
+		if (map)
+			yaffs_extent_free_map(dev, map);
+		return YAFFS_FAIL;
+	}
+
+	file_struct->extents = map;
+	dev->n_extent_maps++;
+	yaffs_extent_count_groups(dev, map);
+
+	if (!yaffs_extent_worthwhile(dev, map->n_extents, map->n_groups,
+				     YAFFS_EXTENT_PACK_SLACK)) {
+		yaffs_extent_free(obj);
+		return YAFFS_FAIL;
+	}
+
+	yaffs_extent_free_tree(dev, file_struct->top, file_struct->top_level);
+	file_struct->top = NULL;
+	file_struct->top_level = 0;
+
+	return YAFFS_OK;
+}
+
+/* Rebuild the tnode tree, eg. because the file got too fragmented */
+int yaffs_extent_unpack(struct yaffs_obj *obj)
+{
+	struct yaffs_dev *dev = obj->my_dev;
+	struct yaffs_file_var *file_struct = &obj->variant.file_variant;
+	struct yaffs_extent_map *map = file_struct->extents;
+	struct yaffs_file_var tree;
+	struct yaffs_extent *e;
+	struct yaffs_tnode *tn;
+	u32 j;
+	int i;
+
+	if (!map)
+		return YAFFS_OK;
+
+	memset(&tree, 0, sizeof(tree));
+	tree.top = yaffs_get_tnode(dev);
+	if (!tree.top)
+		goto fail;
+
+	for (i = 0; i < map->n_extents; i++) {
+		e = &map->ext[i];
+		for (j = 0; j < e->n_chunks; j++) {
+			tn = yaffs_add_find_tnode_0(dev, &tree,
+						    e->inode_chunk + j, NULL);
+			if (!tn)
+				goto fail;
+			yaffs_load_tnode_0(dev, tn, e->inode_chunk + j,
+					   e->nand_chunk + j);
+		}
+	}
+
+	yaffs_extent_free(obj);
+	file_struct->top = tree.top;
+	file_struct->top_level = tree.top_level;
+
+	return YAFFS_OK;
+
+fail:
+	yaffs_extent_free_tree(dev, tree.top, tree.top_level);
+	yaffs_trace(YAFFS_TRACE_ERROR,
+		"yaffs: no tnodes to unpack the map of object %d",
+		obj->obj_id);
+	return YAFFS_FAIL;
+}
+
+void yaffs_extent_free(struct yaffs_obj *obj)
+{
+	struct yaffs_dev *dev = obj->my_dev;
+	struct yaffs_extent_map *map = obj->variant.file_variant.extents;
+
+	if (!map)
+		return;
+
+	dev->n_extent_maps--;
+	dev->n_extent_groups -= map->n_groups;
+	dev->checkpoint_blocks_required = 0;	/* force recalculation */
+	yaffs_extent_free_map(dev, map);
+	obj->variant.file_variant.extents = NULL;
+}
+
+static int yaffs_extent_wr_tnode(struct yaffs_dev *dev, u32 group,
+				 struct yaffs_tnode *tn)
+{
+	u32 base_offset = group << YAFFS_TNODES_LEVEL0_BITS;
+
+	return yaffs2_checkpt_wr(dev, &base_offset, sizeof(base_offset)) ==
+	    sizeof(base_offset) &&
+	    yaffs2_checkpt_wr(dev, tn, dev->tnode_size) == dev->tnode_size;
+}
+
+/*
+ * Write a packed file's map to the checkpoint as the same level 0 tnode
+ * records an unpacked file would have.
+ */
+int yaffs_extent_wr_checkpt(struct yaffs_obj *obj)
+{
+	struct yaffs_dev *dev = obj->my_dev;
+	struct yaffs_extent_map *map = obj->variant.file_variant.extents;
+	struct yaffs_extent *e;
+	struct yaffs_tnode *tn;
+	u32 group = ~0;
+	u32 chunk;
+	u32 j;
+	int ok = 1;
+	int i;
+
+	tn = (struct yaffs_tnode *)yaffs_get_temp_buffer(dev, __LINE__);
+
+	for (i = 0; ok && i < map->n_extents; i++) {
+		e = &map->ext[i];
+		for (j = 0; ok && j < e->n_chunks; j++) {
+			chunk = e->inode_chunk + j;
+			if ((chunk >> YAFFS_TNODES_LEVEL0_BITS) != group) {
+				if (group != ~0)
+					ok = yaffs_extent_wr_tnode(dev, group,
+								   tn);
+				memset(tn, 0, dev->tnode_size);
+				group = chunk >> YAFFS_TNODES_LEVEL0_BITS;
+			}
+			yaffs_load_tnode_0(dev, tn, chunk, e->nand_chunk + j);
+		}
+	}
+	if (ok && group != ~0)
+		ok = yaffs_extent_wr_tnode(dev, group, tn);
+
+	yaffs_release_temp_buffer(dev, (u8 *) tn, __LINE__);
+
+	return ok;
+}
+
+void yaffs_extent_pack_all(struct yaffs_dev *dev)
+{
+	struct yaffs_obj *obj;
+	int i;
+
+	if (!dev->param.extent_map)
+		return;
+
+	for (i = 0; i < YAFFS_NOBJECT_BUCKETS; i++)
+		list_for_each_entry(obj, &dev->obj_bucket[i].list, hash_link)
+			yaffs_extent_pack(obj);
+
+	yaffs_trace(YAFFS_TRACE_MOUNT,
+		"yaffs: %d files packed into extents, %u bytes, %d tnodes left",
+		dev->n_extent_maps, dev->extent_bytes, dev->n_tnodes);
+}
+
+void yaffs_extent_free_all(struct yaffs_dev *dev)
+{
+	struct yaffs_obj *obj;
+	int i;
+
+	for (i = 0; i < YAFFS_NOBJECT_BUCKETS; i++)
+		list_for_each_entry(obj, &dev->obj_bucket[i].list, hash_link)
+			if (obj->variant_type == YAFFS_OBJECT_TYPE_FILE)
+				yaffs_extent_free(obj);
+}
@@ -0,0 +1,41 @@
+/*
+ * YAFFS: Yet another Flash File System . A NAND-flash specific file system.
+ *
+ * Extent based file chunk maps.
+ *
+ * Copyright (C) 2011 Meizu Technology Co.Ltd, Zhuhai, China
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef __YAFFS_EXTENT_H__
+#define __YAFFS_EXTENT_H__
+
+#include "yaffs_guts.h"
+
+/* A run of file chunks stored in consecutive NAND chunks */
+struct yaffs_extent {
+	u32 inode_chunk;	/* First file chunk in the run */
+	u32 nand_chunk;		/* NAND chunk holding inode_chunk */
+	u32 n_chunks;
+};
+
+struct yaffs_extent_map {
+	int n_extents;
+	int max_extents;
+	int n_groups;		/* Level 0 tnodes the map stands in for */
+	struct yaffs_extent ext[0];	/* Sorted by inode_chunk */
+};
+
+int yaffs_extent_pack(struct yaffs_obj *obj);
+int yaffs_extent_unpack(struct yaffs_obj *obj);
+void yaffs_extent_free(struct yaffs_obj *obj);
+u32 yaffs_extent_find(const struct yaffs_extent_map *map, u32 inode_chunk);
+int yaffs_extent_set(struct yaffs_obj *obj, u32 inode_chunk, u32 nand_chunk);
+int yaffs_extent_wr_checkpt(struct yaffs_obj *obj);
+void yaffs_extent_pack_all(struct yaffs_dev *dev);
+void yaffs_extent_free_all(struct yaffs_dev *dev);
+
+#endif
@@ -32,6 +32,7 @@
 
 #include "yaffs_nameval.h"
 #include "yaffs_allocator.h"
+#include "yaffs_extent.h"
 
 #include "yaffs_attribs.h"
 
@@ -39,6 +40,9 @@
 #define YAFFS_GC_GOOD_ENOUGH 2
 #define YAFFS_GC_PASSIVE_THRESHOLD 4
 
+/* Block age (in block allocations) beyond which data counts as equally cold */
+#define YAFFS_GC_MAX_AGE 0x7fff
+
 #include "yaffs_ecc.h"
 
 /* Forward declarations */
@@ -146,6 +150,7 @@ u8 *yaffs_get_temp_buffer(struct yaffs_dev * dev, int line_no)
 {
 	int i, j;
 
+	spin_lock(&dev->shared_lock);
 	dev->temp_in_use++;
 	if (dev->temp_in_use > dev->max_temp)
 		dev->max_temp = dev->temp_in_use;
@@ -160,9 +165,11 @@ u8 *yaffs_get_temp_buffer(struct yaffs_dev * dev, int line_no)
 					    dev->temp_buffer[j].line;
 			}
 
+			spin_unlock(&dev->shared_lock);
 			return dev->temp_buffer[i].buffer;
 		}
 	}
+	spin_unlock(&dev->shared_lock);
 
 	yaffs_trace(YAFFS_TRACE_BUFFERS,
 		"Out of temp buffers at line %d, other held by lines:",
@@ -184,14 +191,17 @@ void yaffs_release_temp_buffer(struct yaffs_dev *dev, u8 * buffer, int line_no)
 {
 	int i;
 
+	spin_lock(&dev->shared_lock);
 	dev->temp_in_use--;
 
 	for (i = 0; i < YAFFS_N_TEMP_BUFFERS; i++) {
 		if (dev->temp_buffer[i].buffer == buffer) {
 			dev->temp_buffer[i].line = 0;
+			spin_unlock(&dev->shared_lock);
 			return;
 		}
 	}
+	spin_unlock(&dev->shared_lock);
 
 	if (buffer) {
 		/* assume it is an unmanaged one. */
@@ -255,6 +265,7 @@ static void yaffs_handle_chunk_update(struct yaffs_dev *dev, int nand_chunk,
 void yaffs_handle_chunk_error(struct yaffs_dev *dev,
 			      struct yaffs_block_info *bi)
 {
+	spin_lock(&dev->shared_lock);
 	if (!bi->gc_prioritise) {
 		bi->gc_prioritise = 1;
 		dev->has_pending_prioritised_gc = 1;
@@ -266,6 +277,7 @@ void yaffs_handle_chunk_error(struct yaffs_dev *dev,
 
 		}
 	}
+	spin_unlock(&dev->shared_lock);
 }
 
 static void yaffs_handle_chunk_wr_error(struct yaffs_dev *dev, int nand_chunk,
@@ -735,7 +747,7 @@ struct yaffs_tnode *yaffs_get_tnode(struct yaffs_dev *dev)
 }
 
 /* FreeTnode frees up a tnode and puts it back on the free list */
-static void yaffs_free_tnode(struct yaffs_dev *dev, struct yaffs_tnode *tn)
+void yaffs_free_tnode(struct yaffs_dev *dev, struct yaffs_tnode *tn)
 {
 	yaffs_free_raw_tnode(dev, tn);
 	dev->n_tnodes--;
@@ -1018,6 +1030,13 @@ static int yaffs_find_chunk_in_file(struct yaffs_obj *in, int inode_chunk,
 		tags = &local_tags;
 	}
 
+	if (in->variant.file_variant.extents) {
+		the_chunk = yaffs_extent_find(in->variant.file_variant.extents,
+					      inode_chunk);
+		return yaffs_find_chunk_in_group(dev, the_chunk, tags,
+						 in->obj_id, inode_chunk);
+	}
+
 	tn = yaffs_find_tnode_0(dev, &in->variant.file_variant, inode_chunk);
 
 	if (tn) {
@@ -1046,6 +1065,16 @@ static int yaffs_find_del_file_chunk(struct yaffs_obj *in, int inode_chunk,
 		tags = &local_tags;
 	}
 
+	if (in->variant.file_variant.extents) {
+		the_chunk = yaffs_extent_find(in->variant.file_variant.extents,
+					      inode_chunk);
+		ret_val = yaffs_find_chunk_in_group(dev, the_chunk, tags,
+						    in->obj_id, inode_chunk);
+		if (ret_val != -1)
+			yaffs_extent_set(in, inode_chunk, 0);
+		return ret_val;
+	}
+
 	tn = yaffs_find_tnode_0(dev, &in->variant.file_variant, inode_chunk);
 
 	if (tn) {
@@ -1077,6 +1106,7 @@ int yaffs_put_chunk_in_file(struct yaffs_obj *in, int inode_chunk,
 	struct yaffs_tnode *tn;
 	struct yaffs_dev *dev = in->my_dev;
 	int existing_cunk;
+	int added;
 	struct yaffs_ext_tags existing_tags;
 	struct yaffs_ext_tags new_tags;
 	unsigned existing_serial, new_serial;
@@ -1096,6 +1126,20 @@ int yaffs_put_chunk_in_file(struct yaffs_obj *in, int inode_chunk,
 		return YAFFS_OK;
 	}
 
+	if (in->variant.file_variant.extents) {
+		/* Files are only packed once scanning is done */
+		if (!nand_chunk)
+			return YAFFS_OK;
+
+		added = !yaffs_extent_find(in->variant.file_variant.extents,
+					   inode_chunk);
+		if (yaffs_extent_set(in, inode_chunk, nand_chunk) != YAFFS_OK)
+			return YAFFS_FAIL;
+		if (added)
+			in->n_data_chunks++;
+		return YAFFS_OK;
+	}
+
 	tn = yaffs_add_find_tnode_0(dev,
 				    &in->variant.file_variant,
 				    inode_chunk, NULL);
@@ -1394,10 +1438,42 @@ static int yaffs_change_obj_name(struct yaffs_obj *obj,
  *   In Linux, the page cache provides read buffering and the short op cache 
  *   provides write buffering.
  *
- *   There are a limited number (~10) of cache chunks per device so that we don't
- *   need a very intelligent search.
+ *   Cache chunks are hashed on (object, chunk) for lookup and kept on an LRU
+ *   list, free ones at the front, so neither a lookup nor finding a victim
+ *   has to look at every chunk.
  */
 
+static struct list_head *yaffs_cache_bucket(struct yaffs_dev *dev,
+					    const struct yaffs_obj *obj,
+					    int chunk_id)
+{
+	return &dev->cache_hash[(obj->obj_id * 7 + chunk_id) &
+				(YAFFS_CACHE_BUCKETS - 1)];
+}
+
+/* Bind a cache chunk to a new (object, chunk) and hash it */
+static void yaffs_cache_assign(struct yaffs_dev *dev, struct yaffs_cache *cache,
+			       struct yaffs_obj *obj, int chunk_id)
+{
+	list_del_init(&cache->hash_link);
+	cache->object = obj;
+	cache->chunk_id = chunk_id;
+	cache->dirty = 0;
+	cache->locked = 0;
+	cache->read_ahead = 0;
+	list_add(&cache->hash_link, yaffs_cache_bucket(dev, obj, chunk_id));
+}
+
+/* Free a cache chunk, it goes to the front of the LRU to be reused first */
+static void yaffs_cache_release(struct yaffs_dev *dev, struct yaffs_cache *cache)
+{
+	list_del_init(&cache->hash_link);
+	cache->object = NULL;
+	cache->dirty = 0;
+	cache->read_ahead = 0;
+	list_move(&cache->lru, &dev->cache_lru);
+}
+
 static int yaffs_obj_cache_dirty(struct yaffs_obj *obj)
 {
 	struct yaffs_dev *dev = obj->my_dev;
@@ -1448,8 +1524,7 @@ static void yaffs_flush_file_cache(struct yaffs_obj *obj)
 						      cache->chunk_id,
 						      cache->data,
 						      cache->n_bytes, 1);
-				cache->dirty = 0;
-				cache->object = NULL;
+				yaffs_cache_release(dev, cache);
 			}
 
 		} while (cache && chunk_written > 0);
@@ -1498,13 +1573,13 @@ void yaffs_flush_whole_cache(struct yaffs_dev *dev)
  */
 static struct yaffs_cache *yaffs_grab_chunk_worker(struct yaffs_dev *dev)
 {
-	int i;
+	struct yaffs_cache *cache;
 
 	if (dev->param.n_caches > 0) {
-		for (i = 0; i < dev->param.n_caches; i++) {
-			if (!dev->cache[i].object)
-				return &dev->cache[i];
-		}
+		/* Free chunks are kept at the front of the LRU */
+		cache = list_first_entry(&dev->cache_lru, struct yaffs_cache, lru);
+		if (!cache->object)
+			return cache;
 	}
 
 	return NULL;
@@ -1513,10 +1588,7 @@ static struct yaffs_cache *yaffs_grab_chunk_worker(struct yaffs_dev *dev)
 static struct yaffs_cache *yaffs_grab_chunk_cache(struct yaffs_dev *dev)
 {
 	struct yaffs_cache *cache;
-	struct yaffs_obj *the_obj;
-	int usage;
-	int i;
-	int pushout;
+	struct yaffs_cache *c;
 
 	if (dev->param.n_caches > 0) {
 		/* Try find a non-dirty one... */
@@ -1524,34 +1596,20 @@ static struct yaffs_cache *yaffs_grab_chunk_cache(struct yaffs_dev *dev)
 		cache = yaffs_grab_chunk_worker(dev);
 
 		if (!cache) {
-			/* They were all dirty, find the last recently used object and flush
-			 * its cache, then  find again.
-			 * NB what's here is not very accurate, we actually flush the object
-			 * the last recently used page.
+			/* None free, take the least recently used one.  If that is
+			 * dirty, flush its object and find again.
+			 * With locking we can't assume we can use the LRU head.
 			 */
-
-			/* With locking we can't assume we can use entry zero */
-
-			the_obj = NULL;
-			usage = -1;
-			cache = NULL;
-			pushout = -1;
-
-			for (i = 0; i < dev->param.n_caches; i++) {
-				if (dev->cache[i].object &&
-				    !dev->cache[i].locked &&
-				    (dev->cache[i].last_use < usage
-				     || !cache)) {
-					usage = dev->cache[i].last_use;
-					the_obj = dev->cache[i].object;
-					cache = &dev->cache[i];
-					pushout = i;
+			list_for_each_entry(c, &dev->cache_lru, lru) {
+				if (!c->locked) {
+					cache = c;
+					break;
 				}
 			}
 
-			if (!cache || cache->dirty) {
+			if (cache && cache->dirty) {
 				/* Flush and try again */
-				yaffs_flush_file_cache(the_obj);
+				yaffs_flush_file_cache(cache->object);
 				cache = yaffs_grab_chunk_worker(dev);
 			}
 
@@ -1562,43 +1620,54 @@ static struct yaffs_cache *yaffs_grab_chunk_cache(struct yaffs_dev *dev)
         }
 }
 
-/* Find a cached chunk */
-static struct yaffs_cache *yaffs_find_chunk_cache(const struct yaffs_obj *obj,
-						  int chunk_id)
+/* Like yaffs_grab_chunk_cache() but never pushes out dirty data */
+static struct yaffs_cache *yaffs_grab_clean_cache(struct yaffs_dev *dev)
+{
+	struct yaffs_cache *cache;
+
+	list_for_each_entry(cache, &dev->cache_lru, lru) {
+		if (!cache->object || (!cache->dirty && !cache->locked))
+			return cache;
+	}
+
+	return NULL;
+}
+
+static struct yaffs_cache *yaffs_lookup_chunk_cache(const struct yaffs_obj *obj,
+						    int chunk_id)
 {
 	struct yaffs_dev *dev = obj->my_dev;
-	int i;
-	if (dev->param.n_caches > 0) {
-		for (i = 0; i < dev->param.n_caches; i++) {
-			if (dev->cache[i].object == obj &&
-			    dev->cache[i].chunk_id == chunk_id) {
-				dev->cache_hits++;
+	struct yaffs_cache *cache;
 
-				return &dev->cache[i];
-			}
+	if (dev->param.n_caches > 0) {
+		list_for_each_entry(cache,
+				    yaffs_cache_bucket(dev, obj, chunk_id),
+				    hash_link) {
+			if (cache->object == obj && cache->chunk_id == chunk_id)
+				return cache;
 		}
 	}
 	return NULL;
 }
 
+/* Find a cached chunk */
+static struct yaffs_cache *yaffs_find_chunk_cache(const struct yaffs_obj *obj,
+						  int chunk_id)
+{
+	struct yaffs_cache *cache = yaffs_lookup_chunk_cache(obj, chunk_id);
+
+	if (cache)
+		obj->my_dev->cache_hits++;
+	return cache;
+}
+
 /* Mark the chunk for the least recently used algorithym */
 static void yaffs_use_cache(struct yaffs_dev *dev, struct yaffs_cache *cache,
 			    int is_write)
 {
 
 	if (dev->param.n_caches > 0) {
-		if (dev->cache_last_use < 0 || dev->cache_last_use > 100000000) {
-			/* Reset the cache usages */
-			int i;
-			for (i = 1; i < dev->param.n_caches; i++)
-				dev->cache[i].last_use = 0;
-
-			dev->cache_last_use = 0;
-		}
-
-		dev->cache_last_use++;
-
-		cache->last_use = dev->cache_last_use;
+		list_move_tail(&cache->lru, &dev->cache_lru);
 
 		if (is_write)
 			cache->dirty = 1;
@@ -1616,7 +1685,7 @@ static void yaffs_invalidate_chunk_cache(struct yaffs_obj *object, int chunk_id)
 		    yaffs_find_chunk_cache(object, chunk_id);
 
 		if (cache)
-			cache->object = NULL;
+			yaffs_cache_release(object->my_dev, cache);
 	}
 }
 
@@ -1632,7 +1701,7 @@ static void yaffs_invalidate_whole_cache(struct yaffs_obj *in)
 		/* Invalidate it. */
 		for (i = 0; i < dev->param.n_caches; i++) {
 			if (dev->cache[i].object == in)
-				dev->cache[i].object = NULL;
+				yaffs_cache_release(dev, &dev->cache[i]);
 		}
 	}
 }
@@ -1675,6 +1744,9 @@ static void yaffs_free_obj(struct yaffs_obj *obj)
 
 	yaffs_unhash_obj(obj);
 
+	if (obj->variant_type == YAFFS_OBJECT_TYPE_FILE)
+		yaffs_extent_free(obj);
+
 	yaffs_free_raw_obj(dev, obj);
 	dev->n_obj--;
 	dev->checkpoint_blocks_required = 0;	/* force recalculation */
@@ -1708,6 +1780,30 @@ static int yaffs_generic_obj_del(struct yaffs_obj *in)
 
 }
 
+/* Release a file's chunk map, whichever form it is in */
+static void yaffs_free_file_map(struct yaffs_obj *obj)
+{
+	yaffs_extent_free(obj);
+	if (obj->variant.file_variant.top)
+		yaffs_free_tnode(obj->my_dev, obj->variant.file_variant.top);
+	obj->variant.file_variant.top = NULL;
+}
+
+/* The extent map counterpart of yaffs_soft_del_worker() */
+static void yaffs_soft_del_extents(struct yaffs_obj *obj)
+{
+	struct yaffs_extent_map *map = obj->variant.file_variant.extents;
+	u32 j;
+	int i;
+
+	for (i = 0; i < map->n_extents; i++)
+		for (j = 0; j < map->ext[i].n_chunks; j++)
+			yaffs_soft_del_chunk(obj->my_dev,
+					     map->ext[i].nand_chunk + j);
+
+	yaffs_extent_free(obj);
+}
+
 static void yaffs_soft_del_file(struct yaffs_obj *obj)
 {
 	if (obj->deleted &&
@@ -1715,13 +1811,14 @@ static void yaffs_soft_del_file(struct yaffs_obj *obj)
 		if (obj->n_data_chunks <= 0) {
 			/* Empty file with no duplicate object headers,
 			 * just delete it immediately */
-			yaffs_free_tnode(obj->my_dev,
-					 obj->variant.file_variant.top);
-			obj->variant.file_variant.top = NULL;
+			yaffs_free_file_map(obj);
 			yaffs_trace(YAFFS_TRACE_TRACING,
 				"yaffs: Deleting empty file %d",
 				obj->obj_id);
 			yaffs_generic_obj_del(obj);
+		} else if (obj->variant.file_variant.extents) {
+			yaffs_soft_del_extents(obj);
+			obj->soft_del = 1;
 		} else {
 			yaffs_soft_del_worker(obj,
 					      obj->variant.file_variant.top,
@@ -2006,6 +2103,7 @@ struct yaffs_obj *yaffs_new_obj(struct yaffs_dev *dev, int number,
 			the_obj->variant.file_variant.shrink_size = ~0;	/* max */
 			the_obj->variant.file_variant.top_level = 0;
 			the_obj->variant.file_variant.top = tn;
+			the_obj->variant.file_variant.extents = NULL;
 			break;
 		case YAFFS_OBJECT_TYPE_DIRECTORY:
 			INIT_LIST_HEAD(&the_obj->variant.dir_variant.children);
@@ -2053,6 +2151,9 @@ static void yaffs_init_tnodes_and_objs(struct yaffs_dev *dev)
 
 	dev->n_obj = 0;
 	dev->n_tnodes = 0;
+	dev->n_extent_maps = 0;
+	dev->n_extent_groups = 0;
+	dev->extent_bytes = 0;
 
 	yaffs_init_raw_tnodes_and_objs(dev);
 
@@ -2577,11 +2678,7 @@ static int yaffs_gc_block(struct yaffs_dev *dev, int block, int whole_block)
 					 * Can be discarded and the file deleted.
 					 */
 					object->hdr_chunk = 0;
-					yaffs_free_tnode(object->my_dev,
-							 object->
-							 variant.file_variant.
-							 top);
-					object->variant.file_variant.top = NULL;
+					yaffs_free_file_map(object);
 					yaffs_generic_obj_del(object);
 
 				} else if (object) {
@@ -2687,10 +2784,7 @@ static int yaffs_gc_block(struct yaffs_dev *dev, int block, int whole_block)
 			object =
 			    yaffs_find_by_number(dev, dev->gc_cleanup_list[i]);
 			if (object) {
-				yaffs_free_tnode(dev,
-						 object->variant.
-						 file_variant.top);
-				object->variant.file_variant.top = NULL;
+				yaffs_free_file_map(object);
 				yaffs_trace(YAFFS_TRACE_GC,
 					"yaffs: About to finally delete object %d",
 					object->obj_id);
@@ -2715,6 +2809,41 @@ static int yaffs_gc_block(struct yaffs_dev *dev, int block, int whole_block)
 	return ret_val;
 }
 
+/*
+ * Cost-benefit victim ranking, as in LFS.  Collecting a block with u of its
+ * chunks in use gains (1 - u) of a block for a cost of (1 + u): reading it
+ * plus rewriting the live chunks.  Weighting that by the age of the data
+ * lets cold blocks be collected while still fairly full and leaves hot
+ * ones (e.g. database journals) to die off on their own, which keeps hot
+ * and cold data from being copied around together.  The age of a yaffs2
+ * block is the number of blocks allocated since it was.
+ */
+static u32 yaffs_gc_benefit(struct yaffs_dev *dev,
+			    struct yaffs_block_info *bi, int pages_used)
+{
+	u32 cpb = dev->param.chunks_per_block;
+	u32 age = dev->seq_number - bi->seq_number;
+
+	if (age > YAFFS_GC_MAX_AGE)
+		age = YAFFS_GC_MAX_AGE;
+
+	return (((cpb - pages_used) << 16) / (cpb + pages_used)) * (age + 1);
+}
+
+/* Is bi a better victim than the current candidate, dev->gc_dirtiest? */
+static int yaffs_gc_better(struct yaffs_dev *dev,
+			   struct yaffs_block_info *bi, int pages_used)
+{
+	struct yaffs_block_info *cur;
+
+	if (!dev->param.is_yaffs2 || !yaffs_gc_cost_benefit)
+		return pages_used < dev->gc_pages_in_use;
+
+	cur = yaffs_get_block_info(dev, dev->gc_dirtiest);
+	return yaffs_gc_benefit(dev, bi, pages_used) >
+	    yaffs_gc_benefit(dev, cur, cur->pages_in_use - cur->soft_del_pages);
+}
+
 /*
  * FindBlockForgarbageCollection is used to select the dirtiest block (or close enough)
  * for garbage collection.
@@ -2798,6 +2927,17 @@ static unsigned yaffs_find_gc_block(struct yaffs_dev *dev,
 				iterations = 100;
 		}
 
+		/*
+		 * Only blocks under the threshold are candidates, so that the
+		 * cost-benefit ranking below cannot prefer one that will not
+		 * be selected. Forget a candidate kept from a search with a
+		 * higher threshold.
+		 */
+		if (dev->gc_dirtiest > 0 && dev->gc_pages_in_use > threshold) {
+			dev->gc_dirtiest = 0;
+			dev->gc_pages_in_use = 0;
+		}
+
 		for (i = 0;
 		     i < iterations &&
 		     (dev->gc_dirtiest < 1 ||
@@ -2814,8 +2954,9 @@ static unsigned yaffs_find_gc_block(struct yaffs_dev *dev,
 
 			if (bi->block_state == YAFFS_BLOCK_STATE_FULL &&
 			    pages_used < dev->param.chunks_per_block &&
+			    pages_used <= threshold &&
 			    (dev->gc_dirtiest < 1
-			     || pages_used < dev->gc_pages_in_use)
+			     || yaffs_gc_better(dev, bi, pages_used))
 			    && yaffs_block_ok_for_gc(dev, bi)) {
 				dev->gc_dirtiest = dev->gc_block_finder;
 				dev->gc_pages_in_use = pages_used;
@@ -3221,8 +3362,10 @@ static int yaffs_do_xattrib_fetch(struct yaffs_obj *obj, const YCHAR * name,
 		x_buffer = buffer + x_offs;
 
 		if (!obj->xattr_known) {
+			mutex_lock(&dev->load_lock);
 			obj->has_xattr = nval_hasvalues(x_buffer, x_size);
 			obj->xattr_known = 1;
+			mutex_unlock(&dev->load_lock);
 		}
 
 		if (name)
@@ -3270,8 +3413,16 @@ static void yaffs_check_obj_details_loaded(struct yaffs_obj *in)
 
 	dev = in->my_dev;
 
+	if (!in->lazy_loaded) {
+		smp_rmb();
+		return;
+	}
+
+	/* Concurrent readers must not see a half loaded object, so
+	 * lazy_loaded is only cleared once the details are in place.
+	 */
+	mutex_lock(&dev->load_lock);
 	if (in->lazy_loaded && in->hdr_chunk > 0) {
-		in->lazy_loaded = 0;
 		chunk_data = yaffs_get_temp_buffer(dev, __LINE__);
 
 		result =
@@ -3291,7 +3442,10 @@ static void yaffs_check_obj_details_loaded(struct yaffs_obj *in)
 		}
 
 		yaffs_release_temp_buffer(dev, chunk_data, __LINE__);
+		smp_wmb();
+		in->lazy_loaded = 0;
 	}
+	mutex_unlock(&dev->load_lock);
 }
 
 static void yaffs_load_name_from_oh(struct yaffs_dev *dev, YCHAR * name,
@@ -3538,7 +3692,72 @@ int yaffs_update_oh(struct yaffs_obj *in, const YCHAR * name, int force,
  * Curve-balls: the first chunk might also be the last chunk.
  */
 
-int yaffs_file_rd(struct yaffs_obj *in, u8 * buffer, loff_t offset, int n_bytes)
+/*
+ * Short reads that move on to the chunk after the previous one are taken as
+ * a sequential stream (one per device): the next yaffs_cache_readahead
+ * chunks of the file are then read into clean cache chunks so that the
+ * reads that follow hit the cache.  Readahead never pushes out dirty data.
+ */
+static void yaffs_cache_read_ahead(struct yaffs_obj *in, int chunk)
+{
+	struct yaffs_dev *dev = in->my_dev;
+	struct yaffs_cache *cache;
+	u32 file_size = in->variant.file_variant.file_size;
+	u32 start;
+	int last_chunk;
+	int window;
+	int i;
+
+	window = min_t(int, yaffs_cache_readahead, dev->param.n_caches / 2);
+	if (window <= 0 || file_size == 0)
+		return;
+
+	yaffs_addr_to_chunk(dev, file_size - 1, &last_chunk, &start);
+	last_chunk++;
+
+	for (i = 0; i < window && chunk + i <= last_chunk; i++) {
+		if (yaffs_lookup_chunk_cache(in, chunk + i))
+			continue;
+
+		cache = yaffs_grab_clean_cache(dev);
+		if (!cache)
+			break;
+
+		yaffs_cache_assign(dev, cache, in, chunk + i);
+		yaffs_rd_data_obj(in, chunk + i, cache->data);
+		cache->n_bytes = 0;
+		cache->read_ahead = 1;
+		yaffs_use_cache(dev, cache, 0);
+		dev->cache_ra_chunks++;
+	}
+}
+
+static void yaffs_cache_note_read(struct yaffs_obj *in, int chunk)
+{
+	struct yaffs_dev *dev = in->my_dev;
+	int sequential;
+
+	if (in == dev->cache_ra_obj && chunk == dev->cache_ra_last)
+		return;
+
+	sequential = (in == dev->cache_ra_obj &&
+		      chunk == dev->cache_ra_last + 1);
+	dev->cache_ra_obj = in;
+	dev->cache_ra_last = chunk;
+
+	if (sequential)
+		yaffs_cache_read_ahead(in, chunk + 1);
+}
+
+/*
+ * A shared read is made while other readers may be running concurrently
+ * (but no writer).  Those readers take cache_lock around their use of the
+ * chunk cache, and only fill it with clean chunks: they must not write to
+ * flash, so they cannot flush dirty ones.  Chunks that find no clean cache
+ * chunk are read through a temp buffer instead.
+ */
+static int yaffs_do_file_rd(struct yaffs_obj *in, u8 * buffer, loff_t offset,
+			    int n_bytes, int shared)
 {
 
 	int chunk;
@@ -3546,11 +3765,13 @@ int yaffs_file_rd(struct yaffs_obj *in, u8 * buffer, loff_t offset, int n_bytes)
 	int n_copy;
 	int n = n_bytes;
 	int n_done = 0;
+	int lock;
 	struct yaffs_cache *cache;
 
 	struct yaffs_dev *dev;
 
 	dev = in->my_dev;
+	lock = shared && dev->param.n_caches > 0;
 
 	while (n > 0) {
 		/* chunk = offset / dev->data_bytes_per_chunk + 1; */
@@ -3566,6 +3787,9 @@ int yaffs_file_rd(struct yaffs_obj *in, u8 * buffer, loff_t offset, int n_bytes)
 		else
 			n_copy = dev->data_bytes_per_chunk - start;
 
+		if (lock)
+			mutex_lock(&dev->cache_lock);
+
 		cache = yaffs_find_chunk_cache(in, chunk);
 
 		/* If the chunk is already in the cache or it is less than a whole chunk
@@ -3574,33 +3798,50 @@ int yaffs_file_rd(struct yaffs_obj *in, u8 * buffer, loff_t offset, int n_bytes)
 		 */
 		if (cache || n_copy != dev->data_bytes_per_chunk
 		    || dev->param.inband_tags) {
-			if (dev->param.n_caches > 0) {
+			if (!cache)
+				dev->cache_misses++;
+			else if (cache->read_ahead) {
+				cache->read_ahead = 0;
+				dev->cache_ra_hits++;
+			}
 
-				/* If we can't find the data in the cache, then load it up. */
+			/* If we can't find the data in the cache, then load it up. */
 
-				if (!cache) {
-					cache =
-					    yaffs_grab_chunk_cache(in->my_dev);
-					cache->object = in;
-					cache->chunk_id = chunk;
-					cache->dirty = 0;
-					cache->locked = 0;
+			if (!cache && dev->param.n_caches > 0) {
+				if (shared)
+					cache = yaffs_grab_clean_cache(dev);
+				else
+					cache = yaffs_grab_chunk_cache(dev);
+				if (cache) {
+					yaffs_cache_assign(dev, cache, in,
+							   chunk);
 					yaffs_rd_data_obj(in, chunk,
 							  cache->data);
 					cache->n_bytes = 0;
 				}
+			}
 
+			if (cache) {
 				yaffs_use_cache(dev, cache, 0);
+				yaffs_cache_note_read(in, chunk);
 
 				cache->locked = 1;
 
 				memcpy(buffer, &cache->data[start], n_copy);
 
 				cache->locked = 0;
+
+				if (lock)
+					mutex_unlock(&dev->cache_lock);
 			} else {
 				/* Read into the local buffer then copy.. */
 
-				u8 *local_buffer =
+				u8 *local_buffer;
+
+				if (lock)
+					mutex_unlock(&dev->cache_lock);
+
+				local_buffer =
 				    yaffs_get_temp_buffer(dev, __LINE__);
 				yaffs_rd_data_obj(in, chunk, local_buffer);
 
@@ -3612,6 +3853,9 @@ int yaffs_file_rd(struct yaffs_obj *in, u8 * buffer, loff_t offset, int n_bytes)
 
 		} else {
 
+			if (lock)
+				mutex_unlock(&dev->cache_lock);
+
 			/* A full chunk. Read directly into the supplied buffer. */
 			yaffs_rd_data_obj(in, chunk, buffer);
 
@@ -3627,6 +3871,17 @@ int yaffs_file_rd(struct yaffs_obj *in, u8 * buffer, loff_t offset, int n_bytes)
 	return n_done;
 }
 
+int yaffs_file_rd(struct yaffs_obj *in, u8 * buffer, loff_t offset, int n_bytes)
+{
+	return yaffs_do_file_rd(in, buffer, offset, n_bytes, 0);
+}
+
+int yaffs_file_rd_shared(struct yaffs_obj *in, u8 * buffer, loff_t offset,
+			 int n_bytes)
+{
+	return yaffs_do_file_rd(in, buffer, offset, n_bytes, 1);
+}
+
 int yaffs_do_file_wr(struct yaffs_obj *in, const u8 * buffer, loff_t offset,
 		     int n_bytes, int write_trhrough)
 {
@@ -3707,10 +3962,8 @@ int yaffs_do_file_wr(struct yaffs_obj *in, const u8 * buffer, loff_t offset,
 				if (!cache
 				    && yaffs_check_alloc_available(dev, 1)) {
 					cache = yaffs_grab_chunk_cache(dev);
-					cache->object = in;
-					cache->chunk_id = chunk;
-					cache->dirty = 0;
-					cache->locked = 0;
+					yaffs_cache_assign(dev, cache, in,
+							   chunk);
 					yaffs_rd_data_obj(in, chunk,
 							  cache->data);
 				} else if (cache &&
@@ -4002,8 +4255,7 @@ int yaffs_del_file(struct yaffs_obj *in)
 		return deleted ? YAFFS_OK : YAFFS_FAIL;
 	} else {
 		/* The file has no data chunks so we toss it immediately */
-		yaffs_free_tnode(in->my_dev, in->variant.file_variant.top);
-		in->variant.file_variant.top = NULL;
+		yaffs_free_file_map(in);
 		yaffs_generic_obj_del(in);
 
 		return YAFFS_OK;
@@ -4776,6 +5028,10 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 		return YAFFS_FAIL;
 	}
 
+	spin_lock_init(&dev->shared_lock);
+	mutex_init(&dev->load_lock);
+	mutex_init(&dev->cache_lock);
+
 	dev->internal_start_block = dev->param.start_block;
 	dev->internal_end_block = dev->param.end_block;
 	dev->block_offset = 0;
@@ -4944,12 +5200,13 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 	if (!init_failed && dev->param.n_caches > 0) {
 		int i;
 		void *buf;
-		int cache_bytes =
-		    dev->param.n_caches * sizeof(struct yaffs_cache);
+		int cache_bytes;
 
 		if (dev->param.n_caches > YAFFS_MAX_SHORT_OP_CACHES)
 			dev->param.n_caches = YAFFS_MAX_SHORT_OP_CACHES;
 
+		cache_bytes = dev->param.n_caches * sizeof(struct yaffs_cache);
+
 		dev->cache = kmalloc(cache_bytes, GFP_NOFS);
 
 		buf = (u8 *) dev->cache;
@@ -4957,20 +5214,27 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 		if (dev->cache)
 			memset(dev->cache, 0, cache_bytes);
 
+		INIT_LIST_HEAD(&dev->cache_lru);
+		for (i = 0; i < YAFFS_CACHE_BUCKETS; i++)
+			INIT_LIST_HEAD(&dev->cache_hash[i]);
+
 		for (i = 0; i < dev->param.n_caches && buf; i++) {
 			dev->cache[i].object = NULL;
-			dev->cache[i].last_use = 0;
 			dev->cache[i].dirty = 0;
+			INIT_LIST_HEAD(&dev->cache[i].hash_link);
+			list_add_tail(&dev->cache[i].lru, &dev->cache_lru);
 			dev->cache[i].data = buf =
 			    kmalloc(dev->param.total_bytes_per_chunk, GFP_NOFS);
 		}
 		if (!buf)
 			init_failed = 1;
-
-		dev->cache_last_use = 0;
 	}
 
 	dev->cache_hits = 0;
+	dev->cache_misses = 0;
+	dev->cache_ra_chunks = 0;
+	dev->cache_ra_hits = 0;
+	dev->cache_ra_obj = NULL;
 
 	if (!init_failed) {
 		dev->gc_cleanup_list =
@@ -5063,6 +5327,8 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 	if (!dev->is_checkpointed && dev->blocks_in_checkpt > 0)
 		yaffs2_checkpt_invalidate(dev);
 
+	yaffs_extent_pack_all(dev);
+
 	yaffs_trace(YAFFS_TRACE_TRACING,
 	  "yaffs: yaffs_guts_initialise() done.");
 	return YAFFS_OK;
@@ -5075,6 +5341,7 @@ void yaffs_deinitialise(struct yaffs_dev *dev)
 		int i;
 
 		yaffs_deinit_blocks(dev);
+		yaffs_extent_free_all(dev);
 		yaffs_deinit_tnodes_and_objs(dev);
 		if (dev->param.n_caches > 0 && dev->cache) {
 
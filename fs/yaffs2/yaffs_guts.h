@@ -83,7 +83,8 @@
 #define YAFFS_OBJECTID_CHECKPOINT_DATA	0x20
 #define YAFFS_SEQUENCE_CHECKPOINT_DATA  0x21
 
-#define YAFFS_MAX_SHORT_OP_CACHES	20
+#define YAFFS_MAX_SHORT_OP_CACHES	256
+#define YAFFS_CACHE_BUCKETS		64
 
 #define YAFFS_N_TEMP_BUFFERS		6
 
@@ -110,10 +111,12 @@
 struct yaffs_cache {
 	struct yaffs_obj *object;
 	int chunk_id;
-	int last_use;
+	struct list_head hash_link;	/* In dev->cache_hash while object is set */
+	struct list_head lru;		/* dev->cache_lru, least recently used first */
 	int dirty;
 	int n_bytes;		/* Only valid if the cache is dirty */
 	int locked;		/* Can't push out or flush while locked. */
+	int read_ahead;		/* Filled by readahead, not yet used */
 	u8 *data;
 };
 
@@ -346,12 +349,15 @@ struct yaffs_tnode {
  * - a hard link
  */
 
+struct yaffs_extent_map;
+
 struct yaffs_file_var {
 	u32 file_size;
 	u32 scanned_size;
 	u32 shrink_size;
 	int top_level;
 	struct yaffs_tnode *top;
+	struct yaffs_extent_map *extents;	/* Replaces the tnode tree if set */
 };
 
 struct yaffs_dir_var {
@@ -524,6 +530,8 @@ struct yaffs_param {
 
 	int enable_xattr;	/* Enable xattribs */
 
+	int extent_map;		/* Keep contiguous file chunk maps as extents */
+
 	/* NAND access functions (Must be set before calling YAFFS) */
 
 	int (*write_chunk_fn) (struct yaffs_dev * dev,
@@ -650,6 +658,9 @@ struct yaffs_dev {
 	void *allocator;
 	int n_obj;
 	int n_tnodes;
+	int n_extent_maps;	/* Files whose chunk map is held as extents */
+	int n_extent_groups;	/* Level 0 tnodes they stand for in a checkpoint */
+	u32 extent_bytes;	/* Memory used by the extent maps */
 
 	int n_hardlinks;
 
@@ -685,7 +696,12 @@ struct yaffs_dev {
 	int doing_buffered_block_rewrite;
 
 	struct yaffs_cache *cache;
-	int cache_last_use;
+	struct list_head cache_lru;
+	struct list_head cache_hash[YAFFS_CACHE_BUCKETS];
+
+	/* Sequential short read detection for chunk cache readahead */
+	struct yaffs_obj *cache_ra_obj;
+	int cache_ra_last;
 
 	/* Stuff for background deletion and unlinked files. */
 	struct yaffs_obj *unlinked_dir;	/* Directory where unlinked and deleted files live. */
@@ -702,6 +718,15 @@ struct yaffs_dev {
 	int unmanaged_buffer_allocs;
 	int unmanaged_buffer_deallocs;
 
+	/* Readers may run concurrently (the OS layer holds its device lock
+	 * shared for them).  shared_lock covers the temp buffers and block
+	 * error marking they can reach, load_lock the lazy loading of object
+	 * details and cache_lock the chunk cache and its readahead state.
+	 */
+	spinlock_t shared_lock;
+	struct mutex load_lock;
+	struct mutex cache_lock;
+
 	/* yaffs2 runtime stuff */
 	unsigned seq_number;	/* Sequence number of currently allocating block */
 	unsigned oldest_dirty_seq;
@@ -734,6 +759,17 @@ struct yaffs_dev {
 	u32 n_unmarked_deletions;
 	u32 refresh_count;
 	u32 cache_hits;
+	u32 cache_misses;
+	u32 cache_ra_chunks;	/* Chunks read ahead into the cache */
+	u32 cache_ra_hits;	/* Read ahead chunks that were later used */
+
+	/* Mount statistics from the last yaffs2 scan (no checkpoint) */
+	u32 scan_threads;	/* Tag reader threads used */
+	u32 scan_blocks;	/* Blocks whose chunks were scanned */
+	u32 scan_query_us;	/* Block state and sequence number query */
+	u32 scan_sort_us;	/* Sorting blocks by sequence number */
+	u32 scan_chunks_us;	/* Chunk tag scan and object rebuild */
+	u32 scan_fixup_us;	/* Hard link fixup */
 
 };
 
@@ -801,6 +837,8 @@ int yaffs_get_obj_link_count(struct yaffs_obj *obj);
 /* File operations */
 int yaffs_file_rd(struct yaffs_obj *obj, u8 * buffer, loff_t offset,
 		  int n_bytes);
+int yaffs_file_rd_shared(struct yaffs_obj *obj, u8 * buffer, loff_t offset,
+			 int n_bytes);
 int yaffs_wr_file(struct yaffs_obj *obj, const u8 * buffer, loff_t offset,
 		  int n_bytes, int write_trhrough);
 int yaffs_resize_file(struct yaffs_obj *obj, loff_t new_size);
@@ -892,6 +930,7 @@ void yaffs_handle_shadowed_obj(struct yaffs_dev *dev, int obj_id,
 			       int backward_scanning);
 int yaffs_check_alloc_available(struct yaffs_dev *dev, int n_chunks);
 struct yaffs_tnode *yaffs_get_tnode(struct yaffs_dev *dev);
+void yaffs_free_tnode(struct yaffs_dev *dev, struct yaffs_tnode *tn);
 struct yaffs_tnode *yaffs_add_find_tnode_0(struct yaffs_dev *dev,
 					   struct yaffs_file_var *file_struct,
 					   u32 chunk_id,
@@ -910,6 +949,8 @@ struct yaffs_tnode *yaffs_find_tnode_0(struct yaffs_dev *dev,
 
 u32 yaffs_get_group_base(struct yaffs_dev *dev, struct yaffs_tnode *tn,
 			 unsigned pos);
+void yaffs_load_tnode_0(struct yaffs_dev *dev, struct yaffs_tnode *tn,
+			unsigned pos, unsigned val);
 
 int yaffs_is_non_empty_dir(struct yaffs_obj *obj);
 #endif
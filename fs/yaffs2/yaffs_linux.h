@@ -17,6 +17,7 @@
 #define __YAFFS_LINUX_H__
 
 #include "yportenv.h"
+#include <linux/rwsem.h>
 
 struct yaffs_linux_context {
 	struct list_head context_list;	/* List of these we have mounted */
@@ -24,15 +25,26 @@ struct yaffs_linux_context {
 	struct super_block *super;
 	struct task_struct *bg_thread;	/* Background thread for this device */
 	int bg_running;
-	struct mutex gross_lock;	/* Gross locking mutex*/
-	u8 *spare_buffer;	/* For mtdif2 use. Don't know the size of the buffer
-				 * at compile time so we have to allocate it.
-				 */
+	struct rw_semaphore gross_lock;	/* Exclusive for anything that changes
+					 * the device, shared for reads.
+					 */
 	struct list_head search_contexts;
+	spinlock_t search_lock;	/* search_contexts, for shared readdirs */
 	void (*put_super_fn) (struct super_block * sb);
 
-	struct task_struct *readdir_process;
 	unsigned mount_id;
+
+	/* Lock statistics, shown in /proc/yaffs */
+	u32 n_shared_locks;
+	u32 n_excl_locks;
+	u32 max_shared_wait_us;
+	u32 max_excl_wait_us;
+
+	/* Background checkpointing */
+	u32 bg_checkpt_writes;		/* Non-GC page writes last seen */
+	unsigned long bg_checkpt_quiet;	/* jiffies since which they are unchanged */
+	u32 n_bg_checkpts;
+	u32 last_checkpt_us;		/* Duration of the last checkpoint write */
 };
 
 #define yaffs_dev_to_lc(dev) ((struct yaffs_linux_context *)((dev)->os_context))
@@ -125,7 +125,8 @@ int nandmtd2_read_chunk_tags(struct yaffs_dev *dev, int nand_chunk,
 		ops.len = data ? dev->data_bytes_per_chunk : packed_tags_size;
 		ops.ooboffs = 0;
 		ops.datbuf = data;
-		ops.oobbuf = yaffs_dev_to_lc(dev)->spare_buffer;
+		/* Readers can get here concurrently: unpack from the stack */
+		ops.oobbuf = packed_tags_ptr;
 		retval = mtd->read_oob(mtd, addr, &ops);
 	}
 
@@ -138,12 +139,8 @@ int nandmtd2_read_chunk_tags(struct yaffs_dev *dev, int nand_chunk,
 			yaffs_unpack_tags2_tags_only(tags, pt2tp);
 		}
 	} else {
-		if (tags) {
-			memcpy(packed_tags_ptr,
-			       yaffs_dev_to_lc(dev)->spare_buffer,
-			       packed_tags_size);
+		if (tags)
 			yaffs_unpack_tags2(tags, &pt, !dev->param.no_tags_ecc);
-		}
 	}
 
 	if (local_data)
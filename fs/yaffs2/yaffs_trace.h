@@ -18,6 +18,9 @@
 
 extern unsigned int yaffs_trace_mask;
 extern unsigned int yaffs_wr_attempts;
+extern unsigned int yaffs_scan_threads;
+extern unsigned int yaffs_gc_cost_benefit;
+extern unsigned int yaffs_cache_readahead;
 
 /*
  * Tracing flags.
@@ -16,6 +16,7 @@
 #include "yaffs_bitmap.h"
 #include "yaffs_getblockinfo.h"
 #include "yaffs_nand.h"
+#include "yaffs_extent.h"
 
 int yaffs_skip_verification(struct yaffs_dev *dev)
 {
@@ -263,19 +264,26 @@ void yaffs_verify_file(struct yaffs_obj *obj)
 		return;
 
 	for (i = 1; i <= last_chunk; i++) {
-		tn = yaffs_find_tnode_0(dev, &obj->variant.file_variant, i);
-
-		if (tn) {
-			u32 the_chunk = yaffs_get_group_base(dev, tn, i);
-			if (the_chunk > 0) {
-				yaffs_rd_chunk_tags_nand(dev, the_chunk, NULL,
-							 &tags);
-				if (tags.obj_id != obj_id || tags.chunk_id != i)
-				yaffs_trace(YAFFS_TRACE_VERIFY,
-					"Object %d chunk_id %d NAND mismatch chunk %d tags (%d:%d)",
-					 obj_id, i, the_chunk,
-					 tags.obj_id, tags.chunk_id);
-			}
+		u32 the_chunk = 0;
+
+		if (obj->variant.file_variant.extents) {
+			the_chunk =
+			    yaffs_extent_find(obj->variant.file_variant.extents,
+					      i);
+		} else {
+			tn = yaffs_find_tnode_0(dev, &obj->variant.file_variant,
+						i);
+			if (tn)
+				the_chunk = yaffs_get_group_base(dev, tn, i);
+		}
+
+		if (the_chunk > 0) {
+			yaffs_rd_chunk_tags_nand(dev, the_chunk, NULL, &tags);
+			if (tags.obj_id != obj_id || tags.chunk_id != i)
+			yaffs_trace(YAFFS_TRACE_VERIFY,
+				"Object %d chunk_id %d NAND mismatch chunk %d tags (%d:%d)",
+				 obj_id, i, the_chunk,
+				 tags.obj_id, tags.chunk_id);
 		}
 	}
 }
@@ -53,6 +53,7 @@
 #include <linux/kthread.h>
 #include <linux/delay.h>
 #include <linux/freezer.h>
+#include <linux/ktime.h>
 
 #include <asm/div64.h>
 
@@ -90,12 +91,19 @@ static uint32_t YCALCBLOCKS(uint64_t partition_size, uint32_t block_size)
 #include "yaffs_mtdif.h"
 #include "yaffs_mtdif1.h"
 #include "yaffs_mtdif2.h"
+#include "yaffs_checkptrw.h"
+#include "yaffs_extent.h"
 
 unsigned int yaffs_trace_mask = YAFFS_TRACE_BAD_BLOCKS | YAFFS_TRACE_ALWAYS;
 unsigned int yaffs_wr_attempts = YAFFS_WR_ATTEMPTS;
 unsigned int yaffs_auto_checkpoint = 1;
 unsigned int yaffs_gc_control = 1;
 unsigned int yaffs_bg_enable = 1;
+unsigned int yaffs_scan_threads = 2;
+unsigned int yaffs_bg_checkpoint;	/* seconds of quiet, 0 is off */
+unsigned int yaffs_gc_cost_benefit = 1;
+unsigned int yaffs_cache_chunks = 32;
+unsigned int yaffs_cache_readahead = 4;
 
 /* Module Parameters */
 module_param(yaffs_trace_mask, uint, 0644);
@@ -103,6 +111,11 @@ module_param(yaffs_wr_attempts, uint, 0644);
 module_param(yaffs_auto_checkpoint, uint, 0644);
 module_param(yaffs_gc_control, uint, 0644);
 module_param(yaffs_bg_enable, uint, 0644);
+module_param(yaffs_scan_threads, uint, 0644);
+module_param(yaffs_bg_checkpoint, uint, 0644);
+module_param(yaffs_gc_cost_benefit, uint, 0644);
+module_param(yaffs_cache_chunks, uint, 0644);
+module_param(yaffs_cache_readahead, uint, 0644);
 
 
 #define yaffs_inode_to_obj_lv(iptr) ((iptr)->i_private)
@@ -120,17 +133,62 @@ static unsigned yaffs_gc_control_callback(struct yaffs_dev *dev)
 	return yaffs_gc_control;
 }
 
+/* Microseconds since start, for the lock and checkpoint statistics */
+static u32 yaffs_us_since(ktime_t start)
+{
+	return min_t(s64, ktime_to_us(ktime_sub(ktime_get(), start)), UINT_MAX);
+}
+
+/*
+ * The gross lock is a per-device rw_semaphore.  Anything that may write to
+ * flash, allocate, garbage collect or change an object takes it exclusively
+ * through yaffs_gross_lock().  Lookups, readdir, readpage and the other pure
+ * reads take it shared through yaffs_shared_lock() and so only wait for
+ * writers, not for each other.
+ */
 static void yaffs_gross_lock(struct yaffs_dev *dev)
 {
+	struct yaffs_linux_context *lc = yaffs_dev_to_lc(dev);
+	ktime_t start = ktime_get();
+	u32 waited;
+
 	yaffs_trace(YAFFS_TRACE_LOCK, "yaffs locking %p", current);
-	mutex_lock(&(yaffs_dev_to_lc(dev)->gross_lock));
+	down_write(&lc->gross_lock);
 	yaffs_trace(YAFFS_TRACE_LOCK, "yaffs locked %p", current);
+
+	waited = yaffs_us_since(start);
+	lc->n_excl_locks++;
+	if (waited > lc->max_excl_wait_us)
+		lc->max_excl_wait_us = waited;
 }
 
 static void yaffs_gross_unlock(struct yaffs_dev *dev)
 {
 	yaffs_trace(YAFFS_TRACE_LOCK, "yaffs unlocking %p", current);
-	mutex_unlock(&(yaffs_dev_to_lc(dev)->gross_lock));
+	up_write(&(yaffs_dev_to_lc(dev)->gross_lock));
+}
+
+static void yaffs_shared_lock(struct yaffs_dev *dev)
+{
+	struct yaffs_linux_context *lc = yaffs_dev_to_lc(dev);
+	ktime_t start = ktime_get();
+	u32 waited;
+
+	yaffs_trace(YAFFS_TRACE_LOCK, "yaffs shared locking %p", current);
+	down_read(&lc->gross_lock);
+	yaffs_trace(YAFFS_TRACE_LOCK, "yaffs shared locked %p", current);
+
+	/* Several readers may race here, the statistics are approximate. */
+	waited = yaffs_us_since(start);
+	lc->n_shared_locks++;
+	if (waited > lc->max_shared_wait_us)
+		lc->max_shared_wait_us = waited;
+}
+
+static void yaffs_shared_unlock(struct yaffs_dev *dev)
+{
+	yaffs_trace(YAFFS_TRACE_LOCK, "yaffs shared unlocking %p", current);
+	up_read(&(yaffs_dev_to_lc(dev)->gross_lock));
 }
 
 static void yaffs_fill_inode_from_obj(struct inode *inode,
@@ -372,8 +430,7 @@ static struct dentry *yaffs_lookup(struct inode *dir, struct dentry *dentry,
 
 	struct yaffs_dev *dev = yaffs_inode_to_obj(dir)->my_dev;
 
-	if (current != yaffs_dev_to_lc(dev)->readdir_process)
-		yaffs_gross_lock(dev);
+	yaffs_shared_lock(dev);
 
 	yaffs_trace(YAFFS_TRACE_OS,
 		"yaffs_lookup for %d:%s",
@@ -384,8 +441,7 @@ static struct dentry *yaffs_lookup(struct inode *dir, struct dentry *dentry,
 	obj = yaffs_get_equivalent_obj(obj);	/* in case it was a hardlink */
 
 	/* Can't hold gross lock when calling yaffs_get_inode() */
-	if (current != yaffs_dev_to_lc(dev)->readdir_process)
-		yaffs_gross_unlock(dev);
+	yaffs_shared_unlock(dev);
 
 	if (obj) {
 		yaffs_trace(YAFFS_TRACE_OS,
@@ -599,9 +655,9 @@ static ssize_t yaffs_getxattr(struct dentry * dentry, const char *name, void *bu
 
 	if (error == 0) {
 		dev = obj->my_dev;
-		yaffs_gross_lock(dev);
+		yaffs_shared_lock(dev);
 		error = yaffs_get_xattrib(obj, name, buff, size);
-		yaffs_gross_unlock(dev);
+		yaffs_shared_unlock(dev);
 
 	}
 	yaffs_trace(YAFFS_TRACE_OS, "yaffs_getxattr done returning %d", error);
@@ -649,9 +705,9 @@ static ssize_t yaffs_listxattr(struct dentry * dentry, char *buff, size_t size)
 
 	if (error == 0) {
 		dev = obj->my_dev;
-		yaffs_gross_lock(dev);
+		yaffs_shared_lock(dev);
 		error = yaffs_list_xattrib(obj, buff, size);
-		yaffs_gross_unlock(dev);
+		yaffs_shared_unlock(dev);
 
 	}
 	yaffs_trace(YAFFS_TRACE_OS,
@@ -727,7 +783,9 @@ static struct yaffs_search_context *yaffs_new_search(struct yaffs_obj *dir)
 			    list_entry(dir->variant.dir_variant.children.next,
 				       struct yaffs_obj, siblings);
 		INIT_LIST_HEAD(&sc->others);
+		spin_lock(&yaffs_dev_to_lc(dev)->search_lock);
 		list_add(&sc->others, &(yaffs_dev_to_lc(dev)->search_contexts));
+		spin_unlock(&yaffs_dev_to_lc(dev)->search_lock);
 	}
 	return sc;
 }
@@ -738,7 +796,9 @@ static struct yaffs_search_context *yaffs_new_search(struct yaffs_obj *dir)
 static void yaffs_search_end(struct yaffs_search_context *sc)
 {
 	if (sc) {
+		spin_lock(&yaffs_dev_to_lc(sc->dev)->search_lock);
 		list_del(&sc->others);
+		spin_unlock(&yaffs_dev_to_lc(sc->dev)->search_lock);
 		kfree(sc);
 	}
 }
@@ -809,9 +869,7 @@ static int yaffs_readdir(struct file *f, void *dirent, filldir_t filldir)
 	obj = yaffs_dentry_to_obj(f->f_dentry);
 	dev = obj->my_dev;
 
-	yaffs_gross_lock(dev);
-
-	yaffs_dev_to_lc(dev)->readdir_process = current;
+	yaffs_shared_lock(dev);
 
 	offset = f->f_pos;
 
@@ -828,12 +886,12 @@ static int yaffs_readdir(struct file *f, void *dirent, filldir_t filldir)
 		yaffs_trace(YAFFS_TRACE_OS,
 			"yaffs_readdir: entry . ino %d",
 			(int)inode->i_ino);
-		yaffs_gross_unlock(dev);
+		yaffs_shared_unlock(dev);
 		if (filldir(dirent, ".", 1, offset, inode->i_ino, DT_DIR) < 0) {
-			yaffs_gross_lock(dev);
+			yaffs_shared_lock(dev);
 			goto out;
 		}
-		yaffs_gross_lock(dev);
+		yaffs_shared_lock(dev);
 		offset++;
 		f->f_pos++;
 	}
@@ -841,14 +899,14 @@ static int yaffs_readdir(struct file *f, void *dirent, filldir_t filldir)
 		yaffs_trace(YAFFS_TRACE_OS,
 			"yaffs_readdir: entry .. ino %d",
 			(int)f->f_dentry->d_parent->d_inode->i_ino);
-		yaffs_gross_unlock(dev);
+		yaffs_shared_unlock(dev);
 		if (filldir(dirent, "..", 2, offset,
 			    f->f_dentry->d_parent->d_inode->i_ino,
 			    DT_DIR) < 0) {
-			yaffs_gross_lock(dev);
+			yaffs_shared_lock(dev);
 			goto out;
 		}
-		yaffs_gross_lock(dev);
+		yaffs_shared_lock(dev);
 		offset++;
 		f->f_pos++;
 	}
@@ -875,17 +933,17 @@ static int yaffs_readdir(struct file *f, void *dirent, filldir_t filldir)
 				"yaffs_readdir: %s inode %d",
 				name, yaffs_get_obj_inode(l));
 
-			yaffs_gross_unlock(dev);
+			yaffs_shared_unlock(dev);
 
 			if (filldir(dirent,
 				    name,
 				    strlen(name),
 				    offset, this_inode, this_type) < 0) {
-				yaffs_gross_lock(dev);
+				yaffs_shared_lock(dev);
 				goto out;
 			}
 
-			yaffs_gross_lock(dev);
+			yaffs_shared_lock(dev);
 
 			offset++;
 			f->f_pos++;
@@ -895,8 +953,7 @@ static int yaffs_readdir(struct file *f, void *dirent, filldir_t filldir)
 
 out:
 	yaffs_search_end(sc);
-	yaffs_dev_to_lc(dev)->readdir_process = NULL;
-	yaffs_gross_unlock(dev);
+	yaffs_shared_unlock(dev);
 
 	return ret_val;
 }
@@ -924,6 +981,11 @@ static int yaffs_file_flush(struct file *file, fl_owner_t id)
 
 	yaffs_flush_file(obj, 1, 0);
 
+	/* The last writer is done, the chunk map can be packed */
+	if ((file->f_mode & FMODE_WRITE) &&
+	    atomic_read(&file->f_dentry->d_inode->i_writecount) <= 1)
+		yaffs_extent_pack(obj);
+
 	yaffs_gross_unlock(dev);
 
 	return 0;
@@ -1020,11 +1082,11 @@ static int yaffs_readlink(struct dentry *dentry, char __user * buffer,
 
 	struct yaffs_dev *dev = yaffs_dentry_to_obj(dentry)->my_dev;
 
-	yaffs_gross_lock(dev);
+	yaffs_shared_lock(dev);
 
 	alias = yaffs_get_symlink_alias(yaffs_dentry_to_obj(dentry));
 
-	yaffs_gross_unlock(dev);
+	yaffs_shared_unlock(dev);
 
 	if (!alias)
 		return -ENOMEM;
@@ -1040,10 +1102,10 @@ static void *yaffs_follow_link(struct dentry *dentry, struct nameidata *nd)
 	void *ret;
 	struct yaffs_dev *dev = yaffs_dentry_to_obj(dentry)->my_dev;
 
-	yaffs_gross_lock(dev);
+	yaffs_shared_lock(dev);
 
 	alias = yaffs_get_symlink_alias(yaffs_dentry_to_obj(dentry));
-	yaffs_gross_unlock(dev);
+	yaffs_shared_unlock(dev);
 
 	if (!alias) {
 		ret = ERR_PTR(-ENOMEM);
@@ -1148,12 +1210,13 @@ static int yaffs_readpage_nolock(struct file *f, struct page *pg)
 	pg_buf = kmap(pg);
 	/* FIXME: Can kmap fail? */
 
-	yaffs_gross_lock(dev);
+	yaffs_shared_lock(dev);
 
-	ret = yaffs_file_rd(obj, pg_buf,
-			    pg->index << PAGE_CACHE_SHIFT, PAGE_CACHE_SIZE);
+	ret = yaffs_file_rd_shared(obj, pg_buf,
+				   pg->index << PAGE_CACHE_SHIFT,
+				   PAGE_CACHE_SIZE);
 
-	yaffs_gross_unlock(dev);
+	yaffs_shared_unlock(dev);
 
 	if (ret >= 0)
 		ret = 0;
@@ -1461,7 +1524,7 @@ static int yaffs_statfs(struct dentry *dentry, struct kstatfs *buf)
 
 	yaffs_trace(YAFFS_TRACE_OS, "yaffs_statfs");
 
-	yaffs_gross_lock(dev);
+	yaffs_shared_lock(dev);
 
 	buf->f_type = YAFFS_MAGIC;
 	buf->f_bsize = sb->s_blocksize;
@@ -1513,7 +1576,7 @@ static int yaffs_statfs(struct dentry *dentry, struct kstatfs *buf)
 	buf->f_ffree = 0;
 	buf->f_bavail = buf->f_bfree;
 
-	yaffs_gross_unlock(dev);
+	yaffs_shared_unlock(dev);
 	return 0;
 }
 
@@ -1541,8 +1604,12 @@ static void yaffs_flush_super(struct super_block *sb, int do_checkpoint)
 	yaffs_flush_inodes(sb);
 	yaffs_update_dirty_dirs(dev);
 	yaffs_flush_whole_cache(dev);
-	if (do_checkpoint)
+	if (do_checkpoint && !dev->is_checkpointed) {
+		ktime_t start = ktime_get();
+
 		yaffs_checkpoint_save(dev);
+		yaffs_dev_to_lc(dev)->last_checkpt_us = yaffs_us_since(start);
+	}
 }
 
 static unsigned yaffs_bg_gc_urgency(struct yaffs_dev *dev)
@@ -1567,6 +1634,45 @@ static unsigned yaffs_bg_gc_urgency(struct yaffs_dev *dev)
 		return 2;
 }
 
+/*
+ * Write a checkpoint from the background thread once nothing, GC included,
+ * has written to or erased the device for yaffs_bg_checkpoint seconds.  A
+ * crash or an unmount then usually finds a valid checkpoint already in
+ * place, instead of scanning or having to write one.  Background GC keeps
+ * running afterwards, and by then has nothing left to collect.  Called with
+ * the gross lock held.
+ */
+static void yaffs_bg_checkpoint_check(struct yaffs_dev *dev,
+				      unsigned long now)
+{
+	struct yaffs_linux_context *context = yaffs_dev_to_lc(dev);
+	u32 writes = dev->n_page_writes + dev->n_erasures;
+
+	if (!yaffs_bg_checkpoint || dev->is_checkpointed ||
+	    dev->param.skip_checkpt_wr)
+		return;
+
+	if (writes != context->bg_checkpt_writes) {
+		context->bg_checkpt_writes = writes;
+		context->bg_checkpt_quiet = now;
+		return;
+	}
+
+	if (time_before(now, context->bg_checkpt_quiet +
+			yaffs_bg_checkpoint * HZ) ||
+	    yaffs_bg_gc_urgency(dev))
+		return;
+
+	yaffs_flush_super(context->super, 1);
+	context->super->s_dirt = 0;
+	context->n_bg_checkpts++;
+
+	yaffs_trace(YAFFS_TRACE_BACKGROUND | YAFFS_TRACE_CHECKPOINT,
+		"yaffs background checkpoint %s in %u us",
+		dev->is_checkpointed ? "written" : "failed",
+		context->last_checkpt_us);
+}
+
 static int yaffs_do_sync_fs(struct super_block *sb, int request_checkpoint)
 {
 
@@ -1646,11 +1752,17 @@ static int yaffs_bg_thread_fn(void *data)
 
 		if (time_after(now, next_dir_update) && yaffs_bg_enable) {
 			yaffs_update_dirty_dirs(dev);
+			yaffs2_checkpt_erase_stale(dev);
+			yaffs_bg_checkpoint_check(dev, now);
 			next_dir_update = now + HZ;
 		}
 
 		if (time_after(now, next_gc) && yaffs_bg_enable) {
-			if (!dev->is_checkpointed) {
+			/*
+			 * With background checkpoints a checkpoint does not
+			 * stop GC: it is written again once GC is idle.
+			 */
+			if (!dev->is_checkpointed || yaffs_bg_checkpoint) {
 				urgency = yaffs_bg_gc_urgency(dev);
 				gc_result = yaffs_bg_gc(dev, urgency);
 				if (urgency > 1)
@@ -1757,6 +1869,7 @@ struct yaffs_options {
 	int skip_checkpoint_read;
 	int skip_checkpoint_write;
 	int no_cache;
+	int extent_map;
 	int tags_ecc_on;
 	int tags_ecc_overridden;
 	int lazy_loading_enabled;
@@ -1812,6 +1925,8 @@ static int yaffs_parse_options(struct yaffs_options *options,
 			options->empty_lost_and_found_overridden = 1;
 		} else if (!strcmp(cur_opt, "no-cache")) {
 			options->no_cache = 1;
+		} else if (!strcmp(cur_opt, "extent-map")) {
+			options->extent_map = 1;
 		} else if (!strcmp(cur_opt, "no-checkpoint-read")) {
 			options->skip_checkpoint_read = 1;
 		} else if (!strcmp(cur_opt, "no-checkpoint-write")) {
@@ -1979,11 +2094,6 @@ static void yaffs_put_super(struct super_block *sb)
 	list_del_init(&(yaffs_dev_to_lc(dev)->context_list));
 	mutex_unlock(&yaffs_context_lock);
 
-	if (yaffs_dev_to_lc(dev)->spare_buffer) {
-		kfree(yaffs_dev_to_lc(dev)->spare_buffer);
-		yaffs_dev_to_lc(dev)->spare_buffer = NULL;
-	}
-
 	kfree(dev);
 }
 
@@ -2214,8 +2324,9 @@ static struct super_block *yaffs_internal_read_super(int yaffs_version,
 	param->chunks_per_block = YAFFS_CHUNKS_PER_BLOCK;
 	param->total_bytes_per_chunk = YAFFS_BYTES_PER_CHUNK;
 	param->n_reserved_blocks = 5;
-	param->n_caches = (options.no_cache) ? 0 : 10;
+	param->n_caches = (options.no_cache) ? 0 : yaffs_cache_chunks;
 	param->inband_tags = options.inband_tags;
+	param->extent_map = options.extent_map;
 
 #ifdef CONFIG_YAFFS_DISABLE_LAZY_LOAD
 	param->disable_lazy_load = 1;
@@ -2261,8 +2372,6 @@ static struct super_block *yaffs_internal_read_super(int yaffs_version,
 		param->read_chunk_tags_fn = nandmtd2_read_chunk_tags;
 		param->bad_block_fn = nandmtd2_mark_block_bad;
 		param->query_block_fn = nandmtd2_query_block;
-		yaffs_dev_to_lc(dev)->spare_buffer = 
-		                kmalloc(mtd->oobsize, GFP_NOFS);
 		param->is_yaffs2 = 1;
 		param->total_bytes_per_chunk = mtd->writesize;
 		param->chunks_per_block = mtd->erasesize / mtd->writesize;
@@ -2317,9 +2426,10 @@ static struct super_block *yaffs_internal_read_super(int yaffs_version,
 
 	/* Directory search handling... */
 	INIT_LIST_HEAD(&(yaffs_dev_to_lc(dev)->search_contexts));
+	spin_lock_init(&(yaffs_dev_to_lc(dev)->search_lock));
 	param->remove_obj_fn = yaffs_remove_obj_callback;
 
-	mutex_init(&(yaffs_dev_to_lc(dev)->gross_lock));
+	init_rwsem(&(yaffs_dev_to_lc(dev)->gross_lock));
 
 	yaffs_gross_lock(dev);
 
@@ -2436,6 +2546,7 @@ static char *yaffs_dump_dev_part0(char *buf, struct yaffs_dev *dev)
 	buf += sprintf(buf, "refresh_period........ %d\n",
 			param->refresh_period);
 	buf += sprintf(buf, "n_caches.............. %d\n", param->n_caches);
+	buf += sprintf(buf, "extent_map............ %d\n", param->extent_map);
 	buf += sprintf(buf, "n_reserved_blocks..... %d\n",
 			param->n_reserved_blocks);
 	buf += sprintf(buf, "always_check_erased... %d\n",
@@ -2444,8 +2555,20 @@ static char *yaffs_dump_dev_part0(char *buf, struct yaffs_dev *dev)
 	return buf;
 }
 
+/* Flash writes per chunk written on behalf of users, times 100 */
+static unsigned yaffs_write_amp_x100(struct yaffs_dev *dev)
+{
+	u32 user_writes = dev->n_page_writes - dev->n_gc_copies;
+
+	if (!user_writes)
+		return 0;
+	return div_u64((u64)dev->n_page_writes * 100, user_writes);
+}
+
 static char *yaffs_dump_dev_part1(char *buf, struct yaffs_dev *dev)
 {
+	struct yaffs_linux_context *lc = yaffs_dev_to_lc(dev);
+
 	buf +=
 	    sprintf(buf, "data_bytes_per_chunk.. %d\n",
 		    dev->data_bytes_per_chunk);
@@ -2457,6 +2580,12 @@ static char *yaffs_dump_dev_part1(char *buf, struct yaffs_dev *dev)
 	    sprintf(buf, "blocks_in_checkpt..... %d\n", dev->blocks_in_checkpt);
 	buf += sprintf(buf, "\n");
 	buf += sprintf(buf, "n_tnodes.............. %d\n", dev->n_tnodes);
+	buf += sprintf(buf, "tnode_bytes........... %d\n",
+			dev->n_tnodes * dev->tnode_size);
+	buf += sprintf(buf, "n_extent_maps......... %d\n", dev->n_extent_maps);
+	buf += sprintf(buf, "extent_bytes.......... %u\n", dev->extent_bytes);
+	buf += sprintf(buf, "extent_tnodes_saved... %d\n",
+			dev->n_extent_groups);
 	buf += sprintf(buf, "n_obj................. %d\n", dev->n_obj);
 	buf += sprintf(buf, "n_free_chunks......... %d\n", dev->n_free_chunks);
 	buf += sprintf(buf, "\n");
@@ -2471,6 +2600,10 @@ static char *yaffs_dump_dev_part1(char *buf, struct yaffs_dev *dev)
 	    sprintf(buf, "oldest_dirty_gc_count. %u\n",
 		    dev->oldest_dirty_gc_count);
 	buf += sprintf(buf, "n_gc_blocks........... %u\n", dev->n_gc_blocks);
+	buf += sprintf(buf, "gc_copies_per_block... %u\n",
+			dev->n_gc_blocks ? dev->n_gc_copies / dev->n_gc_blocks : 0);
+	buf += sprintf(buf, "write_amp_x100........ %u\n",
+			yaffs_write_amp_x100(dev));
 	buf += sprintf(buf, "bg_gcs................ %u\n", dev->bg_gcs);
 	buf +=
 	    sprintf(buf, "n_retired_writes...... %u\n", dev->n_retired_writes);
@@ -2484,12 +2617,30 @@ static char *yaffs_dump_dev_part1(char *buf, struct yaffs_dev *dev)
 	    sprintf(buf, "n_tags_ecc_unfixed.... %u\n",
 		    dev->n_tags_ecc_unfixed);
 	buf += sprintf(buf, "cache_hits............ %u\n", dev->cache_hits);
+	buf += sprintf(buf, "cache_misses.......... %u\n", dev->cache_misses);
+	buf += sprintf(buf, "cache_ra_chunks....... %u\n", dev->cache_ra_chunks);
+	buf += sprintf(buf, "cache_ra_hits......... %u\n", dev->cache_ra_hits);
 	buf +=
 	    sprintf(buf, "n_deleted_files....... %u\n", dev->n_deleted_files);
 	buf +=
 	    sprintf(buf, "n_unlinked_files...... %u\n", dev->n_unlinked_files);
 	buf += sprintf(buf, "refresh_count......... %u\n", dev->refresh_count);
 	buf += sprintf(buf, "n_bg_deletions........ %u\n", dev->n_bg_deletions);
+	buf += sprintf(buf, "scan_threads.......... %u\n", dev->scan_threads);
+	buf += sprintf(buf, "scan_blocks........... %u\n", dev->scan_blocks);
+	buf += sprintf(buf, "scan_query_us......... %u\n", dev->scan_query_us);
+	buf += sprintf(buf, "scan_sort_us.......... %u\n", dev->scan_sort_us);
+	buf += sprintf(buf, "scan_chunks_us........ %u\n", dev->scan_chunks_us);
+	buf += sprintf(buf, "scan_fixup_us......... %u\n", dev->scan_fixup_us);
+	buf += sprintf(buf, "n_excl_locks.......... %u\n", lc->n_excl_locks);
+	buf += sprintf(buf, "max_excl_wait_us...... %u\n",
+			lc->max_excl_wait_us);
+	buf += sprintf(buf, "n_shared_locks........ %u\n", lc->n_shared_locks);
+	buf += sprintf(buf, "max_shared_wait_us.... %u\n",
+			lc->max_shared_wait_us);
+	buf += sprintf(buf, "n_bg_checkpts......... %u\n", lc->n_bg_checkpts);
+	buf += sprintf(buf, "last_checkpt_us....... %u\n",
+			lc->last_checkpt_us);
 
 	return buf;
 }
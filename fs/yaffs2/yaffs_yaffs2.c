@@ -20,6 +20,7 @@
 #include "yaffs_getblockinfo.h"
 #include "yaffs_verify.h"
 #include "yaffs_attribs.h"
+#include "yaffs_extent.h"
 
 /*
  * Checkpoints are really no benefit on very small partitions.
@@ -228,7 +229,8 @@ int yaffs_calc_checkpt_blocks_required(struct yaffs_dev *dev)
 		n_bytes +=
 		    (sizeof(struct yaffs_checkpt_obj) +
 		     sizeof(u32)) * (dev->n_obj);
-		n_bytes += (dev->tnode_size + sizeof(u32)) * (dev->n_tnodes);
+		n_bytes += (dev->tnode_size + sizeof(u32)) *
+		    (dev->n_tnodes + dev->n_extent_groups);
 		n_bytes += sizeof(struct yaffs_checkpt_validity);
 		n_bytes += sizeof(u32);	/* checksum */
 
@@ -497,7 +499,14 @@ static int yaffs2_wr_checkpt_tnodes(struct yaffs_obj *obj)
 	u32 end_marker = ~0;
 	int ok = 1;
 
-	if (obj->variant_type == YAFFS_OBJECT_TYPE_FILE) {
+	if (obj->variant_type == YAFFS_OBJECT_TYPE_FILE &&
+	    obj->variant.file_variant.extents) {
+		ok = yaffs_extent_wr_checkpt(obj);
+		if (ok)
+			ok = (yaffs2_checkpt_wr
+			      (obj->my_dev, &end_marker,
+			       sizeof(end_marker)) == sizeof(end_marker));
+	} else if (obj->variant_type == YAFFS_OBJECT_TYPE_FILE) {
 		ok = yaffs2_checkpt_tnode_worker(obj,
 						 obj->variant.file_variant.top,
 						 obj->variant.file_variant.
@@ -954,6 +963,312 @@ static int yaffs2_ybicmp(const void *a, const void *b)
 		return aseq - bseq;
 }
 
+/*
+ * Scan pipelining.
+ *
+ * Reading tags is what makes a scan without a checkpoint slow.
+ * yaffs2_scan_backwards() has to process the blocks strictly in sequence
+ * order, but the reads behind it are independent, so up to
+ * yaffs_scan_threads reader threads do them ahead of it: first the state
+ * query of every block, then the tags of every chunk of the blocks to be
+ * scanned, into a ring holding YAFFS_SCAN_AHEAD blocks per thread.  The
+ * readers only go through yaffs_rd_chunk_tags_nand(), which is safe to run
+ * concurrently, and never touch the object tree.
+ */
+#define YAFFS_SCAN_MAX_THREADS	4
+#define YAFFS_SCAN_AHEAD	2
+#define YAFFS_SCAN_BATCH	16
+
+struct yaffs_scan_query {
+	u32 seq_number;
+	enum yaffs_block_state state;
+};
+
+struct yaffs_scan_slot {
+	int pos;			/* Scan position held, -1 if none yet */
+	struct yaffs_ext_tags *tags;	/* chunks_per_block entries */
+};
+
+struct yaffs_scan_pipe {
+	struct yaffs_dev *dev;
+	spinlock_t lock;
+	wait_queue_head_t wq;
+	int next;		/* Next block (query) or position (tags) to claim */
+	int consumed;		/* Positions finished by the scanner */
+	int n_busy;		/* Readers still working */
+	int abort;
+
+	/* Block state query, indexed from internal_start_block */
+	struct yaffs_scan_query *query;
+
+	/* Chunk tags, position 0 being the last entry of block_index */
+	struct yaffs_block_index *block_index;
+	int n_to_scan;
+	int depth;
+	struct yaffs_scan_slot *slots;
+	struct yaffs_ext_tags *tags;
+
+	int n_threads;
+	struct task_struct *threads[YAFFS_SCAN_MAX_THREADS];
+};
+
+static void *yaffs2_scan_alloc(size_t size)
+{
+	void *p = kmalloc(size, GFP_NOFS);
+
+	if (!p)
+		p = vmalloc(size);
+	return p;
+}
+
+static void yaffs2_scan_free(void *p)
+{
+	if (is_vmalloc_addr(p))
+		vfree(p);
+	else
+		kfree(p);
+}
+
+static u32 yaffs2_scan_lap_us(ktime_t *since)
+{
+	ktime_t now = ktime_get();
+	s64 us = ktime_to_us(ktime_sub(now, *since));
+
+	*since = now;
+	return min_t(s64, us, UINT_MAX);
+}
+
+static void yaffs2_scan_query_blocks(struct yaffs_scan_pipe *pipe)
+{
+	struct yaffs_dev *dev = pipe->dev;
+	struct yaffs_scan_query *q;
+	int first, blk;
+
+	while (!pipe->abort) {
+		spin_lock(&pipe->lock);
+		first = pipe->next;
+		pipe->next += YAFFS_SCAN_BATCH;
+		spin_unlock(&pipe->lock);
+
+		if (first > dev->internal_end_block)
+			break;
+
+		for (blk = first; blk < first + YAFFS_SCAN_BATCH &&
+		     blk <= dev->internal_end_block; blk++) {
+			q = &pipe->query[blk - dev->internal_start_block];
+			yaffs_query_init_block_state(dev, blk, &q->state,
+						     &q->seq_number);
+		}
+	}
+}
+
+static void yaffs2_scan_read_tags(struct yaffs_scan_pipe *pipe)
+{
+	struct yaffs_dev *dev = pipe->dev;
+	struct yaffs_scan_slot *slot;
+	int pos, blk, c;
+
+	while (!pipe->abort) {
+		spin_lock(&pipe->lock);
+		pos = pipe->next++;
+		spin_unlock(&pipe->lock);
+
+		if (pos >= pipe->n_to_scan)
+			break;
+
+		/* Don't run further ahead than the ring allows */
+		wait_event(pipe->wq, pipe->abort ||
+			   pos < pipe->consumed + pipe->depth);
+		if (pipe->abort)
+			break;
+
+		slot = &pipe->slots[pos % pipe->depth];
+		blk = pipe->block_index[pipe->n_to_scan - 1 - pos].block;
+		for (c = 0; c < dev->param.chunks_per_block; c++)
+			yaffs_rd_chunk_tags_nand(dev,
+				blk * dev->param.chunks_per_block + c,
+				NULL, &slot->tags[c]);
+
+		spin_lock(&pipe->lock);
+		slot->pos = pos;
+		spin_unlock(&pipe->lock);
+		wake_up_all(&pipe->wq);
+	}
+}
+
+static int yaffs2_scan_thread(void *data)
+{
+	struct yaffs_scan_pipe *pipe = data;
+
+	if (pipe->slots)
+		yaffs2_scan_read_tags(pipe);
+	else
+		yaffs2_scan_query_blocks(pipe);
+
+	spin_lock(&pipe->lock);
+	pipe->n_busy--;
+	spin_unlock(&pipe->lock);
+	wake_up_all(&pipe->wq);
+
+	/* Stay around until yaffs2_scan_stop() reaps us */
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	__set_current_state(TASK_RUNNING);
+	return 0;
+}
+
+static void yaffs2_scan_start(struct yaffs_scan_pipe *pipe, int first)
+{
+	struct task_struct *t;
+	int i, n;
+
+	n = min_t(int, yaffs_scan_threads, YAFFS_SCAN_MAX_THREADS);
+
+	pipe->next = first;
+	pipe->consumed = 0;
+	pipe->abort = 0;
+	pipe->n_threads = 0;
+	for (i = 0; i < n; i++) {
+		spin_lock(&pipe->lock);
+		pipe->n_busy++;
+		spin_unlock(&pipe->lock);
+
+		t = kthread_run(yaffs2_scan_thread, pipe, "yaffs-scan/%d", i);
+		if (IS_ERR(t)) {
+			spin_lock(&pipe->lock);
+			pipe->n_busy--;
+			spin_unlock(&pipe->lock);
+			break;
+		}
+		pipe->threads[pipe->n_threads++] = t;
+	}
+}
+
+static void yaffs2_scan_stop(struct yaffs_scan_pipe *pipe)
+{
+	int i;
+
+	spin_lock(&pipe->lock);
+	pipe->abort = 1;
+	spin_unlock(&pipe->lock);
+	wake_up_all(&pipe->wq);
+
+	for (i = 0; i < pipe->n_threads; i++)
+		kthread_stop(pipe->threads[i]);
+	pipe->n_threads = 0;
+	pipe->n_busy = 0;
+}
+
+/*
+ * Query the state of every block.  The calling thread takes part, so this
+ * works even if no reader could be started.
+ */
+static struct yaffs_scan_pipe *yaffs2_scan_query_all(struct yaffs_dev *dev,
+						      int n_blocks)
+{
+	struct yaffs_scan_pipe *pipe;
+
+	if (!yaffs_scan_threads)
+		return NULL;
+
+	pipe = kzalloc(sizeof(*pipe), GFP_NOFS);
+	if (!pipe)
+		return NULL;
+
+	pipe->query = yaffs2_scan_alloc(n_blocks * sizeof(*pipe->query));
+	if (!pipe->query) {
+		kfree(pipe);
+		return NULL;
+	}
+
+	pipe->dev = dev;
+	spin_lock_init(&pipe->lock);
+	init_waitqueue_head(&pipe->wq);
+
+	yaffs2_scan_start(pipe, dev->internal_start_block);
+	yaffs2_scan_query_blocks(pipe);
+	wait_event(pipe->wq, pipe->n_busy == 0);
+	yaffs2_scan_stop(pipe);
+
+	return pipe;
+}
+
+/*
+ * Start reading chunk tags ahead of the scanner.  If that isn't possible
+ * the scanner reads the tags itself, as yaffs2_scan_wait_block() then
+ * returns NULL.
+ */
+static void yaffs2_scan_tags_start(struct yaffs_scan_pipe *pipe,
+				   struct yaffs_block_index *block_index,
+				   int n_to_scan)
+{
+	struct yaffs_dev *dev = pipe->dev;
+	int i;
+
+	pipe->depth = YAFFS_SCAN_AHEAD *
+	    min_t(int, yaffs_scan_threads, YAFFS_SCAN_MAX_THREADS);
+	pipe->slots = kcalloc(pipe->depth, sizeof(*pipe->slots), GFP_NOFS);
+	pipe->tags = yaffs2_scan_alloc(pipe->depth *
+				       dev->param.chunks_per_block *
+				       sizeof(*pipe->tags));
+	if (!pipe->slots || !pipe->tags) {
+		kfree(pipe->slots);
+		pipe->slots = NULL;
+		return;
+	}
+
+	for (i = 0; i < pipe->depth; i++) {
+		pipe->slots[i].pos = -1;
+		pipe->slots[i].tags =
+		    &pipe->tags[i * dev->param.chunks_per_block];
+	}
+	pipe->block_index = block_index;
+	pipe->n_to_scan = n_to_scan;
+
+	yaffs2_scan_start(pipe, 0);
+	dev->scan_threads = pipe->n_threads;
+}
+
+static struct yaffs_ext_tags *yaffs2_scan_wait_block(struct yaffs_scan_pipe
+						     *pipe, int pos)
+{
+	struct yaffs_scan_slot *slot;
+
+	if (!pipe || !pipe->n_threads)
+		return NULL;
+
+	slot = &pipe->slots[pos % pipe->depth];
+	wait_event(pipe->wq, slot->pos == pos);
+	return slot->tags;
+}
+
+static void yaffs2_scan_done_block(struct yaffs_scan_pipe *pipe, int pos)
+{
+	if (!pipe || !pipe->n_threads)
+		return;
+
+	spin_lock(&pipe->lock);
+	pipe->consumed = pos + 1;
+	spin_unlock(&pipe->lock);
+	wake_up_all(&pipe->wq);
+}
+
+static void yaffs2_scan_destroy(struct yaffs_scan_pipe *pipe)
+{
+	if (!pipe)
+		return;
+
+	yaffs2_scan_stop(pipe);
+	if (pipe->tags)
+		yaffs2_scan_free(pipe->tags);
+	kfree(pipe->slots);
+	yaffs2_scan_free(pipe->query);
+	kfree(pipe);
+}
+
 int yaffs2_scan_backwards(struct yaffs_dev *dev)
 {
 	struct yaffs_ext_tags tags;
@@ -987,6 +1302,10 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 	struct yaffs_block_index *block_index = NULL;
 	int alt_block_index = 0;
 
+	struct yaffs_scan_pipe *pipe;
+	struct yaffs_ext_tags *tags_row;
+	ktime_t lap = ktime_get();
+
 	yaffs_trace(YAFFS_TRACE_SCAN,
 		"yaffs2_scan_backwards starts  intstartblk %d intendblk %d...",
 		dev->internal_start_block, dev->internal_end_block);
@@ -1013,6 +1332,9 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 	chunk_data = yaffs_get_temp_buffer(dev, __LINE__);
 
+	dev->scan_threads = 0;
+	pipe = yaffs2_scan_query_all(dev, n_blocks);
+
 	/* Scan all the blocks to determine their state */
 	bi = dev->block_info;
 	for (blk = dev->internal_start_block; blk <= dev->internal_end_block;
@@ -1021,7 +1343,14 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 		bi->pages_in_use = 0;
 		bi->soft_del_pages = 0;
 
-		yaffs_query_init_block_state(dev, blk, &state, &seq_number);
+		if (pipe) {
+			state = pipe->query[blk - dev->internal_start_block].state;
+			seq_number = pipe->query[blk -
+					dev->internal_start_block].seq_number;
+		} else {
+			yaffs_query_init_block_state(dev, blk, &state,
+						     &seq_number);
+		}
 
 		bi->block_state = state;
 		bi->seq_number = seq_number;
@@ -1071,6 +1400,9 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 	yaffs_trace(YAFFS_TRACE_SCAN, "%d blocks to be sorted...", n_to_scan);
 
+	dev->scan_query_us = yaffs2_scan_lap_us(&lap);
+	dev->scan_blocks = n_to_scan;
+
 	cond_resched();
 
 	/* Sort the blocks by sequence number */
@@ -1081,11 +1413,16 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 	yaffs_trace(YAFFS_TRACE_SCAN, "...done");
 
+	dev->scan_sort_us = yaffs2_scan_lap_us(&lap);
+
 	/* Now scan the blocks looking at the data. */
 	start_iter = 0;
 	end_iter = n_to_scan - 1;
 	yaffs_trace(YAFFS_TRACE_SCAN_DEBUG, "%d blocks to scan", n_to_scan);
 
+	if (pipe)
+		yaffs2_scan_tags_start(pipe, block_index, n_to_scan);
+
 	/* For each block.... backwards */
 	for (block_iter = end_iter; !alloc_failed && block_iter >= start_iter;
 	     block_iter--) {
@@ -1102,6 +1439,8 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 		deleted = 0;
 
+		tags_row = yaffs2_scan_wait_block(pipe, end_iter - block_iter);
+
 		/* For each chunk in each block that needs scanning.... */
 		found_chunks = 0;
 		for (c = dev->param.chunks_per_block - 1;
@@ -1114,8 +1453,11 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 			chunk = blk * dev->param.chunks_per_block + c;
 
-			result = yaffs_rd_chunk_tags_nand(dev, chunk, NULL,
-							  &tags);
+			if (tags_row)
+				tags = tags_row[c];
+			else
+				result = yaffs_rd_chunk_tags_nand(dev, chunk,
+								  NULL, &tags);
 
 			/* Let's have a good look at this chunk... */
 
@@ -1571,8 +1913,13 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 			yaffs_block_became_dirty(dev, blk);
 		}
 
+		yaffs2_scan_done_block(pipe, end_iter - block_iter);
 	}
 
+	yaffs2_scan_destroy(pipe);
+
+	dev->scan_chunks_us = yaffs2_scan_lap_us(&lap);
+
 	yaffs_skip_rest_of_block(dev);
 
 	if (alt_block_index)
@@ -1589,9 +1936,16 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 	yaffs_release_temp_buffer(dev, chunk_data, __LINE__);
 
+	dev->scan_fixup_us = yaffs2_scan_lap_us(&lap);
+
 	if (alloc_failed)
 		return YAFFS_FAIL;
 
+	yaffs_trace(YAFFS_TRACE_ALWAYS,
+		"yaffs2 scan: %u blocks, %u threads, query %u us, sort %u us, chunks %u us, fixup %u us",
+		dev->scan_blocks, dev->scan_threads, dev->scan_query_us,
+		dev->scan_sort_us, dev->scan_chunks_us, dev->scan_fixup_us);
+
 	yaffs_trace(YAFFS_TRACE_SCAN, "yaffs2_scan_backwards ends");
 
 	return YAFFS_OK;
@@ -20,6 +20,11 @@
 #include <linux/kernel.h>
 #include <linux/mm.h>
 #include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+#include <linux/wait.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
 #include <linux/string.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
@@ -18,6 +18,9 @@ extern int sysctl_compaction_handler(struct ctl_table *table, int write,
 extern int sysctl_extfrag_threshold;
 extern int sysctl_extfrag_handler(struct ctl_table *table, int write,
 			void __user *buffer, size_t *length, loff_t *ppos);
+extern int sysctl_compact_proactive_order;
+extern int sysctl_compact_proactive_pages;
+extern int sysctl_compact_proactive_interval;
 
 extern int fragmentation_index(struct zone *zone, unsigned int order);
 extern unsigned long try_to_compact_pages(struct zonelist *zonelist,
@@ -26,6 +29,7 @@ extern unsigned long try_to_compact_pages(struct zonelist *zonelist,
 extern unsigned long compaction_suitable(struct zone *zone, int order);
 extern unsigned long compact_zone_order(struct zone *zone, int order,
 					gfp_t gfp_mask, bool sync);
+extern void compact_pgdat_proactive(struct pglist_data *pgdat, int order);
 
 /* Do not skip compaction more than 64 times */
 #define COMPACT_MAX_DEFER_SHIFT 6
@@ -75,6 +79,11 @@ static inline unsigned long compact_zone_order(struct zone *zone, int order,
 	return COMPACT_CONTINUE;
 }
 
+static inline void compact_pgdat_proactive(struct pglist_data *pgdat,
+					   int order)
+{
+}
+
 static inline void defer_compaction(struct zone *zone)
 {
 }
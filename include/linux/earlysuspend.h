@@ -18,6 +18,7 @@
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
 #include <linux/list.h>
+#include <linux/async.h>
 #endif
 
 /* The early_suspend structure defines suspend and resume hooks to be called
@@ -29,6 +30,12 @@
  * the suspend handlers have already been called without a matching call to the
  * resume handlers, the suspend handler will be called directly from
  * register_early_suspend. This direct call can violate the normal level order.
+ * Handlers with async set are started in level order but not waited for, so
+ * they run concurrently with the handlers that follow them. A handler that
+ * needs another one set depends_on to it: depends_on must have a higher level,
+ * and its suspend handler is not started before this handler's has returned,
+ * nor this resume handler before its resume handler has returned. All
+ * handlers have returned before the system is allowed to suspend.
  */
 enum {
 	EARLY_SUSPEND_LEVEL_BLANK_SCREEN = 50,
@@ -39,8 +46,12 @@ struct early_suspend {
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	struct list_head link;
 	int level;
+	bool async;
+	struct early_suspend *depends_on;
 	void (*suspend)(struct early_suspend *h);
 	void (*resume)(struct early_suspend *h);
+	async_cookie_t cookie;		/* set while the handlers run */
+	async_cookie_t after;
 #endif
 };
 
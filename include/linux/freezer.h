@@ -104,6 +104,11 @@ static inline void freezer_count(void)
 {
 	if (current->mm) {
 		current->flags &= ~PF_FREEZER_SKIP;
+		/*
+		 * Pairs with the barrier in freeze_task(): either the freezer
+		 * sees PF_FREEZER_SKIP cleared or we see TIF_FREEZE.
+		 */
+		smp_mb();
 		try_to_freeze();
 	}
 }
@@ -116,6 +121,31 @@ static inline int freezer_should_skip(struct task_struct *p)
 	return !!(p->flags & PF_FREEZER_SKIP);
 }
 
+/*
+ * Freezer-friendly wrappers around schedule() and schedule_hrtimeout_range()
+ * for interruptible sleeps that a user space task may be frozen in at any
+ * time, i.e. where it holds no locks and has nothing to undo.  The freezer
+ * does not wait for tasks sleeping here and, in the fast mode, does not even
+ * wake them up; they freeze themselves on their next wakeup instead.
+ */
+static inline void freezable_schedule(void)
+{
+	freezer_do_not_count();
+	schedule();
+	freezer_count();
+}
+
+static inline int freezable_schedule_hrtimeout_range(ktime_t *expires,
+		unsigned long delta, const enum hrtimer_mode mode)
+{
+	int ret;
+
+	freezer_do_not_count();
+	ret = schedule_hrtimeout_range(expires, delta, mode);
+	freezer_count();
+	return ret;
+}
+
 /*
  * Tell the freezer that the current task should be frozen by it
  */
@@ -180,6 +210,10 @@ static inline void freezer_do_not_count(void) {}
 static inline void freezer_count(void) {}
 static inline int freezer_should_skip(struct task_struct *p) { return 0; }
 static inline void set_freezable(void) {}
+
+#define freezable_schedule()	schedule()
+#define freezable_schedule_hrtimeout_range(expires, delta, mode)	\
+		schedule_hrtimeout_range(expires, delta, mode)
 static inline void set_freezable_with_signal(void) {}
 
 #define wait_event_freezable(wq, condition)				\
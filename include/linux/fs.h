@@ -648,6 +648,9 @@ struct address_space {
 	spinlock_t		private_lock;	/* for use by the address_space */
 	struct list_head	private_list;	/* ditto */
 	struct address_space	*assoc_mapping;	/* ditto */
+#ifdef CONFIG_READAHEAD_FEEDBACK
+	unsigned long		ra_wasted;	/* read ahead pages evicted unused */
+#endif
 } __attribute__((aligned(sizeof(long))));
 	/*
 	 * On most architectures that alignment is already the case; but
@@ -920,6 +923,12 @@ struct file_ra_state {
 	unsigned int ra_pages;		/* Maximum readahead window */
 	unsigned int mmap_miss;		/* Cache miss stat for mmap accesses */
 	loff_t prev_pos;		/* Cache last read() position */
+#ifdef CONFIG_READAHEAD_FEEDBACK
+	unsigned int max_pages;		/* Window cap from feedback, 0 if none */
+	unsigned int used;		/* Read ahead pages used through this file */
+	unsigned int used_mark;		/* used at the last cap change */
+	unsigned long wasted_mark;	/* mapping->ra_wasted when last seen */
+#endif
 };
 
 /*
@@ -0,0 +1,88 @@
+/*
+ * include/linux/launchra.h
+ *
+ * Application launch readahead: record the page cache faults of a
+ * process group, replay them as readahead on the next launch.
+ *
+ * Copyright (C) 2011 Meizu Technology Co.Ltd, Zhuhai, China
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LINUX_LAUNCHRA_H
+#define _LINUX_LAUNCHRA_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+#define LAUNCHRA_MAGIC		0x4c524131	/* "LRA1" */
+
+/*
+ * A trace is a struct launchra_trace, then names_size bytes of file
+ * names, each NUL terminated, then nr_ranges struct launchra_range
+ * sorted by file and page.  All fields are in host byte order.
+ */
+struct launchra_trace {
+	__u32 magic;
+	__u32 size;		/* of the whole trace, in bytes */
+	__u32 nr_files;
+	__u32 names_size;	/* multiple of 4 */
+	__u32 nr_ranges;
+	__u32 reserved;
+};
+
+struct launchra_range {
+	__u32 file;		/* index of the file name */
+	__u32 start;		/* first page */
+	__u32 nr_pages;
+};
+
+/* Returned by LAUNCHRA_STOP */
+struct launchra_stats {
+	__u32 faults;		/* page cache faults of the process group */
+	__u32 major_faults;	/* ... which had to read the page */
+	__u32 dropped;		/* faults that didn't fit in the trace */
+	__u32 nr_files;
+	__u32 nr_ranges;	/* in the trace */
+	__u32 nr_pages;		/* covered by the ranges */
+	__u32 size;		/* of the trace, in bytes */
+};
+
+struct launchra_replay {
+	__u64 trace;		/* user pointer to a trace */
+	__u32 size;
+	__u32 nr_pages;		/* out: pages read ahead */
+};
+
+#define __LAUNCHRAIOC		0x78
+
+/* Record the faults of process group arg, until LAUNCHRA_STOP */
+#define LAUNCHRA_RECORD		_IO(__LAUNCHRAIOC, 1)
+/* Stop recording; the trace can then be read() from the device */
+#define LAUNCHRA_STOP		_IOR(__LAUNCHRAIOC, 2, struct launchra_stats)
+#define LAUNCHRA_REPLAY		_IOWR(__LAUNCHRAIOC, 3, struct launchra_replay)
+
+#ifdef __KERNEL__
+
+struct file;
+
+#ifdef CONFIG_LAUNCH_READAHEAD
+extern int launchra_recording;
+extern void __launchra_fault(struct file *file, pgoff_t offset, int major);
+
+static inline void launchra_fault(struct file *file, pgoff_t offset, int major)
+{
+	if (unlikely(launchra_recording))
+		__launchra_fault(file, offset, major);
+}
+#else
+static inline void launchra_fault(struct file *file, pgoff_t offset, int major)
+{
+}
+#endif
+
+#endif /* __KERNEL__ */
+
+#endif	/* _LINUX_LAUNCHRA_H */
@@ -106,6 +106,8 @@ enum zone_stat_item {
 	NR_SHMEM,		/* shmem pages (included tmpfs/GEM pages) */
 	NR_DIRTIED,		/* page dirtyings since bootup */
 	NR_WRITTEN,		/* page writings since bootup */
+	WORKINGSET_REFAULT,	/* evicted file pages read in again */
+	WORKINGSET_ACTIVATE,	/* ... soon enough to be activated */
 #ifdef CONFIG_NUMA
 	NUMA_HIT,		/* allocated in intended node */
 	NUMA_MISS,		/* allocated in non intended node */
@@ -334,6 +336,11 @@ struct zone {
 	 */
 	unsigned int		compact_considered;
 	unsigned int		compact_defer_shift;
+	/* Where the migrate scanner of proactive compaction resumes */
+	unsigned long		compact_proactive_pfn;
+	/* As above, for proactive compaction only */
+	unsigned int		compact_proactive_considered;
+	unsigned int		compact_proactive_defer_shift;
 #endif
 
 	ZONE_PADDING(_pad1_)
@@ -358,6 +365,8 @@ struct zone {
 	 */
 	unsigned int inactive_ratio;
 
+	/* Evictions and activations of file pages, see mm/workingset.c */
+	atomic_long_t		inactive_age;
 
 	ZONE_PADDING(_pad2_)
 	/* Rarely used or read-mostly fields */
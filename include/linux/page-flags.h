@@ -106,6 +106,9 @@ enum pageflags {
 #endif
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 	PG_compound_lock,
+#endif
+#ifdef CONFIG_READAHEAD_FEEDBACK
+	PG_ra_unused,		/* Read ahead, not accessed yet */
 #endif
 	__NR_PAGEFLAGS,
 
@@ -278,6 +281,13 @@ PAGEFLAG_FALSE(HWPoison)
 #define __PG_HWPOISON 0
 #endif
 
+#ifdef CONFIG_READAHEAD_FEEDBACK
+PAGEFLAG(RaUnused, ra_unused) TESTCLEARFLAG(RaUnused, ra_unused)
+#else
+PAGEFLAG_FALSE(RaUnused) SETPAGEFLAG_NOOP(RaUnused)
+	CLEARPAGEFLAG_NOOP(RaUnused) TESTCLEARFLAG_FALSE(RaUnused)
+#endif
+
 u64 stable_page_flags(struct page *page);
 
 static inline int PageUptodate(struct page *page)
@@ -478,4 +478,34 @@ static inline int add_to_page_cache(struct page *page,
 	return error;
 }
 
+/*
+ * A page read ahead was found in the page cache by a read or fault
+ * through @ra: count it as used, the first time.
+ */
+static inline void ra_page_used(struct file_ra_state *ra, struct page *page)
+{
+#ifdef CONFIG_READAHEAD_FEEDBACK
+	if (PageRaUnused(page) && TestClearPageRaUnused(page)) {
+		count_vm_event(READAHEAD_USED);
+		ra->used++;
+	}
+#endif
+}
+
+/*
+ * A page is evicted from @mapping by reclaim: if it was read ahead and
+ * never used, count it as wasted.  Truncation is not waste, the pages
+ * are gone because the file is.  Called under the mapping's tree_lock.
+ */
+static inline void ra_page_evicted(struct address_space *mapping,
+				   struct page *page)
+{
+#ifdef CONFIG_READAHEAD_FEEDBACK
+	if (PageRaUnused(page)) {
+		mapping->ra_wasted++;
+		__count_vm_event(READAHEAD_WASTED);
+	}
+#endif
+}
+
 #endif /* _LINUX_PAGEMAP_H */
@@ -0,0 +1,61 @@
+/*
+ * include/linux/ram_trace.h
+ *
+ * Persistent trace: binary records of context switches, functions and
+ * events, kept in a memory region that survives a watchdog reset.
+ *
+ * Copyright (C) 2011 Meizu Technology Co.Ltd, Zhuhai, China
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef _LINUX_RAM_TRACE_H
+#define _LINUX_RAM_TRACE_H
+
+#include <linux/types.h>
+
+#define RAM_TRACE_SIG		0x43525452	/* "RTRC" */
+
+/*
+ * The region is a struct ram_trace_header, then nr_records struct
+ * ram_trace_record used as a ring.  /proc/last_trace holds the header
+ * of the previous boot followed by the records found, oldest first.
+ * All fields are in host byte order.
+ */
+struct ram_trace_header {
+	__u32 sig;
+	__u32 nr_records;
+	__u32 record_size;
+	__u32 seq;		/* of the next record, in last_trace only */
+};
+
+struct ram_trace_record {
+	__u32 seq;		/* 0 if unused, or being written */
+	__u32 time;		/* sched_clock() >> 10 */
+	__u32 ip;
+	__u32 data;
+	__u16 event;
+	__u16 cpu;
+};
+
+enum {
+	RAM_TRACE_FUNCTION = 1,		/* ip called from data */
+	RAM_TRACE_SCHED_SWITCH,		/* from pid ip to pid data */
+	RAM_TRACE_USER = 0x100,		/* first event free for drivers */
+};
+
+#ifdef __KERNEL__
+
+#ifdef CONFIG_ANDROID_RAM_TRACE
+extern void ram_trace_event(unsigned int event, unsigned long data);
+#else
+static inline void ram_trace_event(unsigned int event, unsigned long data)
+{
+}
+#endif
+
+#endif /* __KERNEL__ */
+
+#endif	/* _LINUX_RAM_TRACE_H */
@@ -67,6 +67,16 @@ struct anon_vma_chain {
 	struct list_head same_anon_vma;	/* locked by anon_vma->mutex */
 };
 
+/*
+ * Carried by page_referenced_batch() from one page to the next: the
+ * i_mmap_mutex of mapping is held, and page, locked, pins mapping.
+ */
+struct rmap_batch {
+	struct address_space *mapping;
+	struct page *page;
+	unsigned int nr;
+};
+
 #ifdef CONFIG_MMU
 static inline void get_anon_vma(struct anon_vma *anon_vma)
 {
@@ -160,6 +170,9 @@ int page_referenced(struct page *, int is_locked,
 			struct mem_cgroup *cnt, unsigned long *vm_flags);
 int page_referenced_one(struct page *, struct vm_area_struct *,
 	unsigned long address, unsigned int *mapcount, unsigned long *vm_flags);
+int page_referenced_batch(struct page *, struct mem_cgroup *cnt,
+	unsigned long *vm_flags, struct rmap_batch *batch);
+void rmap_batch_end(struct rmap_batch *batch);
 
 enum ttu_flags {
 	TTU_UNMAP = 0,			/* unmap mode */
@@ -242,6 +255,19 @@ static inline int page_referenced(struct page *page, int is_locked,
 	return 0;
 }
 
+static inline int page_referenced_batch(struct page *page,
+					struct mem_cgroup *cnt,
+					unsigned long *vm_flags,
+					struct rmap_batch *batch)
+{
+	*vm_flags = 0;
+	return 0;
+}
+
+static inline void rmap_batch_end(struct rmap_batch *batch)
+{
+}
+
 #define try_to_unmap(page, refs) SWAP_FAIL
 
 static inline int page_mkclean(struct page *page)
@@ -435,8 +435,10 @@ extern int get_dumpable(struct mm_struct *mm);
 					/* leave room for more dump flags */
 #define MMF_VM_MERGEABLE	16	/* KSM may merge identical pages */
 #define MMF_VM_HUGEPAGE		17	/* set when VM_HUGEPAGE is set on vma */
+#define MMF_BACKGROUND		18	/* leader in a background cpu cgroup */
 
-#define MMF_INIT_MASK		(MMF_DUMPABLE_MASK | MMF_DUMP_FILTER_MASK)
+#define MMF_INIT_MASK		(MMF_DUMPABLE_MASK | MMF_DUMP_FILTER_MASK | \
+				 (1 << MMF_BACKGROUND))
 
 struct sighand_struct {
 	atomic_t		count;
@@ -1275,6 +1277,9 @@ struct task_struct {
 #if defined(CONFIG_SCHEDSTATS) || defined(CONFIG_TASK_DELAY_ACCT)
 	struct sched_info sched_info;
 #endif
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	u64 sched_wakeup_stamp;		/* rq->clock at the last wakeup */
+#endif
 
 	struct list_head tasks;
 #ifdef CONFIG_SMP
@@ -2618,6 +2623,31 @@ extern int sched_rt_can_attach(struct task_group *tg, struct task_struct *tsk);
 #endif
 #endif
 
+#ifdef CONFIG_FAIR_GROUP_SCHED
+extern int task_in_background_group(struct task_struct *p);
+
+/*
+ * Whether an address space belongs to a foreground application: set
+ * unless its leader was moved to a background cpu cgroup, so tasks that
+ * never left the root group count too.
+ */
+static inline int mm_in_foreground(struct mm_struct *mm)
+{
+	return !test_bit(MMF_BACKGROUND, &mm->flags);
+}
+#else
+static inline int task_in_background_group(struct task_struct *p)
+{
+	return 0;
+}
+
+/* Without cpu cgroups nothing is told apart */
+static inline int mm_in_foreground(struct mm_struct *mm)
+{
+	return 0;
+}
+#endif
+
 extern int task_can_switch_user(struct user_struct *up,
 					struct task_struct *tsk);
 
@@ -33,6 +33,9 @@ enum stat_item {
 	DEACTIVATE_REMOTE_FREES,/* Slab contained remotely freed objects */
 	ORDER_FALLBACK,		/* Number of times fallback was necessary */
 	CMPXCHG_DOUBLE_CPU_FAIL,/* Failure of this_cpu_cmpxchg_double */
+	CPU_PARTIAL_ALLOC,	/* Cpu slab acquired from cpu partial list */
+	CPU_PARTIAL_FREE,	/* Freeing moves slab to cpu partial list */
+	CPU_PARTIAL_DRAIN,	/* Cpu partial list moved to node partial list */
 	NR_SLUB_STAT_ITEMS };
 
 struct kmem_cache_cpu {
@@ -40,6 +43,8 @@ struct kmem_cache_cpu {
 	unsigned long tid;	/* Globally unique transaction id */
 	struct page *page;	/* The slab from which we are allocating */
 	int node;		/* The node of the page (or -1 for debug) */
+	struct list_head partial;	/* Frozen partial slabs of this cpu */
+	unsigned int nr_partial;	/* Number of slabs on partial */
 #ifdef CONFIG_SLUB_STATS
 	unsigned stat[NR_SLUB_STAT_ITEMS];
 #endif
@@ -73,6 +78,7 @@ struct kmem_cache {
 	/* Used for retriving partial slabs etc */
 	unsigned long flags;
 	unsigned long min_partial;
+	unsigned int cpu_partial;	/* Slabs to keep on cpu partial lists */
 	int size;		/* The size of an object including meta data */
 	int objsize;		/* The size of an object without meta data */
 	int offset;		/* Free pointer offset. */
@@ -297,6 +297,25 @@ static inline int unregister_pm_notifier(struct notifier_block *nb)
 static inline bool pm_wakeup_pending(void) { return false; }
 #endif /* !CONFIG_PM_SLEEP */
 
+#ifdef CONFIG_SUSPEND_PROFILE
+enum {
+	SUSPEND_PROF_EARLY_SUSPEND,
+	SUSPEND_PROF_LATE_RESUME,
+	SUSPEND_PROF_DEV_SUSPEND,
+	SUSPEND_PROF_DEV_SUSPEND_NOIRQ,
+	SUSPEND_PROF_DEV_RESUME_NOIRQ,
+	SUSPEND_PROF_DEV_RESUME,
+};
+
+/* kernel/power/suspend_profile.c */
+extern void suspend_prof_record(int phase, const char *name, void *fn,
+				ktime_t start);
+#else /* !CONFIG_SUSPEND_PROFILE */
+
+static inline void suspend_prof_record(int phase, const char *name, void *fn,
+				       ktime_t start) {}
+#endif /* !CONFIG_SUSPEND_PROFILE */
+
 extern struct mutex pm_mutex;
 
 #ifndef CONFIG_HIBERNATE_CALLBACKS
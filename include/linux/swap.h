@@ -214,6 +214,12 @@ extern unsigned int nr_free_pagecache_pages(void);
 #define nr_free_pages() global_page_state(NR_FREE_PAGES)
 
 
+/* linux/mm/workingset.c */
+extern void workingset_eviction(struct address_space *mapping,
+				struct page *page);
+extern bool workingset_refault(struct address_space *mapping, pgoff_t index);
+extern void workingset_activation(struct page *page);
+
 /* linux/mm/swap.c */
 extern void __lru_cache_add(struct page *, enum lru_list lru);
 extern void lru_cache_add_lru(struct page *, enum lru_list lru);
@@ -262,6 +268,7 @@ extern unsigned long mem_cgroup_shrink_node_zone(struct mem_cgroup *mem,
 extern int __isolate_lru_page(struct page *page, int mode, int file);
 extern unsigned long shrink_all_memory(unsigned long nr_pages);
 extern int vm_swappiness;
+extern int vm_protect_foreground;
 extern int remove_mapping(struct address_space *mapping, struct page *page);
 extern long vm_total_pages;
 
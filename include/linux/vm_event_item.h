@@ -36,9 +36,18 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		KSWAPD_LOW_WMARK_HIT_QUICKLY, KSWAPD_HIGH_WMARK_HIT_QUICKLY,
 		KSWAPD_SKIP_CONGESTION_WAIT,
 		PAGEOUTRUN, ALLOCSTALL, PGROTATED,
+		PGPROTECTED, RMAP_BATCHED,
+		DIRECT_RECLAIM_1MS, DIRECT_RECLAIM_4MS, DIRECT_RECLAIM_16MS,
+		DIRECT_RECLAIM_64MS, DIRECT_RECLAIM_SLOW,
+#ifdef CONFIG_READAHEAD_FEEDBACK
+		READAHEAD_PAGES, READAHEAD_USED, READAHEAD_WASTED,
+		READAHEAD_SHRINK, READAHEAD_GROW,
+#endif
 #ifdef CONFIG_COMPACTION
 		COMPACTBLOCKS, COMPACTPAGES, COMPACTPAGEFAILED,
 		COMPACTSTALL, COMPACTFAIL, COMPACTSUCCESS,
+		COMPACTPROACTIVE, COMPACTPROACTIVESUCCESS,
+		COMPACTPROACTIVESCAN, COMPACTPROACTIVEMIGRATE,
 #endif
 #ifdef CONFIG_HUGETLB_PAGE
 		HTLB_BUDDY_PGALLOC, HTLB_BUDDY_PGALLOC_FAIL,
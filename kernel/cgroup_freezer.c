@@ -153,11 +153,15 @@ static void freezer_destroy(struct cgroup_subsys *ss,
 	kfree(cgroup_freezer(cgroup));
 }
 
-/* task is frozen or will freeze immediately when next it gets woken */
+/*
+ * task is frozen or will freeze immediately when next it gets woken, which
+ * includes a task that freeze_task() left asleep in a freezable sleep
+ */
 static bool is_task_frozen_enough(struct task_struct *task)
 {
 	return frozen(task) ||
-		(task_is_stopped_or_traced(task) && freezing(task));
+		((task_is_stopped_or_traced(task) ||
+		  freezer_should_skip(task)) && freezing(task));
 }
 
 /*
@@ -232,7 +236,7 @@ static void update_if_frozen(struct cgroup *cgroup,
 {
 	struct cgroup_iter it;
 	struct task_struct *task;
-	unsigned int nfrozen = 0, ntotal = 0;
+	unsigned int nfrozen = 0, nwaking = 0, ntotal = 0;
 	enum freezer_state old_state = freezer->state;
 
 	cgroup_iter_start(cgroup, &it);
@@ -240,6 +244,8 @@ static void update_if_frozen(struct cgroup *cgroup,
 		ntotal++;
 		if (is_task_frozen_enough(task))
 			nfrozen++;
+		else if (freezing(task))
+			nwaking++;
 	}
 
 	if (old_state == CGROUP_THAWED) {
@@ -248,7 +254,11 @@ static void update_if_frozen(struct cgroup *cgroup,
 		if (nfrozen == ntotal)
 			freezer->state = CGROUP_FROZEN;
 	} else { /* old_state == CGROUP_FROZEN */
-		BUG_ON(nfrozen != ntotal);
+		/*
+		 * A task that was counted asleep in a freezable sleep may
+		 * have woken up since and be on its way to the refrigerator.
+		 */
+		BUG_ON(nfrozen + nwaking != ntotal);
 	}
 
 	cgroup_iter_end(cgroup, &it);
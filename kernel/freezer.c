@@ -10,6 +10,13 @@
 #include <linux/syscalls.h>
 #include <linux/freezer.h>
 
+/*
+ * If set, user space tasks sleeping in freezable_schedule() and friends are
+ * only flagged for freezing, not woken up; they freeze when they next wake.
+ */
+static bool fast = 1;
+module_param(fast, bool, S_IRUGO | S_IWUSR);
+
 /*
  * freezing is complete, mark current process as frozen
  */
@@ -77,7 +84,8 @@ static void fake_signal_wake_up(struct task_struct *p)
  *	@sig_only: if set, the request will only be sent if the task has the
  *		PF_FREEZER_NOSIG flag unset
  *	Return value: 'false', if @sig_only is set and the task has
- *		PF_FREEZER_NOSIG set or the task is frozen, 'true', otherwise
+ *		PF_FREEZER_NOSIG set, the task is frozen or it sleeps in
+ *		freezable_schedule() and is left alone, 'true', otherwise
  *
  *	The freeze request is sent by setting the tasks's TIF_FREEZE flag and
  *	either sending a fake signal to it or waking it up, depending on whether
@@ -103,6 +111,17 @@ bool freeze_task(struct task_struct *p, bool sig_only)
 			return false;
 	}
 
+	/*
+	 * Pairs with the barrier in freezer_count(): either the task sees
+	 * TIF_FREEZE when it wakes up or we see PF_FREEZER_SKIP cleared and
+	 * wake it up below.
+	 */
+	if (fast) {
+		smp_mb();
+		if (freezer_should_skip(p))
+			return false;
+	}
+
 	if (should_send_signal(p)) {
 		fake_signal_wake_up(p);
 		/*
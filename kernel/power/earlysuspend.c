@@ -13,6 +13,7 @@
  *
  */
 
+#include <linux/async.h>
 #include <linux/earlysuspend.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
@@ -30,6 +31,8 @@ enum {
 };
 static int debug_mask = DEBUG_USER_STATE;
 module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
+static bool async_handlers = 1;
+module_param(async_handlers, bool, S_IRUGO | S_IWUSR | S_IWGRP);
 
 static DEFINE_MUTEX(early_suspend_lock);
 static LIST_HEAD(early_suspend_handlers);
@@ -44,11 +47,20 @@ enum {
 	SUSPEND_REQUESTED_AND_SUSPENDED = SUSPEND_REQUESTED | SUSPENDED,
 };
 static int state;
+static LIST_HEAD(early_suspend_domain);
 
 void register_early_suspend(struct early_suspend *handler)
 {
 	struct list_head *pos;
 
+	if (handler->depends_on &&
+	    handler->depends_on->level <= handler->level) {
+		pr_warning("early_suspend: %pf level %d can not depend on "
+			   "level %d\n", handler->suspend, handler->level,
+			   handler->depends_on->level);
+		handler->depends_on = NULL;
+	}
+
 	mutex_lock(&early_suspend_lock);
 	list_for_each(pos, &early_suspend_handlers) {
 		struct early_suspend *e;
@@ -65,12 +77,88 @@ EXPORT_SYMBOL(register_early_suspend);
 
 void unregister_early_suspend(struct early_suspend *handler)
 {
+	struct early_suspend *pos;
+
 	mutex_lock(&early_suspend_lock);
 	list_del(&handler->link);
+	list_for_each_entry(pos, &early_suspend_handlers, link)
+		if (pos->depends_on == handler)
+			pos->depends_on = NULL;
 	mutex_unlock(&early_suspend_lock);
 }
 EXPORT_SYMBOL(unregister_early_suspend);
 
+static void call_early_suspend(struct early_suspend *handler)
+{
+	ktime_t start = ktime_get();
+
+	if (debug_mask & DEBUG_VERBOSE)
+		pr_info("early_suspend: calling %pf\n", handler->suspend);
+	handler->suspend(handler);
+	if (debug_mask & DEBUG_VERBOSE)
+		pr_info("early_suspend: %pf took %lld usecs\n", handler->suspend,
+			ktime_to_us(ktime_sub(ktime_get(), start)));
+	suspend_prof_record(SUSPEND_PROF_EARLY_SUSPEND, NULL,
+			    handler->suspend, start);
+}
+
+static void call_late_resume(struct early_suspend *handler)
+{
+	ktime_t start = ktime_get();
+
+	if (debug_mask & DEBUG_VERBOSE)
+		pr_info("late_resume: calling %pf\n", handler->resume);
+	handler->resume(handler);
+	if (debug_mask & DEBUG_VERBOSE)
+		pr_info("late_resume: %pf took %lld usecs\n", handler->resume,
+			ktime_to_us(ktime_sub(ktime_get(), start)));
+	suspend_prof_record(SUSPEND_PROF_LATE_RESUME, NULL,
+			    handler->resume, start);
+}
+
+static void async_early_suspend(void *data, async_cookie_t cookie)
+{
+	struct early_suspend *handler = data;
+
+	if (handler->after)
+		async_synchronize_cookie_domain(handler->after + 1,
+						&early_suspend_domain);
+	call_early_suspend(handler);
+}
+
+static void async_late_resume(void *data, async_cookie_t cookie)
+{
+	struct early_suspend *handler = data;
+
+	if (handler->after)
+		async_synchronize_cookie_domain(handler->after + 1,
+						&early_suspend_domain);
+	call_late_resume(handler);
+}
+
+/*
+ * Return the cookie of the last async handler that must have returned before
+ * handler is called, or 0. Handlers called synchronously have a cookie of 0,
+ * they are done by the time the handlers after them are started.
+ */
+static async_cookie_t early_suspend_after(struct early_suspend *handler,
+					  bool resume)
+{
+	struct early_suspend *pos;
+	async_cookie_t after = 0;
+
+	if (resume)
+		return handler->depends_on ? handler->depends_on->cookie : 0;
+
+	list_for_each_entry(pos, &early_suspend_handlers, link) {
+		if (pos == handler)
+			break;
+		if (pos->depends_on == handler && pos->cookie > after)
+			after = pos->cookie;
+	}
+	return after;
+}
+
 static void early_suspend(struct work_struct *work)
 {
 	struct early_suspend *pos;
@@ -95,12 +183,21 @@ static void early_suspend(struct work_struct *work)
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("early_suspend: call handlers\n");
 	list_for_each_entry(pos, &early_suspend_handlers, link) {
-		if (pos->suspend != NULL) {
-			if (debug_mask & DEBUG_VERBOSE)
-				pr_info("early_suspend: calling %pf\n", pos->suspend);
-			pos->suspend(pos);
+		pos->cookie = 0;
+		if (pos->suspend == NULL)
+			continue;
+		pos->after = early_suspend_after(pos, false);
+		if (pos->async && async_handlers) {
+			pos->cookie = async_schedule_domain(async_early_suspend,
+						pos, &early_suspend_domain);
+		} else {
+			if (pos->after)
+				async_synchronize_cookie_domain(pos->after + 1,
+							&early_suspend_domain);
+			call_early_suspend(pos);
 		}
 	}
+	async_synchronize_full_domain(&early_suspend_domain);
 	mutex_unlock(&early_suspend_lock);
 
 	if (debug_mask & DEBUG_SUSPEND)
@@ -136,13 +233,21 @@ static void late_resume(struct work_struct *work)
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: call handlers\n");
 	list_for_each_entry_reverse(pos, &early_suspend_handlers, link) {
-		if (pos->resume != NULL) {
-			if (debug_mask & DEBUG_VERBOSE)
-				pr_info("late_resume: calling %pf\n", pos->resume);
-
-			pos->resume(pos);
+		pos->cookie = 0;
+		if (pos->resume == NULL)
+			continue;
+		pos->after = early_suspend_after(pos, true);
+		if (pos->async && async_handlers) {
+			pos->cookie = async_schedule_domain(async_late_resume,
+						pos, &early_suspend_domain);
+		} else {
+			if (pos->after)
+				async_synchronize_cookie_domain(pos->after + 1,
+							&early_suspend_domain);
+			call_late_resume(pos);
 		}
 	}
+	async_synchronize_full_domain(&early_suspend_domain);
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: done\n");
 abort:
@@ -17,12 +17,40 @@
 #include <linux/delay.h>
 #include <linux/workqueue.h>
 #include <linux/wakelock.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 /* 
  * Timeout for stopping processes
  */
 #define TIMEOUT	(20 * HZ)
 
+/*
+ * Statistics of the freezing of tasks, shown in
+ * /sys/kernel/debug/freezer_stats.  The slowest tasks are the ones still
+ * not frozen in the last poll of the last freeze that had to wait.
+ */
+#define FREEZE_SLOWEST	8
+
+struct freeze_slow_task {
+	char		comm[TASK_COMM_LEN];
+	pid_t		pid;
+	unsigned int	msecs;
+};
+
+static struct {
+	unsigned int	count;
+	unsigned int	failed;
+	unsigned int	last_msecs;
+	unsigned int	max_msecs;
+	unsigned long long total_msecs;
+	unsigned int	last_frozen;
+	unsigned int	last_skipped;
+	unsigned int	last_polls;
+	unsigned int	nr_slowest;
+	struct freeze_slow_task slowest[FREEZE_SLOWEST];
+} freeze_stats;
+
 static inline int freezable(struct task_struct * p)
 {
 	if ((p == current) ||
@@ -42,6 +70,8 @@ static int try_to_freeze_tasks(bool sig_only)
 	u64 elapsed_csecs64;
 	unsigned int elapsed_csecs;
 	bool wakeup = false;
+	unsigned int nr_frozen, nr_skipped, nr_slow, polls = 0;
+	unsigned long start_jiffies = jiffies;
 
 	do_gettimeofday(&start);
 
@@ -52,13 +82,25 @@ static int try_to_freeze_tasks(bool sig_only)
 
 	while (true) {
 		todo = 0;
+		nr_frozen = 0;
+		nr_skipped = 0;
+		nr_slow = 0;
 		read_lock(&tasklist_lock);
 		do_each_thread(g, p) {
-			if (frozen(p) || !freezable(p))
+			if (!freezable(p))
 				continue;
 
-			if (!freeze_task(p, sig_only))
+			if (frozen(p)) {
+				nr_frozen++;
 				continue;
+			}
+
+			if (!freeze_task(p, sig_only)) {
+				/* left asleep by the fast path */
+				if (freezing(p))
+					nr_skipped++;
+				continue;
+			}
 
 			/*
 			 * Now that we've done set_freeze_flag, don't
@@ -73,11 +115,24 @@ static int try_to_freeze_tasks(bool sig_only)
 			 * stop sees TIF_FREEZE.
 			 */
 			if (!task_is_stopped_or_traced(p) &&
-			    !freezer_should_skip(p))
+			    !freezer_should_skip(p)) {
 				todo++;
+				if (polls && nr_slow < FREEZE_SLOWEST) {
+					struct freeze_slow_task *t;
+
+					t = &freeze_stats.slowest[nr_slow++];
+					memcpy(t->comm, p->comm, TASK_COMM_LEN);
+					t->pid = task_pid_nr(p);
+					t->msecs = jiffies_to_msecs(jiffies -
+								start_jiffies);
+				}
+			}
 		} while_each_thread(g, p);
 		read_unlock(&tasklist_lock);
 
+		if (nr_slow)
+			freeze_stats.nr_slowest = nr_slow;
+
 		if (!sig_only) {
 			wq_busy = freeze_workqueues_busy();
 			todo += wq_busy;
@@ -100,6 +155,7 @@ static int try_to_freeze_tasks(bool sig_only)
 		 * time to enter the regrigerator.
 		 */
 		msleep(10);
+		polls++;
 	}
 
 	do_gettimeofday(&end);
@@ -107,6 +163,11 @@ static int try_to_freeze_tasks(bool sig_only)
 	do_div(elapsed_csecs64, NSEC_PER_SEC / 100);
 	elapsed_csecs = elapsed_csecs64;
 
+	freeze_stats.last_msecs += jiffies_to_msecs(jiffies - start_jiffies);
+	freeze_stats.last_frozen = nr_frozen;
+	freeze_stats.last_skipped = nr_skipped;
+	freeze_stats.last_polls += polls;
+
 	if (todo) {
 		/* This does not unfreeze processes that are already frozen
 		 * (we have slightly ugly calling convention in that respect,
@@ -152,6 +213,10 @@ int freeze_processes(void)
 {
 	int error;
 
+	freeze_stats.last_msecs = 0;
+	freeze_stats.last_polls = 0;
+	freeze_stats.nr_slowest = 0;
+
 	printk("Freezing user space processes ... ");
 	error = try_to_freeze_tasks(true);
 	if (error)
@@ -169,6 +234,13 @@ int freeze_processes(void)
 	BUG_ON(in_atomic());
 	printk("\n");
 
+	freeze_stats.count++;
+	if (error)
+		freeze_stats.failed++;
+	freeze_stats.total_msecs += freeze_stats.last_msecs;
+	if (freeze_stats.last_msecs > freeze_stats.max_msecs)
+		freeze_stats.max_msecs = freeze_stats.last_msecs;
+
 	return error;
 }
 
@@ -204,3 +276,53 @@ void thaw_processes(void)
 	printk("done.\n");
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int freezer_stats_show(struct seq_file *s, void *data)
+{
+	unsigned int i;
+
+	seq_printf(s, "freezes: %u (%u failed)\n",
+		   freeze_stats.count, freeze_stats.failed);
+	seq_printf(s, "total: %llu ms, max: %u ms\n",
+		   freeze_stats.total_msecs, freeze_stats.max_msecs);
+	seq_printf(s, "last: %u ms, %u polls, %u tasks frozen, "
+		   "%u left asleep\n", freeze_stats.last_msecs,
+		   freeze_stats.last_polls, freeze_stats.last_frozen,
+		   freeze_stats.last_skipped);
+	if (!freeze_stats.nr_slowest)
+		return 0;
+
+	seq_printf(s, "slowest:\n");
+	for (i = 0; i < freeze_stats.nr_slowest; i++)
+		seq_printf(s, "  %-16s %5d  >%u ms\n",
+			   freeze_stats.slowest[i].comm,
+			   freeze_stats.slowest[i].pid,
+			   freeze_stats.slowest[i].msecs);
+	return 0;
+}
+
+static int freezer_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, freezer_stats_show, NULL);
+}
+
+static const struct file_operations freezer_stats_fops = {
+	.open		= freezer_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init freezer_stats_init(void)
+{
+	if (!debugfs_create_file("freezer_stats", S_IRUGO, NULL, NULL,
+				 &freezer_stats_fops)) {
+		pr_err("Failed to create freezer_stats debug file\n");
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+late_initcall(freezer_stats_init);
+#endif
@@ -0,0 +1,230 @@
+/*
+ * kernel/power/suspend_profile.c - per-handler suspend/resume latency log
+ *
+ * Copyright (C) 2011 Meizu Technology Co.Ltd, Zhuhai, China
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * Every early-suspend handler and every device suspend/resume callback
+ * reports its duration here.  The most recent SUSPEND_PROF_ENTRIES records
+ * are kept in a ring and shown in /sys/kernel/debug/suspend_profile/log,
+ * the slowest of them in /sys/kernel/debug/suspend_profile/top.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/spinlock.h>
+#include <linux/suspend.h>
+
+#define SUSPEND_PROF_ENTRIES	256
+#define SUSPEND_PROF_NAME_LEN	24
+
+struct suspend_prof_entry {
+	u64	stamp_ms;	/* ktime at which the callback started */
+	u32	usecs;
+	u8	phase;
+	char	name[SUSPEND_PROF_NAME_LEN];
+	void	*fn;
+};
+
+static struct suspend_prof_entry suspend_prof_ring[SUSPEND_PROF_ENTRIES];
+static unsigned int suspend_prof_head;
+static unsigned int suspend_prof_count;
+static DEFINE_SPINLOCK(suspend_prof_lock);
+
+static unsigned int top_n = 10;
+module_param(top_n, uint, S_IRUGO | S_IWUSR);
+
+static const char *suspend_prof_phase_name[] = {
+	[SUSPEND_PROF_EARLY_SUSPEND]	= "early_suspend",
+	[SUSPEND_PROF_LATE_RESUME]	= "late_resume",
+	[SUSPEND_PROF_DEV_SUSPEND]	= "suspend",
+	[SUSPEND_PROF_DEV_SUSPEND_NOIRQ] = "suspend_noirq",
+	[SUSPEND_PROF_DEV_RESUME_NOIRQ]	= "resume_noirq",
+	[SUSPEND_PROF_DEV_RESUME]	= "resume",
+};
+
+/**
+ * suspend_prof_record - Log the duration of one suspend/resume callback.
+ * @phase: SUSPEND_PROF_* phase the callback belongs to.
+ * @name: Device name, or NULL if @fn identifies the handler.
+ * @fn: Handler function, printed with %pf when @name is NULL.
+ * @start: ktime_get() value taken just before the callback ran.
+ *
+ * May be called with interrupts disabled.
+ */
+void suspend_prof_record(int phase, const char *name, void *fn, ktime_t start)
+{
+	struct suspend_prof_entry *e;
+	unsigned long flags;
+	s64 usecs;
+
+	usecs = ktime_to_us(ktime_sub(ktime_get(), start));
+
+	spin_lock_irqsave(&suspend_prof_lock, flags);
+	e = &suspend_prof_ring[suspend_prof_head];
+	suspend_prof_head = (suspend_prof_head + 1) % SUSPEND_PROF_ENTRIES;
+	if (suspend_prof_count < SUSPEND_PROF_ENTRIES)
+		suspend_prof_count++;
+
+	e->stamp_ms = ktime_to_ms(start);
+	e->usecs = min_t(s64, usecs, UINT_MAX);
+	e->phase = phase;
+	e->fn = fn;
+	if (name)
+		strlcpy(e->name, name, sizeof(e->name));
+	else
+		e->name[0] = '\0';
+	spin_unlock_irqrestore(&suspend_prof_lock, flags);
+}
+EXPORT_SYMBOL_GPL(suspend_prof_record);
+
+#ifdef CONFIG_DEBUG_FS
+static void suspend_prof_show_entry(struct seq_file *s,
+				    struct suspend_prof_entry *e)
+{
+	u64 secs = e->stamp_ms;
+	u32 msecs = do_div(secs, MSEC_PER_SEC);
+
+	seq_printf(s, "%8llu.%03u %-14s %6u.%03u  ", secs, msecs,
+		   suspend_prof_phase_name[e->phase],
+		   e->usecs / 1000, e->usecs % 1000);
+	if (e->name[0])
+		seq_printf(s, "%s\n", e->name);
+	else
+		seq_printf(s, "%pf\n", e->fn);
+}
+
+/*
+ * Copy the ring out oldest first so the seq_file callbacks never hold
+ * suspend_prof_lock while printing.
+ */
+static struct suspend_prof_entry *suspend_prof_snapshot(unsigned int *count)
+{
+	struct suspend_prof_entry *copy;
+	unsigned long flags;
+	unsigned int i, first;
+
+	copy = kmalloc(sizeof(suspend_prof_ring), GFP_KERNEL);
+	if (!copy)
+		return NULL;
+
+	spin_lock_irqsave(&suspend_prof_lock, flags);
+	*count = suspend_prof_count;
+	first = (suspend_prof_head + SUSPEND_PROF_ENTRIES - suspend_prof_count)
+		% SUSPEND_PROF_ENTRIES;
+	for (i = 0; i < suspend_prof_count; i++)
+		copy[i] = suspend_prof_ring[(first + i) % SUSPEND_PROF_ENTRIES];
+	spin_unlock_irqrestore(&suspend_prof_lock, flags);
+
+	return copy;
+}
+
+static int suspend_prof_log_show(struct seq_file *s, void *data)
+{
+	struct suspend_prof_entry *copy;
+	unsigned int i, count;
+
+	copy = suspend_prof_snapshot(&count);
+	if (!copy)
+		return -ENOMEM;
+
+	seq_printf(s, "     start (s) phase              msecs  handler\n");
+	for (i = 0; i < count; i++)
+		suspend_prof_show_entry(s, &copy[i]);
+
+	kfree(copy);
+	return 0;
+}
+
+static int suspend_prof_cmp(const void *a, const void *b)
+{
+	const struct suspend_prof_entry *ea = a, *eb = b;
+
+	if (ea->usecs == eb->usecs)
+		return 0;
+	return ea->usecs < eb->usecs ? 1 : -1;
+}
+
+static int suspend_prof_top_show(struct seq_file *s, void *data)
+{
+	struct suspend_prof_entry *copy;
+	unsigned int i, count;
+
+	copy = suspend_prof_snapshot(&count);
+	if (!copy)
+		return -ENOMEM;
+
+	sort(copy, count, sizeof(*copy), suspend_prof_cmp, NULL);
+
+	seq_printf(s, "     start (s) phase              msecs  handler\n");
+	for (i = 0; i < count && i < top_n; i++)
+		suspend_prof_show_entry(s, &copy[i]);
+
+	kfree(copy);
+	return 0;
+}
+
+static int suspend_prof_log_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, suspend_prof_log_show, NULL);
+}
+
+static int suspend_prof_top_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, suspend_prof_top_show, NULL);
+}
+
+static const struct file_operations suspend_prof_log_fops = {
+	.open		= suspend_prof_log_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static const struct file_operations suspend_prof_top_fops = {
+	.open		= suspend_prof_top_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init suspend_prof_debug_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("suspend_profile", NULL);
+	if (!dir)
+		goto err;
+
+	if (!debugfs_create_file("log", S_IRUGO, dir, NULL,
+				 &suspend_prof_log_fops))
+		goto err_remove;
+	if (!debugfs_create_file("top", S_IRUGO, dir, NULL,
+				 &suspend_prof_top_fops))
+		goto err_remove;
+
+	return 0;
+
+err_remove:
+	debugfs_remove_recursive(dir);
+err:
+	pr_err("Failed to create suspend_profile debug files\n");
+	return -ENOMEM;
+}
+
+late_initcall(suspend_prof_debug_init);
+#endif
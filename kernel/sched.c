@@ -277,6 +277,11 @@ struct task_group {
 #ifdef CONFIG_SCHED_AUTOGROUP
 	struct autogroup *autogroup;
 #endif
+
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	/* wakeup latencies of the group's tasks, NULL for the root group */
+	struct sched_lat_hist __percpu *lat_hist;
+#endif
 };
 
 /* task_group_lock serializes the addition/removal of task groups */
@@ -1780,6 +1785,7 @@ static const struct sched_class rt_sched_class;
    for (class = sched_class_highest; class; class = class->next)
 
 #include "sched_stats.h"
+#include "sched_latency.h"
 
 static void inc_nr_running(struct rq *rq)
 {
@@ -2479,6 +2485,7 @@ static void ttwu_activate(struct rq *rq, struct task_struct *p, int en_flags)
 {
 	activate_task(rq, p, en_flags);
 	p->on_rq = 1;
+	sched_latency_wakeup(rq, p);
 
 	/* if a worker is waking up, notify workqueue */
 	if (p->flags & PF_WQ_WORKER)
@@ -3009,6 +3016,7 @@ prepare_task_switch(struct rq *rq, struct task_struct *prev,
 		    struct task_struct *next)
 {
 	sched_info_switch(prev, next);
+	sched_latency_switch(rq, next);
 	perf_event_task_sched_out(prev, next);
 	fire_sched_out_preempt_notifiers(prev, next);
 	prepare_lock_switch(rq, next);
@@ -8494,6 +8502,9 @@ static void free_sched_group(struct task_group *tg)
 	free_fair_sched_group(tg);
 	free_rt_sched_group(tg);
 	autogroup_free(tg);
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	free_percpu(tg->lat_hist);
+#endif
 	kfree(tg);
 }
 
@@ -8513,6 +8524,12 @@ struct task_group *sched_create_group(struct task_group *parent)
 	if (!alloc_rt_sched_group(tg, parent))
 		goto err;
 
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	tg->lat_hist = alloc_percpu(struct sched_lat_hist);
+	if (!tg->lat_hist)
+		goto err;
+#endif
+
 	spin_lock_irqsave(&task_group_lock, flags);
 	list_add_rcu(&tg->list, &task_groups);
 
@@ -8635,6 +8652,51 @@ unsigned long sched_group_shares(struct task_group *tg)
 {
 	return tg->shares;
 }
+
+/*
+ * Android runs background applications in a cpu cgroup with fewer shares
+ * than the root group; this lets the block layer tell their I/O apart.
+ */
+int task_in_background_group(struct task_struct *p)
+{
+	int ret;
+
+	rcu_read_lock();
+	ret = task_group(p)->shares < root_task_group.shares;
+	rcu_read_unlock();
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(task_in_background_group);
+
+/*
+ * Let reclaim know which address spaces belong to foreground
+ * applications, see page_referenced_one().  The group of the thread group
+ * leader decides: Android moves single threads of a foreground
+ * application, such as its THREAD_PRIORITY_BACKGROUND workers, to the
+ * background group, and those must not take the whole mm with them.
+ */
+static void sched_update_mm_foreground(struct task_struct *tsk)
+{
+	struct mm_struct *mm;
+
+	if (!thread_group_leader(tsk))
+		return;
+
+	task_lock(tsk);
+	mm = tsk->mm;
+	if (mm) {
+		if (task_in_background_group(tsk))
+			set_bit(MMF_BACKGROUND, &mm->flags);
+		else
+			clear_bit(MMF_BACKGROUND, &mm->flags);
+	}
+	task_unlock(tsk);
+}
+#else
+static inline void sched_update_mm_foreground(struct task_struct *tsk)
+{
+}
 #endif
 
 #ifdef CONFIG_RT_GROUP_SCHED
@@ -8975,6 +9037,7 @@ static void
 cpu_cgroup_attach_task(struct cgroup *cgrp, struct task_struct *tsk)
 {
 	sched_move_task(tsk);
+	sched_update_mm_foreground(tsk);
 }
 
 static void
@@ -9031,6 +9094,20 @@ static u64 cpu_rt_period_read_uint(struct cgroup *cgrp, struct cftype *cft)
 }
 #endif /* CONFIG_RT_GROUP_SCHED */
 
+#ifdef CONFIG_SCHED_LATENCY_HIST
+static int cpu_sched_latency_show(struct cgroup *cgrp, struct cftype *cft,
+				  struct seq_file *m)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+	struct sched_lat_hist sum;
+
+	/* the root group reports the whole system */
+	sched_lat_hist_sum(&sum, tg->lat_hist ? tg->lat_hist : &sched_lat_hist);
+	sched_lat_hist_show(m, &sum);
+	return 0;
+}
+#endif
+
 static struct cftype cpu_files[] = {
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	{
@@ -9051,6 +9128,12 @@ static struct cftype cpu_files[] = {
 		.write_u64 = cpu_rt_period_write_uint,
 	},
 #endif
+#ifdef CONFIG_SCHED_LATENCY_HIST
+	{
+		.name = "sched_latency",
+		.read_seq_string = cpu_sched_latency_show,
+	},
+#endif
 };
 
 static int cpu_cgroup_populate(struct cgroup_subsys *ss, struct cgroup *cont)
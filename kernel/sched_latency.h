@@ -0,0 +1,212 @@
+/*
+ * kernel/sched_latency.h
+ *
+ * Wakeup-to-running latency histograms, included by kernel/sched.c.
+ *
+ * A task woken from sleep is stamped with rq->clock in ttwu_activate(); when
+ * it is next switched in, the time since the stamp is counted in a log2
+ * bucket of its CPU, per scheduling class, and in the same bucket of its
+ * task group.  Bucket i holds latencies of [2^(i-1), 2^i) usecs, bucket 0
+ * those under one usec and the last bucket all those of 2^22 usecs or
+ * more.  All counters are per-CPU and only touched under the runqueue
+ * lock, so they are cheap enough to leave enabled.
+ */
+
+#ifdef CONFIG_SCHED_LATENCY_HIST
+
+#define SCHED_LAT_BUCKETS	24
+
+enum {
+	SCHED_LAT_CFS,
+	SCHED_LAT_RT,
+	SCHED_LAT_NR_CLASSES,
+};
+
+static const char *sched_lat_class_name[SCHED_LAT_NR_CLASSES] = {
+	[SCHED_LAT_CFS]	= "cfs",
+	[SCHED_LAT_RT]	= "rt",
+};
+
+struct sched_lat_hist {
+	unsigned long	count[SCHED_LAT_NR_CLASSES][SCHED_LAT_BUCKETS];
+	u64		total[SCHED_LAT_NR_CLASSES];	/* nsecs */
+	u64		max[SCHED_LAT_NR_CLASSES];	/* nsecs */
+};
+
+static DEFINE_PER_CPU(struct sched_lat_hist, sched_lat_hist);
+
+static inline void sched_lat_hist_add(struct sched_lat_hist *hist, int class,
+				      int bucket, u64 delta)
+{
+	hist->count[class][bucket]++;
+	hist->total[class] += delta;
+	if (delta > hist->max[class])
+		hist->max[class] = delta;
+}
+
+static inline void sched_latency_wakeup(struct rq *rq, struct task_struct *p)
+{
+	p->sched_wakeup_stamp = rq->clock;
+}
+
+static inline void sched_latency_switch(struct rq *rq, struct task_struct *next)
+{
+	int cpu = cpu_of(rq);
+	int class, bucket;
+	s64 delta;
+
+	if (!next->sched_wakeup_stamp)
+		return;
+
+	delta = sched_clock_cpu(cpu) - next->sched_wakeup_stamp;
+	next->sched_wakeup_stamp = 0;
+	if (delta < 0)
+		delta = 0;
+
+	/* below the last bucket, a 32-bit division is all the bucket needs */
+	if (delta >= (s64)NSEC_PER_USEC << (SCHED_LAT_BUCKETS - 2))
+		bucket = SCHED_LAT_BUCKETS - 1;
+	else
+		bucket = fls((u32)delta / NSEC_PER_USEC);
+	class = rt_task(next) ? SCHED_LAT_RT : SCHED_LAT_CFS;
+
+	sched_lat_hist_add(&per_cpu(sched_lat_hist, cpu), class, bucket, delta);
+#ifdef CONFIG_CGROUP_SCHED
+	{
+		struct task_group *tg = task_group(next);
+
+		if (tg->lat_hist)
+			sched_lat_hist_add(per_cpu_ptr(tg->lat_hist, cpu),
+					   class, bucket, delta);
+	}
+#endif
+}
+
+static void sched_lat_hist_show(struct seq_file *m, struct sched_lat_hist *h)
+{
+	int class, i, last = 0;
+
+	for (class = 0; class < SCHED_LAT_NR_CLASSES; class++) {
+		unsigned long n = 0;
+
+		for (i = 0; i < SCHED_LAT_BUCKETS; i++) {
+			n += h->count[class][i];
+			if (h->count[class][i] && i > last)
+				last = i;
+		}
+		seq_printf(m, "  %-3s count %lu avg_us %llu max_us %llu\n",
+			   sched_lat_class_name[class], n,
+			   n ? div_u64(div64_u64(h->total[class], n),
+				       NSEC_PER_USEC) : 0,
+			   div_u64(h->max[class], NSEC_PER_USEC));
+	}
+
+	seq_printf(m, "  %-16s %10s %10s\n", "usecs", "cfs", "rt");
+	for (i = 0; i <= last; i++) {
+		char range[24];
+
+		if (i == 0)
+			snprintf(range, sizeof(range), "0 - 1");
+		else if (i == SCHED_LAT_BUCKETS - 1)
+			snprintf(range, sizeof(range), "%u -", 1U << (i - 1));
+		else
+			snprintf(range, sizeof(range), "%u - %u",
+				 1U << (i - 1), 1U << i);
+		seq_printf(m, "  %-16s %10lu %10lu\n", range,
+			   h->count[SCHED_LAT_CFS][i], h->count[SCHED_LAT_RT][i]);
+	}
+}
+
+static void sched_lat_hist_sum(struct sched_lat_hist *sum,
+			       struct sched_lat_hist __percpu *hist)
+{
+	int cpu, class, i;
+
+	memset(sum, 0, sizeof(*sum));
+	for_each_possible_cpu(cpu) {
+		struct sched_lat_hist *h = per_cpu_ptr(hist, cpu);
+
+		for (class = 0; class < SCHED_LAT_NR_CLASSES; class++) {
+			for (i = 0; i < SCHED_LAT_BUCKETS; i++)
+				sum->count[class][i] += h->count[class][i];
+			sum->total[class] += h->total[class];
+			sum->max[class] = max(sum->max[class], h->max[class]);
+		}
+	}
+}
+
+static int sched_latency_show(struct seq_file *m, void *v)
+{
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		seq_printf(m, "cpu%d\n", cpu);
+		sched_lat_hist_show(m, &per_cpu(sched_lat_hist, cpu));
+	}
+	return 0;
+}
+
+static int sched_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, sched_latency_show, NULL);
+}
+
+/*
+ * Writing anything to /proc/sched_latency clears all the histograms, those
+ * of the CPUs and those of the task groups.
+ */
+static ssize_t sched_latency_write(struct file *file, const char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct rq *rq = cpu_rq(cpu);
+#ifdef CONFIG_CGROUP_SCHED
+		struct task_group *tg;
+#endif
+
+		raw_spin_lock_irq(&rq->lock);
+		memset(&per_cpu(sched_lat_hist, cpu), 0,
+		       sizeof(struct sched_lat_hist));
+#ifdef CONFIG_CGROUP_SCHED
+		rcu_read_lock();
+		list_for_each_entry_rcu(tg, &task_groups, list) {
+			if (tg->lat_hist)
+				memset(per_cpu_ptr(tg->lat_hist, cpu), 0,
+				       sizeof(struct sched_lat_hist));
+		}
+		rcu_read_unlock();
+#endif
+		raw_spin_unlock_irq(&rq->lock);
+	}
+	return count;
+}
+
+static const struct file_operations proc_sched_latency_operations = {
+	.open    = sched_latency_open,
+	.read    = seq_read,
+	.write   = sched_latency_write,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
+static int __init proc_sched_latency_init(void)
+{
+	proc_create("sched_latency", S_IRUGO | S_IWUSR, NULL,
+		    &proc_sched_latency_operations);
+	return 0;
+}
+module_init(proc_sched_latency_init);
+
+#else /* !CONFIG_SCHED_LATENCY_HIST */
+
+static inline void sched_latency_wakeup(struct rq *rq, struct task_struct *p)
+{
+}
+
+static inline void sched_latency_switch(struct rq *rq, struct task_struct *next)
+{
+}
+
+#endif /* CONFIG_SCHED_LATENCY_HIST */
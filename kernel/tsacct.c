@@ -23,6 +23,39 @@
 #include <linux/jiffies.h>
 #include <linux/mm.h>
 
+#ifdef CONFIG_IRQ_TIME_ACCOUNTING
+/*
+ * se.sum_exec_runtime is charged from sched_clock() at every context switch
+ * and, with irq time accounting, does not include {soft,}irq time.  Split it
+ * between user and system time in the ratio of the sampled ticks, which is
+ * the only thing the ticks are still good for on short-running threads.
+ */
+static void bacct_cpu_times(struct task_struct *tsk, u64 *utime, u64 *stime)
+{
+	u64 rtime = tsk->se.sum_exec_runtime;
+	u64 ut = tsk->utime, total = cputime_add(tsk->utime, tsk->stime);
+
+	if (total) {
+		/* keep rtime * ut within 64 bits, the ratio is what counts */
+		while (fls64(rtime) + fls64(ut) > 63) {
+			ut >>= 1;
+			total >>= 1;
+		}
+		ut = total ? div64_u64(rtime * ut, total) : rtime;
+	} else
+		ut = rtime;
+
+	*utime = div_u64(ut, NSEC_PER_USEC);
+	*stime = div_u64(rtime - ut, NSEC_PER_USEC);
+}
+#else
+static void bacct_cpu_times(struct task_struct *tsk, u64 *utime, u64 *stime)
+{
+	*utime = cputime_to_usecs(tsk->utime);
+	*stime = cputime_to_usecs(tsk->stime);
+}
+#endif
+
 /*
  * fill in basic accounting fields
  */
@@ -63,8 +96,7 @@ void bacct_add_tsk(struct taskstats *stats, struct task_struct *tsk)
 	stats->ac_ppid	 = pid_alive(tsk) ?
 				rcu_dereference(tsk->real_parent)->tgid : 0;
 	rcu_read_unlock();
-	stats->ac_utime = cputime_to_usecs(tsk->utime);
-	stats->ac_stime = cputime_to_usecs(tsk->stime);
+	bacct_cpu_times(tsk, &stats->ac_utime, &stats->ac_stime);
 	stats->ac_utimescaled = cputime_to_usecs(tsk->utimescaled);
 	stats->ac_stimescaled = cputime_to_usecs(tsk->stimescaled);
 	stats->ac_minflt = tsk->min_flt;
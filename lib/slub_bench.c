@@ -0,0 +1,126 @@
+/*
+ * Slab allocator microbenchmark
+ *
+ * Times kmalloc() and kfree() for a range of object sizes when loaded
+ * and prints the cost of one call in nanoseconds.  Two patterns are run:
+ * a kmalloc() immediately followed by its kfree(), which stays on the
+ * cpu slab fastpath, and a batch of objects allocated first and freed
+ * after, which runs through whole slabs and so through the partial lists.
+ * The module does nothing else and can be removed right away.
+ *
+ *	insmod slub_bench.ko nr_objects=10000
+ *
+ * Copyright (C) 2011 Meizu Technology Co.Ltd, Zhuhai, China
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/hrtimer.h>
+
+static unsigned int nr_objects = 10000;
+module_param(nr_objects, uint, 0444);
+MODULE_PARM_DESC(nr_objects, "Objects allocated per size and pattern");
+
+static const size_t bench_sizes[] = {
+	8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096,
+};
+
+static unsigned long long ns_per_op(ktime_t start, unsigned int n)
+{
+	unsigned long long ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	do_div(ns, n);
+	return ns;
+}
+
+/* kmalloc() and kfree() of one object, over and over */
+static int bench_single(size_t size, unsigned long long *ns)
+{
+	ktime_t start;
+	unsigned int i;
+	void *p;
+
+	start = ktime_get();
+	for (i = 0; i < nr_objects; i++) {
+		p = kmalloc(size, GFP_KERNEL);
+		if (!p)
+			return -ENOMEM;
+		kfree(p);
+	}
+	*ns = ns_per_op(start, nr_objects);
+	return 0;
+}
+
+/* nr_objects kmalloc()s, then their kfree()s */
+static int bench_batch(void **objs, size_t size,
+		       unsigned long long *alloc_ns, unsigned long long *free_ns)
+{
+	ktime_t start;
+	unsigned int i;
+
+	start = ktime_get();
+	for (i = 0; i < nr_objects; i++) {
+		objs[i] = kmalloc(size, GFP_KERNEL);
+		if (!objs[i])
+			break;
+	}
+	*alloc_ns = ns_per_op(start, nr_objects);
+
+	if (i < nr_objects) {
+		while (i--)
+			kfree(objs[i]);
+		return -ENOMEM;
+	}
+
+	start = ktime_get();
+	for (i = 0; i < nr_objects; i++)
+		kfree(objs[i]);
+	*free_ns = ns_per_op(start, nr_objects);
+	return 0;
+}
+
+static int __init slub_bench_init(void)
+{
+	unsigned long long single, alloc, free;
+	void **objs;
+	int i, err = 0;
+
+	if (!nr_objects)
+		return -EINVAL;
+
+	objs = vmalloc(nr_objects * sizeof(*objs));
+	if (!objs)
+		return -ENOMEM;
+
+	pr_info("slub_bench: %u objects, ns per call\n", nr_objects);
+	pr_info("slub_bench:   size  alloc+free   alloc    free\n");
+	for (i = 0; i < ARRAY_SIZE(bench_sizes); i++) {
+		err = bench_single(bench_sizes[i], &single);
+		if (!err)
+			err = bench_batch(objs, bench_sizes[i], &alloc, &free);
+		if (err)
+			break;
+		pr_info("slub_bench: %6zu %11llu %7llu %7llu\n",
+			bench_sizes[i], single, alloc, free);
+	}
+
+	vfree(objs);
+	return err;
+}
+
+static void __exit slub_bench_exit(void)
+{
+}
+
+module_init(slub_bench_init);
+module_exit(slub_bench_exit);
+
+MODULE_DESCRIPTION("Slab allocator microbenchmark");
+MODULE_LICENSE("GPL");
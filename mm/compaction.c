@@ -42,6 +42,12 @@ struct compact_control {
 	unsigned int order;		/* order a direct compactor needs */
 	int migratetype;		/* MOVABLE, RECLAIMABLE etc */
 	struct zone *zone;
+
+	/* Proactive compaction from kswapd */
+	bool proactive;			/* resume where the last run stopped */
+	unsigned long nr_scanned;	/* pages seen by the migrate scanner */
+	unsigned long nr_migrated;	/* pages it managed to move */
+	unsigned long scan_budget;	/* stop after scanning this many */
 };
 
 static unsigned long release_freepages(struct list_head *freelist)
@@ -414,6 +420,7 @@ static isolate_migrate_t isolate_migratepages(struct zone *zone,
 
 	spin_unlock_irq(&zone->lru_lock);
 	cc->migrate_pfn = low_pfn;
+	cc->nr_scanned += nr_scanned;
 
 	trace_mm_compaction_isolate_migratepages(nr_scanned, nr_isolated);
 
@@ -479,6 +486,10 @@ static int compact_finished(struct zone *zone,
 	if (cc->free_pfn <= cc->migrate_pfn)
 		return COMPACT_COMPLETE;
 
+	/* A proactive run gives up once it has used its budget */
+	if (cc->scan_budget && cc->nr_scanned >= cc->scan_budget)
+		return COMPACT_PARTIAL;
+
 	/*
 	 * order == -1 is expected when compacting via
 	 * /proc/sys/vm/compact_memory
@@ -577,6 +588,14 @@ static int compact_zone(struct zone *zone, struct compact_control *cc)
 	cc->free_pfn = cc->migrate_pfn + zone->spanned_pages;
 	cc->free_pfn &= ~(pageblock_nr_pages-1);
 
+	/*
+	 * Each proactive run only scans a bit of the zone, start where the
+	 * previous one stopped so that successive runs cover all of it.
+	 */
+	if (cc->proactive && zone->compact_proactive_pfn > cc->migrate_pfn &&
+	    zone->compact_proactive_pfn < cc->free_pfn)
+		cc->migrate_pfn = zone->compact_proactive_pfn;
+
 	migrate_prep_local();
 
 	while ((ret = compact_finished(zone, cc)) == COMPACT_CONTINUE) {
@@ -602,6 +621,7 @@ static int compact_zone(struct zone *zone, struct compact_control *cc)
 
 		count_vm_event(COMPACTBLOCKS);
 		count_vm_events(COMPACTPAGES, nr_migrate - nr_remaining);
+		cc->nr_migrated += nr_migrate - nr_remaining;
 		if (nr_remaining)
 			count_vm_events(COMPACTPAGEFAILED, nr_remaining);
 		trace_mm_compaction_migratepages(nr_migrate - nr_remaining,
@@ -620,6 +640,10 @@ out:
 	cc->nr_freepages -= release_freepages(&cc->freepages);
 	VM_BUG_ON(cc->nr_freepages != 0);
 
+	if (cc->proactive)
+		zone->compact_proactive_pfn = ret == COMPACT_COMPLETE ?
+						zone->zone_start_pfn : cc->migrate_pfn;
+
 	return ret;
 }
 
@@ -690,6 +714,114 @@ unsigned long try_to_compact_pages(struct zonelist *zonelist,
 	return rc;
 }
 
+/*
+ * Proactive compaction: a swapless phone that runs out of order-N pages
+ * stalls every driver which needs them (framebuffer and camera buffers,
+ * SDIO skbs) in direct compaction.  After kswapd has balanced a node it
+ * does a little async compaction on its behalf instead, when it predicts
+ * such allocations would fail, and within a budget.
+ */
+int sysctl_compact_proactive_order = 3;
+int sysctl_compact_proactive_pages = 1024;
+int sysctl_compact_proactive_interval = 1000;
+
+static unsigned long compact_proactive_last = INITIAL_JIFFIES;
+
+/*
+ * Proactive compaction backs off on its own counters: a sweep that failed
+ * says nothing about whether a synchronous direct compaction would, and
+ * must not hold back allocating tasks.
+ */
+static void defer_proactive(struct zone *zone)
+{
+	zone->compact_proactive_considered = 0;
+	if (zone->compact_proactive_defer_shift < COMPACT_MAX_DEFER_SHIFT)
+		zone->compact_proactive_defer_shift++;
+}
+
+static bool proactive_deferred(struct zone *zone)
+{
+	unsigned long defer_limit = 1UL << zone->compact_proactive_defer_shift;
+
+	if (++zone->compact_proactive_considered > defer_limit)
+		zone->compact_proactive_considered = defer_limit;
+
+	return zone->compact_proactive_considered < defer_limit;
+}
+
+/**
+ * compact_pgdat_proactive - Compact a node for high-order allocations
+ * @pgdat: The node kswapd just balanced
+ * @order: The order kswapd was woken for
+ *
+ * Called by kswapd.  Compacts the zones of @pgdat that have enough free
+ * memory, but too fragmented for an allocation of @order or
+ * vm.compact_proactive_order, whichever is higher, to succeed.
+ */
+void compact_pgdat_proactive(pg_data_t *pgdat, int order)
+{
+	int zoneid;
+
+	if (!sysctl_compact_proactive_order)
+		return;
+	order = max(order, sysctl_compact_proactive_order);
+
+	if (time_before(jiffies, compact_proactive_last +
+			msecs_to_jiffies(sysctl_compact_proactive_interval)))
+		return;
+
+	for (zoneid = 0; zoneid < pgdat->nr_zones; zoneid++) {
+		struct zone *zone = pgdat->node_zones + zoneid;
+		struct compact_control cc = {
+			.nr_freepages = 0,
+			.nr_migratepages = 0,
+			.order = order,
+			.migratetype = MIGRATE_MOVABLE,
+			.zone = zone,
+			.sync = false,
+			.proactive = true,
+			.scan_budget = sysctl_compact_proactive_pages,
+		};
+		int ret;
+
+		if (!populated_zone(zone) || zone->all_unreclaimable)
+			continue;
+
+		/* An allocation of this order would succeed */
+		if (zone_watermark_ok(zone, order, low_wmark_pages(zone), 0, 0))
+			continue;
+
+		/* Not enough free memory, or not fragmented: reclaim's job */
+		if (compaction_suitable(zone, order) != COMPACT_CONTINUE)
+			continue;
+
+		if (proactive_deferred(zone))
+			continue;
+
+		compact_proactive_last = jiffies;
+		count_vm_event(COMPACTPROACTIVE);
+
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+
+		ret = compact_zone(zone, &cc);
+		count_vm_events(COMPACTPROACTIVESCAN, cc.nr_scanned);
+		count_vm_events(COMPACTPROACTIVEMIGRATE, cc.nr_migrated);
+
+		if (zone_watermark_ok(zone, order, low_wmark_pages(zone), 0, 0)) {
+			zone->compact_proactive_considered = 0;
+			zone->compact_proactive_defer_shift = 0;
+			count_vm_event(COMPACTPROACTIVESUCCESS);
+		} else if (ret == COMPACT_COMPLETE) {
+			/*
+			 * The scanners met: the runs since the last complete
+			 * one took the migrate scanner from the start of the
+			 * zone to the free scanner, and it did not do it.
+			 */
+			defer_proactive(zone);
+		}
+	}
+}
 
 /* Compact all zones within a node */
 static int compact_node(int nid)
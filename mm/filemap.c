@@ -35,6 +35,7 @@
 #include <linux/memcontrol.h>
 #include <linux/mm_inline.h> /* for page_is_file_cache() */
 #include <linux/cleancache.h>
+#include <linux/launchra.h>
 #include "internal.h"
 
 /*
@@ -500,10 +501,12 @@ int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 
 	ret = add_to_page_cache(page, mapping, offset, gfp_mask);
 	if (ret == 0) {
-		if (page_is_file_cache(page))
-			lru_cache_add_file(page);
-		else
+		if (!page_is_file_cache(page))
 			lru_cache_add_anon(page);
+		else if (workingset_refault(mapping, offset))
+			__lru_cache_add(page, LRU_ACTIVE_FILE);
+		else
+			lru_cache_add_file(page);
 	}
 	return ret;
 }
@@ -1101,7 +1104,10 @@ find_page:
 			page = find_get_page(mapping, index);
 			if (unlikely(page == NULL))
 				goto no_cached_page;
+			/* read on demand, not ahead */
+			ClearPageRaUnused(page);
 		}
+		ra_page_used(ra, page);
 		if (PageReadahead(page)) {
 			page_cache_async_readahead(mapping,
 					ra, filp, page,
@@ -1576,7 +1582,7 @@ static void do_sync_mmap_readahead(struct vm_area_struct *vma,
 	/*
 	 * mmap read-around
 	 */
-	ra_pages = max_sane_readahead(ra->ra_pages);
+	ra_pages = max_sane_readahead(ra_max_pages(mapping, ra));
 	ra->start = max_t(long, 0, offset - ra_pages / 2);
 	ra->size = ra_pages;
 	ra->async_size = ra_pages / 4;
@@ -1643,8 +1649,11 @@ int filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 		 * waiting for the lock.
 		 */
 		do_async_mmap_readahead(vma, ra, file, page, offset);
+		ra_page_used(ra, page);
+		launchra_fault(file, offset, 0);
 	} else {
 		/* No page in the page cache at all */
+		launchra_fault(file, offset, 1);
 		do_sync_mmap_readahead(vma, ra, file, offset);
 		count_vm_event(PGMAJFAULT);
 		mem_cgroup_count_vm_event(vma->vm_mm, PGMAJFAULT);
@@ -1653,6 +1662,8 @@ retry_find:
 		page = find_get_page(mapping, offset);
 		if (!page)
 			goto no_cached_page;
+		/* read on demand, not ahead */
+		ClearPageRaUnused(page);
 	}
 
 	if (!lock_page_or_retry(page, vma->vm_mm, vmf->flags)) {
@@ -189,6 +189,28 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Most pages ksmd may scan in a second, 0 for no limit */
+static unsigned int ksm_thread_pages_per_sec;
+
+/* Start of the current one second budget window, and pages scanned in it */
+static unsigned long ksm_budget_start = INITIAL_JIFFIES;
+static unsigned int ksm_budget_used;
+
+/*
+ * Each full scan that merges nothing doubles the sleep between batches,
+ * up to 1 << KSM_MAX_IDLE_SHIFT times sleep_millisecs.
+ */
+#define KSM_MAX_IDLE_SHIFT	5
+static unsigned int ksm_idle_shift;
+static unsigned long ksm_idle_seqnr;
+static unsigned long ksm_idle_merged;
+
+/* What ksmd costs and gains: pages scanned, and pages it merged */
+static unsigned long ksm_pages_scanned;
+static unsigned long ksm_pages_merged;
+
+static struct task_struct *ksmd_task;
+
 #define KSM_RUN_STOP	0
 #define KSM_RUN_MERGE	1
 #define KSM_RUN_UNMERGE	2
@@ -1157,6 +1179,7 @@ static void stable_tree_append(struct rmap_item *rmap_item,
 		ksm_pages_sharing++;
 	else
 		ksm_pages_shared++;
+	ksm_pages_merged++;
 }
 
 /*
@@ -1417,6 +1440,8 @@ static void ksm_do_scan(unsigned int scan_npages)
 		rmap_item = scan_get_next_rmap_item(&page);
 		if (!rmap_item)
 			return;
+		ksm_pages_scanned++;
+		ksm_budget_used++;
 		if (!PageKsm(page) || !in_stable_tree(rmap_item))
 			cmp_and_merge_page(page, rmap_item);
 		put_page(page);
@@ -1428,6 +1453,54 @@ static int ksmd_should_run(void)
 	return (ksm_run & KSM_RUN_MERGE) && !list_empty(&ksm_mm_head.mm_list);
 }
 
+/*
+ * How many pages ksmd may scan in its next batch: pages_to_scan, unless
+ * that would take it over pages_per_sec in the current second.
+ */
+static unsigned int ksm_scan_budget(void)
+{
+	if (!ksm_thread_pages_per_sec)
+		return ksm_thread_pages_to_scan;
+
+	if (time_after_eq(jiffies, ksm_budget_start + HZ)) {
+		ksm_budget_start = jiffies;
+		ksm_budget_used = 0;
+	}
+	if (ksm_budget_used >= ksm_thread_pages_per_sec)
+		return 0;
+	return min(ksm_thread_pages_to_scan,
+		   ksm_thread_pages_per_sec - ksm_budget_used);
+}
+
+/*
+ * Called after each batch: back off while full scans find nothing to
+ * merge, rescan at full speed as soon as one does.
+ */
+static void ksm_update_idle(void)
+{
+	if (ksm_scan.seqnr == ksm_idle_seqnr)
+		return;
+
+	if (ksm_pages_merged == ksm_idle_merged) {
+		if (ksm_idle_shift < KSM_MAX_IDLE_SHIFT)
+			ksm_idle_shift++;
+	} else
+		ksm_idle_shift = 0;
+
+	ksm_idle_seqnr = ksm_scan.seqnr;
+	ksm_idle_merged = ksm_pages_merged;
+}
+
+static unsigned long ksm_sleep_jiffies(void)
+{
+	if (ksm_thread_pages_per_sec &&
+	    ksm_budget_used >= ksm_thread_pages_per_sec &&
+	    time_before(jiffies, ksm_budget_start + HZ))
+		return ksm_budget_start + HZ - jiffies;
+
+	return msecs_to_jiffies(ksm_thread_sleep_millisecs) << ksm_idle_shift;
+}
+
 static int ksm_scan_thread(void *nothing)
 {
 	set_freezable();
@@ -1435,15 +1508,16 @@ static int ksm_scan_thread(void *nothing)
 
 	while (!kthread_should_stop()) {
 		mutex_lock(&ksm_thread_mutex);
-		if (ksmd_should_run())
-			ksm_do_scan(ksm_thread_pages_to_scan);
+		if (ksmd_should_run()) {
+			ksm_do_scan(ksm_scan_budget());
+			ksm_update_idle();
+		}
 		mutex_unlock(&ksm_thread_mutex);
 
 		try_to_freeze();
 
 		if (ksmd_should_run()) {
-			schedule_timeout_interruptible(
-				msecs_to_jiffies(ksm_thread_sleep_millisecs));
+			schedule_timeout_interruptible(ksm_sleep_jiffies());
 		} else {
 			wait_event_freezable(ksm_thread_wait,
 				ksmd_should_run() || kthread_should_stop());
@@ -1520,6 +1594,9 @@ int __ksm_enter(struct mm_struct *mm)
 	set_bit(MMF_VM_MERGEABLE, &mm->flags);
 	atomic_inc(&mm->mm_count);
 
+	/* A new mergeable mm is worth scanning at full speed again */
+	ksm_idle_shift = 0;
+
 	if (needs_wakeup)
 		wake_up_interruptible(&ksm_thread_wait);
 
@@ -1872,6 +1949,29 @@ static ssize_t pages_to_scan_store(struct kobject *kobj,
 }
 KSM_ATTR(pages_to_scan);
 
+static ssize_t pages_per_sec_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_thread_pages_per_sec);
+}
+
+static ssize_t pages_per_sec_store(struct kobject *kobj,
+				   struct kobj_attribute *attr,
+				   const char *buf, size_t count)
+{
+	int err;
+	unsigned long nr_pages;
+
+	err = strict_strtoul(buf, 10, &nr_pages);
+	if (err || nr_pages > UINT_MAX)
+		return -EINVAL;
+
+	ksm_thread_pages_per_sec = nr_pages;
+
+	return count;
+}
+KSM_ATTR(pages_per_sec);
+
 static ssize_t run_show(struct kobject *kobj, struct kobj_attribute *attr,
 			char *buf)
 {
@@ -1966,15 +2066,49 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t pages_scanned_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_scanned);
+}
+KSM_ATTR_RO(pages_scanned);
+
+static ssize_t pages_merged_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_merged);
+}
+KSM_ATTR_RO(pages_merged);
+
+static ssize_t cpu_msecs_show(struct kobject *kobj,
+			      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%llu\n",
+		       div_u64(ksmd_task->se.sum_exec_runtime, NSEC_PER_MSEC));
+}
+KSM_ATTR_RO(cpu_msecs);
+
+static ssize_t idle_shift_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_idle_shift);
+}
+KSM_ATTR_RO(idle_shift);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
+	&pages_per_sec_attr.attr,
 	&run_attr.attr,
 	&pages_shared_attr.attr,
 	&pages_sharing_attr.attr,
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&pages_scanned_attr.attr,
+	&pages_merged_attr.attr,
+	&cpu_msecs_attr.attr,
+	&idle_shift_attr.attr,
 	NULL,
 };
 
@@ -1999,6 +2133,7 @@ static int __init ksm_init(void)
 		err = PTR_ERR(ksm_thread);
 		goto out_free;
 	}
+	ksmd_task = ksm_thread;
 
 #ifdef CONFIG_SYSFS
 	err = sysfs_create_group(mm_kobj, &ksm_attr_group);
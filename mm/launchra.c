@@ -0,0 +1,527 @@
+/*
+ * mm/launchra.c
+ *
+ * Application launch readahead.
+ *
+ * A cold application launch spends most of its time in page faults on
+ * the apk, dex and library files it maps, each one a small random read.
+ * /dev/launchra records which pages of which files the processes of one
+ * process group fault in while it launches, and hands them out as a
+ * compact trace.  On the next launch the trace is handed back and all of
+ * it is read ahead at once, sorted by file and offset, so the faults find
+ * their pages in the page cache.
+ *
+ * Every page cache fault is recorded, not just the major ones: pages
+ * brought in by mmap read-around of a major fault are found in the cache
+ * by later faults, and would be missing from the trace otherwise.
+ *
+ * Copyright (C) 2011 Meizu Technology Co.Ltd, Zhuhai, China
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/file.h>
+#include <linux/fs.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/pagemap.h>
+#include <linux/path.h>
+#include <linux/pid.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
+#include <linux/uaccess.h>
+#include <linux/blkdev.h>
+#include <linux/launchra.h>
+
+#define LAUNCHRA_MAX_FILES	256
+#define LAUNCHRA_MAX_RANGES	16384
+#define LAUNCHRA_MAX_TRACE	(1024 * 1024)
+
+/* ranges at most this many pages apart are read as one */
+#define LAUNCHRA_MERGE_GAP	8
+
+struct launchra_file {
+	struct path path;
+	struct address_space *mapping;
+};
+
+/*
+ * launchra_session - one open of /dev/launchra
+ * Locking: faults are added under launchra_lock while the session is
+ * launchra_active; everything else is serialized by ->mutex.
+ */
+struct launchra_session {
+	struct mutex mutex;
+	struct pid *pgrp;		/* recorded process group */
+	struct launchra_file *files;
+	unsigned int nr_files;
+	struct launchra_range *ranges;
+	unsigned int nr_ranges;
+	struct launchra_stats stats;
+	void *trace;			/* built by LAUNCHRA_STOP */
+	size_t trace_size;
+};
+
+int launchra_recording __read_mostly;
+static struct launchra_session *launchra_active;
+static DEFINE_SPINLOCK(launchra_lock);
+
+static int launchra_file_index(struct launchra_session *s, struct file *file)
+{
+	struct address_space *mapping = file->f_mapping;
+	int i;
+
+	/* faults mostly come in runs on the same file */
+	for (i = s->nr_files - 1; i >= 0; i--)
+		if (s->files[i].mapping == mapping)
+			return i;
+
+	if (s->nr_files >= LAUNCHRA_MAX_FILES)
+		return -1;
+	i = s->nr_files++;
+	s->files[i].path = file->f_path;
+	path_get(&file->f_path);
+	s->files[i].mapping = mapping;
+	return i;
+}
+
+/* Called by filemap_fault() while a recording is running. */
+void __launchra_fault(struct file *file, pgoff_t offset, int major)
+{
+	struct launchra_session *s;
+	struct launchra_range *last;
+	int idx;
+
+	spin_lock(&launchra_lock);
+	s = launchra_active;
+	if (!s || task_pgrp(current) != s->pgrp)
+		goto out;
+
+	s->stats.faults++;
+	if (major)
+		s->stats.major_faults++;
+
+	idx = launchra_file_index(s, file);
+	if (idx < 0)
+		goto drop;
+
+	last = s->nr_ranges ? &s->ranges[s->nr_ranges - 1] : NULL;
+	if (last && last->file == idx &&
+	    offset >= last->start && offset <= last->start + last->nr_pages) {
+		if (offset == last->start + last->nr_pages)
+			last->nr_pages++;
+		goto out;
+	}
+	if (s->nr_ranges >= LAUNCHRA_MAX_RANGES || offset > UINT_MAX)
+		goto drop;
+
+	last = &s->ranges[s->nr_ranges++];
+	last->file = idx;
+	last->start = offset;
+	last->nr_pages = 1;
+	goto out;
+drop:
+	s->stats.dropped++;
+out:
+	spin_unlock(&launchra_lock);
+}
+
+static int launchra_range_cmp(const void *a, const void *b)
+{
+	const struct launchra_range *ra = a, *rb = b;
+
+	if (ra->file != rb->file)
+		return ra->file < rb->file ? -1 : 1;
+	if (ra->start != rb->start)
+		return ra->start < rb->start ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Sort the ranges and merge those that overlap or lie within "gap" pages
+ * of each other.  Returns the new number of ranges.
+ */
+static unsigned int launchra_merge(struct launchra_range *ranges,
+				   unsigned int nr, unsigned int gap)
+{
+	unsigned int i, n = 0;
+
+	if (!nr)
+		return 0;
+
+	sort(ranges, nr, sizeof(*ranges), launchra_range_cmp, NULL);
+	for (i = 1; i < nr; i++) {
+		struct launchra_range *prev = &ranges[n];
+		struct launchra_range *r = &ranges[i];
+		u64 end = (u64)prev->start + prev->nr_pages;
+
+		if (r->file == prev->file && r->start <= end + gap) {
+			if ((u64)r->start + r->nr_pages > end)
+				prev->nr_pages = (u64)r->start + r->nr_pages -
+						 prev->start;
+			continue;
+		}
+		ranges[++n] = *r;
+	}
+	return n + 1;
+}
+
+static void launchra_free_files(struct launchra_session *s)
+{
+	unsigned int i;
+
+	for (i = 0; i < s->nr_files; i++)
+		path_put(&s->files[i].path);
+	s->nr_files = 0;
+	s->nr_ranges = 0;
+}
+
+/* Turn the recorded files and ranges into a trace. */
+static int launchra_build_trace(struct launchra_session *s)
+{
+	struct launchra_trace *hdr;
+	char *buf, **names;
+	size_t names_size = 0, size;
+	unsigned int i, nr_pages = 0;
+	void *trace;
+	char *p;
+	int err = -ENOMEM;
+
+	buf = (char *)__get_free_page(GFP_KERNEL);
+	names = kcalloc(s->nr_files, sizeof(*names), GFP_KERNEL);
+	if (!buf || (s->nr_files && !names))
+		goto out;
+
+	for (i = 0; i < s->nr_files; i++) {
+		p = d_path(&s->files[i].path, buf, PAGE_SIZE);
+		if (IS_ERR(p)) {
+			err = PTR_ERR(p);
+			goto out;
+		}
+		names[i] = kstrdup(p, GFP_KERNEL);
+		if (!names[i])
+			goto out;
+		names_size += strlen(p) + 1;
+	}
+	names_size = ALIGN(names_size, 4);
+
+	s->nr_ranges = launchra_merge(s->ranges, s->nr_ranges,
+				      LAUNCHRA_MERGE_GAP);
+	size = sizeof(*hdr) + names_size +
+	       s->nr_ranges * sizeof(struct launchra_range);
+	trace = vzalloc(size);
+	if (!trace)
+		goto out;
+
+	hdr = trace;
+	hdr->magic = LAUNCHRA_MAGIC;
+	hdr->size = size;
+	hdr->nr_files = s->nr_files;
+	hdr->names_size = names_size;
+	hdr->nr_ranges = s->nr_ranges;
+
+	p = trace + sizeof(*hdr);
+	for (i = 0; i < s->nr_files; i++)
+		p += sprintf(p, "%s", names[i]) + 1;
+	memcpy(trace + sizeof(*hdr) + names_size, s->ranges,
+	       s->nr_ranges * sizeof(struct launchra_range));
+	for (i = 0; i < s->nr_ranges; i++)
+		nr_pages += s->ranges[i].nr_pages;
+
+	vfree(s->trace);
+	s->trace = trace;
+	s->trace_size = size;
+
+	s->stats.nr_files = s->nr_files;
+	s->stats.nr_ranges = s->nr_ranges;
+	s->stats.nr_pages = nr_pages;
+	s->stats.size = size;
+	err = 0;
+out:
+	if (names)
+		for (i = 0; i < s->nr_files; i++)
+			kfree(names[i]);
+	kfree(names);
+	free_page((unsigned long)buf);
+	return err;
+}
+
+static int launchra_record(struct launchra_session *s, pid_t pgid)
+{
+	struct pid *pgrp;
+	int ret = 0;
+
+	if (s->pgrp)
+		return -EBUSY;
+
+	rcu_read_lock();
+	pgrp = get_pid(find_vpid(pgid));
+	rcu_read_unlock();
+	if (!pgrp)
+		return -ESRCH;
+
+	if (!s->files)
+		s->files = kcalloc(LAUNCHRA_MAX_FILES, sizeof(*s->files),
+				   GFP_KERNEL);
+	if (!s->ranges)
+		s->ranges = vmalloc(LAUNCHRA_MAX_RANGES *
+				    sizeof(struct launchra_range));
+	if (!s->files || !s->ranges) {
+		put_pid(pgrp);
+		return -ENOMEM;
+	}
+	launchra_free_files(s);
+	memset(&s->stats, 0, sizeof(s->stats));
+
+	spin_lock(&launchra_lock);
+	if (launchra_active) {
+		ret = -EBUSY;
+	} else {
+		s->pgrp = pgrp;
+		launchra_active = s;
+		launchra_recording = 1;
+	}
+	spin_unlock(&launchra_lock);
+
+	if (ret)
+		put_pid(pgrp);
+	return ret;
+}
+
+static void launchra_stop_recording(struct launchra_session *s)
+{
+	spin_lock(&launchra_lock);
+	if (launchra_active == s) {
+		launchra_active = NULL;
+		launchra_recording = 0;
+	}
+	spin_unlock(&launchra_lock);
+
+	put_pid(s->pgrp);
+	s->pgrp = NULL;
+}
+
+static int launchra_stop(struct launchra_session *s,
+			 struct launchra_stats __user *ustats)
+{
+	int ret;
+
+	if (!s->pgrp)
+		return -EINVAL;
+
+	launchra_stop_recording(s);
+	ret = launchra_build_trace(s);
+	launchra_free_files(s);
+	if (ret)
+		return ret;
+
+	if (copy_to_user(ustats, &s->stats, sizeof(s->stats)))
+		return -EFAULT;
+	return 0;
+}
+
+/* Read ahead the ranges of one file; returns the number of pages. */
+static unsigned int launchra_replay_file(const char *name,
+					 struct launchra_range *r,
+					 unsigned int nr)
+{
+	struct blk_plug plug;
+	struct file *filp;
+	unsigned int i, pages = 0;
+	pgoff_t size;
+
+	filp = filp_open(name, O_RDONLY | O_LARGEFILE, 0);
+	if (IS_ERR(filp))
+		return 0;
+
+	size = (i_size_read(filp->f_mapping->host) + PAGE_CACHE_SIZE - 1) >>
+		PAGE_CACHE_SHIFT;
+	blk_start_plug(&plug);
+	for (i = 0; i < nr; i++) {
+		unsigned long nr_pages = r[i].nr_pages;
+
+		if (r[i].start >= size)
+			break;
+		nr_pages = min_t(unsigned long, nr_pages, size - r[i].start);
+		if (force_page_cache_readahead(filp->f_mapping, filp,
+					       r[i].start, nr_pages))
+			break;
+		pages += nr_pages;
+	}
+	blk_finish_plug(&plug);
+
+	filp_close(filp, NULL);
+	return pages;
+}
+
+static int launchra_replay(struct launchra_replay __user *ureplay)
+{
+	struct launchra_replay replay;
+	struct launchra_trace *hdr;
+	struct launchra_range *ranges;
+	const char **names = NULL;
+	unsigned int i, j, nr_ranges;
+	char *p, *end;
+	int ret;
+
+	if (copy_from_user(&replay, ureplay, sizeof(replay)))
+		return -EFAULT;
+	if (replay.size < sizeof(*hdr) || replay.size > LAUNCHRA_MAX_TRACE)
+		return -EINVAL;
+
+	hdr = vmalloc(replay.size);
+	if (!hdr)
+		return -ENOMEM;
+	ret = -EFAULT;
+	if (copy_from_user(hdr, (void __user *)(unsigned long)replay.trace,
+			   replay.size))
+		goto out;
+
+	ret = -EINVAL;
+	if (hdr->magic != LAUNCHRA_MAGIC || hdr->size != replay.size ||
+	    hdr->nr_files > LAUNCHRA_MAX_FILES ||
+	    !IS_ALIGNED(hdr->names_size, 4) ||
+	    hdr->names_size > replay.size - sizeof(*hdr) ||
+	    hdr->nr_ranges > (replay.size - sizeof(*hdr) - hdr->names_size) /
+			     sizeof(struct launchra_range))
+		goto out;
+
+	ret = -ENOMEM;
+	names = kcalloc(hdr->nr_files, sizeof(*names), GFP_KERNEL);
+	if (hdr->nr_files && !names)
+		goto out;
+
+	ret = -EINVAL;
+	p = (char *)(hdr + 1);
+	end = p + hdr->names_size;
+	for (i = 0; i < hdr->nr_files; i++) {
+		char *nul = memchr(p, 0, end - p);
+
+		if (!nul)
+			goto out;
+		names[i] = p;
+		p = nul + 1;
+	}
+
+	ranges = (struct launchra_range *)end;
+	nr_ranges = hdr->nr_ranges;
+	for (i = 0; i < nr_ranges; i++)
+		if (ranges[i].file >= hdr->nr_files)
+			goto out;
+	nr_ranges = launchra_merge(ranges, nr_ranges, 0);
+
+	replay.nr_pages = 0;
+	for (i = 0; i < nr_ranges; i = j) {
+		for (j = i + 1; j < nr_ranges; j++)
+			if (ranges[j].file != ranges[i].file)
+				break;
+		replay.nr_pages += launchra_replay_file(names[ranges[i].file],
+							&ranges[i], j - i);
+	}
+
+	ret = 0;
+	if (put_user(replay.nr_pages, &ureplay->nr_pages))
+		ret = -EFAULT;
+out:
+	kfree(names);
+	vfree(hdr);
+	return ret;
+}
+
+static int launchra_open(struct inode *inode, struct file *file)
+{
+	struct launchra_session *s;
+
+	s = kzalloc(sizeof(*s), GFP_KERNEL);
+	if (!s)
+		return -ENOMEM;
+	mutex_init(&s->mutex);
+	file->private_data = s;
+	return 0;
+}
+
+static int launchra_release(struct inode *inode, struct file *file)
+{
+	struct launchra_session *s = file->private_data;
+
+	if (s->pgrp)
+		launchra_stop_recording(s);
+	launchra_free_files(s);
+	kfree(s->files);
+	vfree(s->ranges);
+	vfree(s->trace);
+	kfree(s);
+	return 0;
+}
+
+static ssize_t launchra_read(struct file *file, char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	struct launchra_session *s = file->private_data;
+	ssize_t ret;
+
+	mutex_lock(&s->mutex);
+	ret = simple_read_from_buffer(buf, count, ppos, s->trace,
+				      s->trace_size);
+	mutex_unlock(&s->mutex);
+	return ret;
+}
+
+static long launchra_ioctl(struct file *file, unsigned int cmd,
+			   unsigned long arg)
+{
+	struct launchra_session *s = file->private_data;
+	long ret = -ENOTTY;
+
+	mutex_lock(&s->mutex);
+	switch (cmd) {
+	case LAUNCHRA_RECORD:
+		ret = launchra_record(s, (pid_t)arg);
+		break;
+	case LAUNCHRA_STOP:
+		ret = launchra_stop(s, (void __user *)arg);
+		if (!ret)
+			file->f_pos = 0;
+		break;
+	case LAUNCHRA_REPLAY:
+		ret = launchra_replay((void __user *)arg);
+		break;
+	}
+	mutex_unlock(&s->mutex);
+
+	return ret;
+}
+
+static const struct file_operations launchra_fops = {
+	.owner = THIS_MODULE,
+	.open = launchra_open,
+	.release = launchra_release,
+	.read = launchra_read,
+	.llseek = default_llseek,
+	.unlocked_ioctl = launchra_ioctl,
+	.compat_ioctl = launchra_ioctl,
+};
+
+static struct miscdevice launchra_misc = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "launchra",
+	.fops = &launchra_fops,
+	.mode = 0600,
+};
+
+static int __init launchra_init(void)
+{
+	int ret;
+
+	ret = misc_register(&launchra_misc);
+	if (unlikely(ret))
+		printk(KERN_ERR "launchra: failed to register misc device!\n");
+	return ret;
+}
+
+module_init(launchra_init);
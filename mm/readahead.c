@@ -27,6 +27,9 @@ file_ra_state_init(struct file_ra_state *ra, struct address_space *mapping)
 {
 	ra->ra_pages = mapping->backing_dev_info->ra_pages;
 	ra->prev_pos = -1;
+#ifdef CONFIG_READAHEAD_FEEDBACK
+	ra->wasted_mark = mapping->ra_wasted;
+#endif
 }
 EXPORT_SYMBOL_GPL(file_ra_state_init);
 
@@ -187,8 +190,12 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 		list_add(&page->lru, &page_pool);
 		if (page_idx == nr_to_read - lookahead_size)
 			SetPageReadahead(page);
+		SetPageRaUnused(page);
 		ret++;
 	}
+#ifdef CONFIG_READAHEAD_FEEDBACK
+	count_vm_events(READAHEAD_PAGES, ret);
+#endif
 
 	/*
 	 * Now start the IO.  We ignore I/O errors - if the page is not
@@ -259,6 +266,49 @@ unsigned long ra_submit(struct file_ra_state *ra,
 	return actual;
 }
 
+/* the window is never capped below this by feedback */
+#define RA_MIN_PAGES	4
+
+/*
+ * Readahead feedback.  Pages read ahead carry PG_ra_unused until they are
+ * first accessed by a read, fault or splice; a page reclaimed with the
+ * flag still set was read for nothing, and is counted in its mapping's
+ * ra_wasted.  Truncated pages are not.  Before sizing a window, halve the
+ * cap on it if the mapping lost read ahead pages since the last window,
+ * and raise the cap by a quarter once a full cap of pages has been used
+ * through this file without such losses.  Returns the largest window to
+ * use.
+ */
+unsigned long ra_max_pages(struct address_space *mapping,
+			   struct file_ra_state *ra)
+{
+#ifdef CONFIG_READAHEAD_FEEDBACK
+	unsigned long wasted = ACCESS_ONCE(mapping->ra_wasted);
+	unsigned int cap = ra->ra_pages;
+
+	if (ra->max_pages && ra->max_pages < cap)
+		cap = ra->max_pages;
+
+	if (wasted != ra->wasted_mark) {
+		ra->wasted_mark = wasted;
+		ra->used_mark = ra->used;
+		if (cap > RA_MIN_PAGES) {
+			cap = max_t(unsigned int, cap / 2, RA_MIN_PAGES);
+			ra->max_pages = cap;
+			count_vm_event(READAHEAD_SHRINK);
+		}
+	} else if (ra->max_pages && ra->used - ra->used_mark >= cap) {
+		ra->used_mark = ra->used;
+		cap += cap / 4;
+		ra->max_pages = cap < ra->ra_pages ? cap : 0;
+		count_vm_event(READAHEAD_GROW);
+	}
+	return min(cap, ra->ra_pages);
+#else
+	return ra->ra_pages;
+#endif
+}
+
 /*
  * Set the initial window size, round to next power of 2 and square
  * for small size, x 4 for medium, and x 2 for large
@@ -398,7 +448,7 @@ ondemand_readahead(struct address_space *mapping,
 		   bool hit_readahead_marker, pgoff_t offset,
 		   unsigned long req_size)
 {
-	unsigned long max = max_sane_readahead(ra->ra_pages);
+	unsigned long max = max_sane_readahead(ra_max_pages(mapping, ra));
 
 	/*
 	 * start of file
@@ -777,33 +777,17 @@ static int page_referenced_anon(struct page *page,
  *
  * This function is only called from page_referenced for object-based pages.
  */
-static int page_referenced_file(struct page *page,
-				struct mem_cgroup *mem_cont,
-				unsigned long *vm_flags)
+static int __page_referenced_file(struct page *page,
+				  struct mem_cgroup *mem_cont,
+				  unsigned long *vm_flags,
+				  bool foreground)
 {
 	unsigned int mapcount;
 	struct address_space *mapping = page->mapping;
 	pgoff_t pgoff = page->index << (PAGE_CACHE_SHIFT - PAGE_SHIFT);
 	struct vm_area_struct *vma;
 	struct prio_tree_iter iter;
-	int referenced = 0;
-
-	/*
-	 * The caller's checks on page->mapping and !PageAnon have made
-	 * sure that this is a file page: the check for page->mapping
-	 * excludes the case just before it gets set on an anon page.
-	 */
-	BUG_ON(PageAnon(page));
-
-	/*
-	 * The page lock not only makes sure that page->mapping cannot
-	 * suddenly be NULLified by truncation, it makes sure that the
-	 * structure at mapping cannot be freed and reused yet,
-	 * so we can safely take mapping->i_mmap_mutex.
-	 */
-	BUG_ON(!PageLocked(page));
-
-	mutex_lock(&mapping->i_mmap_mutex);
+	int referenced = 0, ref;
 
 	/*
 	 * i_mmap_mutex does not stabilize mapcount at all, but mapcount
@@ -822,13 +806,49 @@ static int page_referenced_file(struct page *page,
 		 */
 		if (mem_cont && !mm_match_cgroup(vma->vm_mm, mem_cont))
 			continue;
-		referenced += page_referenced_one(page, vma, address,
-						  &mapcount, vm_flags);
+		ref = page_referenced_one(page, vma, address,
+					  &mapcount, vm_flags);
+		/*
+		 * A reference from an application in the foreground cpu
+		 * cgroup counts twice, so that reclaim keeps its working set
+		 * and takes the pages only background applications use first.
+		 */
+		if (ref && foreground && mm_in_foreground(vma->vm_mm))
+			ref++;
+		referenced += ref;
 		if (!mapcount)
 			break;
 	}
 
+	return referenced;
+}
+
+static int page_referenced_file(struct page *page,
+				struct mem_cgroup *mem_cont,
+				unsigned long *vm_flags)
+{
+	struct address_space *mapping = page->mapping;
+	int referenced;
+
+	/*
+	 * The caller's checks on page->mapping and !PageAnon have made
+	 * sure that this is a file page: the check for page->mapping
+	 * excludes the case just before it gets set on an anon page.
+	 */
+	BUG_ON(PageAnon(page));
+
+	/*
+	 * The page lock not only makes sure that page->mapping cannot
+	 * suddenly be NULLified by truncation, it makes sure that the
+	 * structure at mapping cannot be freed and reused yet,
+	 * so we can safely take mapping->i_mmap_mutex.
+	 */
+	BUG_ON(!PageLocked(page));
+
+	mutex_lock(&mapping->i_mmap_mutex);
+	referenced = __page_referenced_file(page, mem_cont, vm_flags, false);
 	mutex_unlock(&mapping->i_mmap_mutex);
+
 	return referenced;
 }
 
@@ -878,6 +898,86 @@ out:
 	return referenced;
 }
 
+/* Most pages checked under one i_mmap_mutex */
+#define RMAP_BATCH_MAX		SWAP_CLUSTER_MAX
+
+/**
+ * page_referenced_batch - page_referenced() for a run of isolated pages
+ * @page: the page to test, not locked
+ * @mem_cont: target memory controller
+ * @vm_flags: collect encountered vma->vm_flags who actually referenced the page
+ * @batch: carried from one page to the next, initially zeroed
+ *
+ * Reclaim checks the pages it isolated from an LRU list one after the
+ * other, and the pages of one file mostly come in runs.  Keep the file's
+ * i_mmap_mutex across such a run instead of taking it for each page; the
+ * lock of the first page of the run keeps the mapping alive meanwhile.
+ * The caller must call rmap_batch_end() before it sleeps or takes locks
+ * other than page locks with trylock_page().
+ *
+ * Unlike page_referenced(), a reference to a file page through a
+ * foreground address space counts twice, see vm.protect_foreground.
+ */
+int page_referenced_batch(struct page *page,
+			  struct mem_cgroup *mem_cont,
+			  unsigned long *vm_flags,
+			  struct rmap_batch *batch)
+{
+	struct address_space *mapping;
+	int referenced = 0;
+
+	if (!page_mapped(page) || !page_rmapping(page))
+		return page_referenced(page, 0, mem_cont, vm_flags);
+
+	/* Anon and KSM pages take anon_vma->mutex, which may sleep */
+	if (PageAnon(page)) {
+		rmap_batch_end(batch);
+		return page_referenced(page, 0, mem_cont, vm_flags);
+	}
+
+	*vm_flags = 0;
+	if (!trylock_page(page)) {
+		referenced++;
+		goto out;
+	}
+
+	mapping = page->mapping;
+	if (!mapping) {
+		unlock_page(page);
+		goto out;
+	}
+
+	if (mapping != batch->mapping || batch->nr >= RMAP_BATCH_MAX) {
+		rmap_batch_end(batch);
+		mutex_lock(&mapping->i_mmap_mutex);
+		batch->mapping = mapping;
+		batch->page = page;
+		batch->nr = 0;
+	} else
+		count_vm_event(RMAP_BATCHED);
+	batch->nr++;
+
+	referenced += __page_referenced_file(page, mem_cont, vm_flags,
+					     vm_protect_foreground);
+	if (page != batch->page)
+		unlock_page(page);
+out:
+	if (page_test_and_clear_young(page_to_pfn(page)))
+		referenced++;
+
+	return referenced;
+}
+
+void rmap_batch_end(struct rmap_batch *batch)
+{
+	if (!batch->mapping)
+		return;
+
+	mutex_unlock(&batch->mapping->i_mmap_mutex);
+	unlock_page(batch->page);
+	batch->mapping = NULL;
+}
+
 static int page_mkclean_one(struct page *page, struct vm_area_struct *vma,
 			    unsigned long address)
 {
@@ -67,6 +67,11 @@
  *   a partial slab. A new slab has no one operating on it and thus there is
  *   no danger of cacheline contention.
  *
+ *   Slabs on the partial list of a cpu are frozen, so nobody holding
+ *   their slab_lock ever waits for a list_lock. That allows
+ *   unfreeze_partials() to take a list_lock once and then the slab_lock
+ *   of each slab it moves to the node.
+ *
  *   Interrupts are disabled during allocation and deallocation in order to
  *   make the slab allocator safe to use in the context of an irq. In addition
  *   interrupts are disabled to ensure that the processor does not change
@@ -77,7 +82,10 @@
  *
  * Slabs with free elements are kept on a partial list and during regular
  * operations no list for full slabs is used. If an object in a full slab is
- * freed then the slab will show up again on the partial lists.
+ * freed then the slab will show up again on the partial lists. That is
+ * the partial list of the freeing cpu first, from which it takes its next
+ * cpu slab without the list_lock. Only when more than cpu_partial slabs
+ * pile up there are they moved to the node partial list, all in one go.
  * We track full slabs for debugging purposes though because otherwise we
  * cannot scan all objects.
  *
@@ -1626,8 +1634,13 @@ void init_kmem_cache_cpus(struct kmem_cache *s)
 {
 	int cpu;
 
-	for_each_possible_cpu(cpu)
-		per_cpu_ptr(s->cpu_slab, cpu)->tid = init_tid(cpu);
+	for_each_possible_cpu(cpu) {
+		struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
+
+		c->tid = init_tid(cpu);
+		INIT_LIST_HEAD(&c->partial);
+		c->nr_partial = 0;
+	}
 }
 /*
  * Remove the cpu slab
@@ -1664,6 +1677,69 @@ static void deactivate_slab(struct kmem_cache *s, struct kmem_cache_cpu *c)
 	unfreeze_slab(s, page, tail);
 }
 
+/*
+ * Move the slabs on the cpu partial list to their node partial lists.
+ *
+ * Interrupts must be disabled.
+ */
+static void unfreeze_partials(struct kmem_cache *s, struct kmem_cache_cpu *c)
+{
+	struct kmem_cache_node *n = NULL;
+	struct page *page, *next;
+	LIST_HEAD(discard);
+
+	list_for_each_entry_safe(page, next, &c->partial, lru) {
+		struct kmem_cache_node *n2 = get_node(s, page_to_nid(page));
+
+		if (n != n2) {
+			if (n)
+				spin_unlock(&n->list_lock);
+			n = n2;
+			spin_lock(&n->list_lock);
+		}
+
+		slab_lock(page);
+		__ClearPageSlubFrozen(page);
+		if (!page->inuse && n->nr_partial >= s->min_partial) {
+			list_move(&page->lru, &discard);
+		} else {
+			list_move_tail(&page->lru, &n->partial);
+			n->nr_partial++;
+		}
+		slab_unlock(page);
+	}
+	if (n)
+		spin_unlock(&n->list_lock);
+
+	c->nr_partial = 0;
+	stat(s, CPU_PARTIAL_DRAIN);
+
+	list_for_each_entry_safe(page, next, &discard, lru) {
+		list_del(&page->lru);
+		stat(s, FREE_SLAB);
+		discard_slab(s, page);
+	}
+}
+
+/*
+ * Put a slab that just got its first free object on the partial list of
+ * this cpu instead of the node partial list. The slab is frozen, so
+ * further frees to it stay off the lists as well.
+ *
+ * Must be called with the slab lock held and interrupts disabled.
+ * Returns true if the cpu partial list has grown too long: the caller
+ * has to unfreeze_partials() once it has dropped the slab lock.
+ */
+static bool put_cpu_partial(struct kmem_cache *s, struct page *page)
+{
+	struct kmem_cache_cpu *c = __this_cpu_ptr(s->cpu_slab);
+
+	__SetPageSlubFrozen(page);
+	list_add(&page->lru, &c->partial);
+	stat(s, CPU_PARTIAL_FREE);
+	return ++c->nr_partial > s->cpu_partial;
+}
+
 static inline void flush_slab(struct kmem_cache *s, struct kmem_cache_cpu *c)
 {
 	stat(s, CPUSLAB_FLUSH);
@@ -1682,6 +1758,8 @@ static inline void __flush_cpu_slab(struct kmem_cache *s, int cpu)
 
 	if (likely(c && c->page))
 		flush_slab(s, c);
+	if (c && c->nr_partial)
+		unfreeze_partials(s, c);
 }
 
 static void flush_cpu_slab(void *d)
@@ -1847,6 +1925,19 @@ another_slab:
 	deactivate_slab(s, c);
 
 new_slab:
+	if (c->nr_partial) {
+		page = list_first_entry(&c->partial, struct page, lru);
+		if (node == NUMA_NO_NODE || page_to_nid(page) == node) {
+			list_del(&page->lru);
+			c->nr_partial--;
+			slab_lock(page);
+			stat(s, CPU_PARTIAL_ALLOC);
+			c->node = page_to_nid(page);
+			c->page = page;
+			goto load_freelist;
+		}
+	}
+
 	page = get_partial(s, gfpflags, node);
 	if (page) {
 		stat(s, ALLOC_FROM_PARTIAL);
@@ -2038,6 +2129,7 @@ static void __slab_free(struct kmem_cache *s, struct page *page,
 	void *prior;
 	void **object = (void *)x;
 	unsigned long flags;
+	bool drain = false;
 
 	local_irq_save(flags);
 	slab_lock(page);
@@ -2064,12 +2156,18 @@ static void __slab_free(struct kmem_cache *s, struct page *page,
 	 * then add it.
 	 */
 	if (unlikely(!prior)) {
-		add_partial(get_node(s, page_to_nid(page)), page, 1);
-		stat(s, FREE_ADD_PARTIAL);
+		if (s->cpu_partial) {
+			drain = put_cpu_partial(s, page);
+		} else {
+			add_partial(get_node(s, page_to_nid(page)), page, 1);
+			stat(s, FREE_ADD_PARTIAL);
+		}
 	}
 
 out_unlock:
 	slab_unlock(page);
+	if (drain)
+		unfreeze_partials(s, __this_cpu_ptr(s->cpu_slab));
 	local_irq_restore(flags);
 	return;
 
@@ -2600,6 +2698,23 @@ static int kmem_cache_open(struct kmem_cache *s,
 	 * list to avoid pounding the page allocator excessively.
 	 */
 	set_min_partial(s, ilog2(s->size));
+
+	/*
+	 * Slabs kept frozen on the partial list of each cpu. Their free
+	 * objects are out of reach for the other cpus, so keep fewer of
+	 * the bigger ones. Debug caches always go through the node lists.
+	 */
+	if (kmem_cache_debug(s))
+		s->cpu_partial = 0;
+	else if (s->size >= PAGE_SIZE)
+		s->cpu_partial = 2;
+	else if (s->size >= 1024)
+		s->cpu_partial = 3;
+	else if (s->size >= 256)
+		s->cpu_partial = 4;
+	else
+		s->cpu_partial = 6;
+
 	s->refcount = 1;
 #ifdef CONFIG_NUMA
 	s->remote_node_defrag_ratio = 1000;
@@ -4147,6 +4262,29 @@ static ssize_t min_partial_store(struct kmem_cache *s, const char *buf,
 }
 SLAB_ATTR(min_partial);
 
+static ssize_t cpu_partial_show(struct kmem_cache *s, char *buf)
+{
+	return sprintf(buf, "%u\n", s->cpu_partial);
+}
+
+static ssize_t cpu_partial_store(struct kmem_cache *s, const char *buf,
+				 size_t length)
+{
+	unsigned long slabs;
+	int err;
+
+	err = strict_strtoul(buf, 10, &slabs);
+	if (err)
+		return err;
+	if (slabs && kmem_cache_debug(s))
+		return -EINVAL;
+
+	s->cpu_partial = slabs;
+	flush_all(s);
+	return length;
+}
+SLAB_ATTR(cpu_partial);
+
 static ssize_t ctor_show(struct kmem_cache *s, char *buf)
 {
 	if (!s->ctor)
@@ -4493,6 +4631,9 @@ STAT_ATTR(DEACTIVATE_TO_HEAD, deactivate_to_head);
 STAT_ATTR(DEACTIVATE_TO_TAIL, deactivate_to_tail);
 STAT_ATTR(DEACTIVATE_REMOTE_FREES, deactivate_remote_frees);
 STAT_ATTR(ORDER_FALLBACK, order_fallback);
+STAT_ATTR(CPU_PARTIAL_ALLOC, cpu_partial_alloc);
+STAT_ATTR(CPU_PARTIAL_FREE, cpu_partial_free);
+STAT_ATTR(CPU_PARTIAL_DRAIN, cpu_partial_drain);
 #endif
 
 static struct attribute *slab_attrs[] = {
@@ -4501,6 +4642,7 @@ static struct attribute *slab_attrs[] = {
 	&objs_per_slab_attr.attr,
 	&order_attr.attr,
 	&min_partial_attr.attr,
+	&cpu_partial_attr.attr,
 	&objects_attr.attr,
 	&objects_partial_attr.attr,
 	&partial_attr.attr,
@@ -4550,6 +4692,9 @@ static struct attribute *slab_attrs[] = {
 	&deactivate_to_tail_attr.attr,
 	&deactivate_remote_frees_attr.attr,
 	&order_fallback_attr.attr,
+	&cpu_partial_alloc_attr.attr,
+	&cpu_partial_free_attr.attr,
+	&cpu_partial_drain_attr.attr,
 #endif
 #ifdef CONFIG_FAILSLAB
 	&failslab_attr.attr,
@@ -43,6 +43,7 @@
 #include <linux/sysctl.h>
 #include <linux/oom.h>
 #include <linux/prefetch.h>
+#include <linux/hrtimer.h>
 
 #include <asm/tlbflush.h>
 #include <asm/div64.h>
@@ -149,6 +150,12 @@ struct scan_control {
  * From 0 .. 100.  Higher means more swappy.
  */
 int vm_swappiness = 60;
+
+/*
+ * Keep the file pages referenced by applications in the foreground cpu
+ * cgroup active, unless reclaim is struggling.
+ */
+int vm_protect_foreground = 1;
 long vm_total_pages;	/* The total number of pages which the VM controls */
 
 static LIST_HEAD(shrinker_list);
@@ -479,9 +486,11 @@ static pageout_t pageout(struct page *page, struct address_space *mapping,
 
 /*
  * Same as remove_mapping, but if the page is removed from the mapping, it
- * gets returned with a refcount of 0.
+ * gets returned with a refcount of 0.  reclaimed tells evictions by reclaim,
+ * which workingset detection remembers, from other removals.
  */
-static int __remove_mapping(struct address_space *mapping, struct page *page)
+static int __remove_mapping(struct address_space *mapping, struct page *page,
+			    bool reclaimed)
 {
 	BUG_ON(!PageLocked(page));
 	BUG_ON(mapping != page_mapping(page));
@@ -530,6 +539,10 @@ static int __remove_mapping(struct address_space *mapping, struct page *page)
 
 		freepage = mapping->a_ops->freepage;
 
+		if (reclaimed && page_is_file_cache(page)) {
+			workingset_eviction(mapping, page);
+			ra_page_evicted(mapping, page);
+		}
 		__delete_from_page_cache(page);
 		spin_unlock_irq(&mapping->tree_lock);
 		mem_cgroup_uncharge_cache_page(page);
@@ -553,7 +566,7 @@ cannot_free:
  */
 int remove_mapping(struct address_space *mapping, struct page *page)
 {
-	if (__remove_mapping(mapping, page)) {
+	if (__remove_mapping(mapping, page, false)) {
 		/*
 		 * Unfreezing the refcount with 1 rather than 2 effectively
 		 * drops the pagecache ref for us without requiring another
@@ -901,7 +914,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			}
 		}
 
-		if (!mapping || !__remove_mapping(mapping, page))
+		if (!mapping || !__remove_mapping(mapping, page, true))
 			goto keep_locked;
 
 		/*
@@ -1542,6 +1555,9 @@ static void shrink_active_list(unsigned long nr_pages, struct zone *zone,
 	struct page *page;
 	struct zone_reclaim_stat *reclaim_stat = get_reclaim_stat(zone, sc);
 	unsigned long nr_rotated = 0;
+	unsigned long nr_protected = 0;
+	struct rmap_batch batch = { .mapping = NULL };
+	int referenced;
 
 	lru_add_drain();
 	spin_lock_irq(&zone->lru_lock);
@@ -1573,7 +1589,10 @@ static void shrink_active_list(unsigned long nr_pages, struct zone *zone,
 	spin_unlock_irq(&zone->lru_lock);
 
 	while (!list_empty(&l_hold)) {
-		cond_resched();
+		if (need_resched()) {
+			rmap_batch_end(&batch);
+			cond_resched();
+		}
 		page = lru_to_page(&l_hold);
 		list_del(&page->lru);
 
@@ -1582,7 +1601,9 @@ static void shrink_active_list(unsigned long nr_pages, struct zone *zone,
 			continue;
 		}
 
-		if (page_referenced(page, 0, sc->mem_cgroup, &vm_flags)) {
+		referenced = page_referenced_batch(page, sc->mem_cgroup,
+						   &vm_flags, &batch);
+		if (referenced) {
 			nr_rotated += hpage_nr_pages(page);
 			/*
 			 * Identify referenced, file-backed active pages and
@@ -1597,11 +1618,24 @@ static void shrink_active_list(unsigned long nr_pages, struct zone *zone,
 				list_add(&page->lru, &l_active);
 				continue;
 			}
+			/*
+			 * The same for file pages referenced by the foreground
+			 * application, or by several processes, unless reclaim
+			 * is getting nowhere without them.
+			 */
+			if (referenced > 1 && vm_protect_foreground &&
+			    page_is_file_cache(page) &&
+			    priority >= DEF_PRIORITY - 2) {
+				nr_protected += hpage_nr_pages(page);
+				list_add(&page->lru, &l_active);
+				continue;
+			}
 		}
 
 		ClearPageActive(page);	/* we are de-activating */
 		list_add(&page->lru, &l_inactive);
 	}
+	rmap_batch_end(&batch);
 
 	/*
 	 * Move pages back to the lru list.
@@ -1614,6 +1648,7 @@ static void shrink_active_list(unsigned long nr_pages, struct zone *zone,
 	 * get_scan_ratio.
 	 */
 	reclaim_stat->recent_rotated[file] += nr_rotated;
+	__count_vm_events(PGPROTECTED, nr_protected);
 
 	move_active_pages_to_lru(zone, &l_active,
 						LRU_ACTIVE + file * LRU_FILE);
@@ -2175,6 +2210,24 @@ out:
 	return 0;
 }
 
+/*
+ * Direct reclaim stalls the allocating task, often the one drawing the
+ * screen: keep a histogram of how long it takes in /proc/vmstat.
+ */
+static void count_direct_reclaim_latency(s64 us)
+{
+	if (us < 1000)
+		count_vm_event(DIRECT_RECLAIM_1MS);
+	else if (us < 4000)
+		count_vm_event(DIRECT_RECLAIM_4MS);
+	else if (us < 16000)
+		count_vm_event(DIRECT_RECLAIM_16MS);
+	else if (us < 64000)
+		count_vm_event(DIRECT_RECLAIM_64MS);
+	else
+		count_vm_event(DIRECT_RECLAIM_SLOW);
+}
+
 unsigned long try_to_free_pages(struct zonelist *zonelist, int order,
 				gfp_t gfp_mask, nodemask_t *nodemask)
 {
@@ -2193,12 +2246,15 @@ unsigned long try_to_free_pages(struct zonelist *zonelist, int order,
 	struct shrink_control shrink = {
 		.gfp_mask = sc.gfp_mask,
 	};
+	ktime_t start;
 
 	trace_mm_vmscan_direct_reclaim_begin(order,
 				sc.may_writepage,
 				gfp_mask);
 
+	start = ktime_get();
 	nr_reclaimed = do_try_to_free_pages(zonelist, &sc, &shrink);
+	count_direct_reclaim_latency(ktime_us_delta(ktime_get(), start));
 
 	trace_mm_vmscan_direct_reclaim_end(nr_reclaimed);
 
@@ -2793,8 +2849,16 @@ static int kswapd(void *p)
 		 * after returning from the refrigerator
 		 */
 		if (!ret) {
+			int wake_order = order;
+
 			trace_mm_vmscan_kswapd_wake(pgdat->node_id, order);
 			order = balance_pgdat(pgdat, order, &classzone_idx);
+
+			/*
+			 * Reclaim alone rarely frees contiguous pages, compact
+			 * a little before high-order allocations start failing
+			 */
+			compact_pgdat_proactive(pgdat, wake_order);
 		}
 	}
 	return 0;
@@ -708,6 +708,8 @@ const char * const vmstat_text[] = {
 	"nr_shmem",
 	"nr_dirtied",
 	"nr_written",
+	"workingset_refault",
+	"workingset_activate",
 
 #ifdef CONFIG_NUMA
 	"numa_hit",
@@ -755,6 +757,21 @@ const char * const vmstat_text[] = {
 	"allocstall",
 
 	"pgrotated",
+	"pgprotected",
+	"rmap_batched",
+	"direct_reclaim_1ms",
+	"direct_reclaim_4ms",
+	"direct_reclaim_16ms",
+	"direct_reclaim_64ms",
+	"direct_reclaim_slow",
+
+#ifdef CONFIG_READAHEAD_FEEDBACK
+	"readahead_pages",
+	"readahead_used",
+	"readahead_wasted",
+	"readahead_shrink",
+	"readahead_grow",
+#endif
 
 #ifdef CONFIG_COMPACTION
 	"compact_blocks_moved",
@@ -763,6 +780,10 @@ const char * const vmstat_text[] = {
 	"compact_stall",
 	"compact_fail",
 	"compact_success",
+	"compact_proactive",
+	"compact_proactive_success",
+	"compact_proactive_scanned",
+	"compact_proactive_migrated",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
@@ -0,0 +1,167 @@
+/*
+ * mm/workingset.c
+ *
+ * Workingset detection: remember when file pages were evicted, and put
+ * those refaulting soon enough straight back on the active list.
+ *
+ * Copyright (C) 2011 Meizu Technology Co.Ltd, Zhuhai, China
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/mm.h>
+#include <linux/swap.h>
+#include <linux/hash.h>
+#include <linux/bootmem.h>
+#include <linux/init.h>
+#include <linux/module.h>
+
+/*
+ * A new file page starts on the inactive list, and is only activated
+ * once it is referenced again while there.  When the set of pages used
+ * in turn, say the assets of a game, is bigger than the inactive list,
+ * each page is evicted before it is used again, and the file LRU
+ * thrashes however much memory the active list holds.
+ *
+ * Each zone counts the pages leaving its inactive list, by eviction or
+ * activation, in inactive_age.  When a page is evicted, the age is
+ * stored in a shadow entry.  Once the page faults back in, the
+ * difference is how many more pages the inactive list would have
+ * needed to keep it - its refault distance.  If the distance is no
+ * larger than the active list, the page would have survived had the
+ * active list given up that space, so it is activated at once and
+ * competes with the active pages instead.
+ *
+ * The radix trees of the page cache hold nothing but pages here, and
+ * every lookup relies on that, so shadow entries are kept in a hash
+ * table of their own.  It has one entry per four pages of memory, and
+ * an eviction simply overwrites whatever shadow was in its slot.  The
+ * entries are read and written without locking; a torn or stale entry
+ * at worst activates one page it should not, or misses one.
+ */
+
+struct shadow_entry {
+	unsigned long key;		/* mapping and index, 0 if empty */
+	unsigned long eviction;		/* inactive_age and zone */
+};
+
+static struct shadow_entry *shadow_table __read_mostly;
+static unsigned int shadow_shift __read_mostly;
+
+#define EVICTION_SHIFT	(NODES_SHIFT + ZONES_SHIFT)
+#define EVICTION_MASK	(~0UL >> EVICTION_SHIFT)
+
+static unsigned long shadow_key(struct address_space *mapping, pgoff_t index)
+{
+	return ((unsigned long)mapping + index * GOLDEN_RATIO_PRIME) | 1;
+}
+
+static struct shadow_entry *shadow_slot(unsigned long key)
+{
+	return shadow_table + hash_long(key, shadow_shift);
+}
+
+static unsigned long pack_eviction(struct zone *zone, unsigned long age)
+{
+	unsigned long eviction = age;
+
+	eviction = (eviction << NODES_SHIFT) | zone_to_nid(zone);
+	eviction = (eviction << ZONES_SHIFT) | zone_idx(zone);
+	return eviction;
+}
+
+static struct zone *unpack_eviction(unsigned long eviction,
+				    unsigned long *age)
+{
+	int zid, nid;
+
+	zid = eviction & ((1UL << ZONES_SHIFT) - 1);
+	eviction >>= ZONES_SHIFT;
+	nid = eviction & ((1UL << NODES_SHIFT) - 1);
+	eviction >>= NODES_SHIFT;
+	*age = eviction;
+
+	return NODE_DATA(nid)->node_zones + zid;
+}
+
+/**
+ * workingset_eviction - note the eviction of a file page
+ * @mapping: address space the page was in
+ * @page: the page being reclaimed
+ *
+ * Called by reclaim, under mapping->tree_lock, just before @page is
+ * removed from the page cache.
+ */
+void workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	unsigned long key = shadow_key(mapping, page->index);
+	struct shadow_entry *slot;
+	unsigned long age;
+
+	age = atomic_long_inc_return(&zone->inactive_age);
+	if (!shadow_table)
+		return;
+
+	slot = shadow_slot(key);
+	slot->key = key;
+	slot->eviction = pack_eviction(zone, age);
+}
+
+/**
+ * workingset_refault - decide where a file page being read in belongs
+ * @mapping: address space the page is added to
+ * @index: its offset in @mapping
+ *
+ * Consumes the shadow entry, if any, left when the page at @index was
+ * last evicted.  Returns true if the page should go straight to the
+ * active list.
+ */
+bool workingset_refault(struct address_space *mapping, pgoff_t index)
+{
+	unsigned long key = shadow_key(mapping, index);
+	unsigned long eviction, refault, distance;
+	struct shadow_entry *slot;
+	struct zone *zone;
+
+	if (!shadow_table)
+		return false;
+
+	slot = shadow_slot(key);
+	if (ACCESS_ONCE(slot->key) != key)
+		return false;
+	eviction = ACCESS_ONCE(slot->eviction);
+	slot->key = 0;
+
+	zone = unpack_eviction(eviction, &eviction);
+	refault = atomic_long_read(&zone->inactive_age);
+	distance = (refault - eviction) & EVICTION_MASK;
+
+	inc_zone_state(zone, WORKINGSET_REFAULT);
+	if (distance <= zone_page_state(zone, NR_ACTIVE_FILE)) {
+		inc_zone_state(zone, WORKINGSET_ACTIVATE);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * workingset_activation - note a page activation
+ * @page: page that is being activated
+ */
+void workingset_activation(struct page *page)
+{
+	atomic_long_inc(&page_zone(page)->inactive_age);
+}
+
+static int __init workingset_init(void)
+{
+	shadow_table = alloc_large_system_hash("Workingset shadow",
+					sizeof(struct shadow_entry), 0, 14, 0,
+					&shadow_shift, NULL, 0);
+	memset(shadow_table, 0, sizeof(struct shadow_entry) << shadow_shift);
+	return 0;
+}
+module_init(workingset_init)